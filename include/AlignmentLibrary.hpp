@@ -67,6 +67,7 @@ class AlignmentLibrary {
         posBiasRC_(5),
         seqBiasModel_(1.0),
     	eqBuilder_(salmonOpts.jointLog),
+        telemetry_(salmonOpts.telemetry),
         quantificationPasses_(0),
         expectedBias_(constExprPow(4, readBias_[0].getK()), 1.0),
 	expectedGC_( salmonOpts.numConditionalGCBins,
@@ -175,10 +176,15 @@ class AlignmentLibrary {
         return eqBuilder_;
     }
 
+    const EquivalenceClassBuilder& equivalenceClassBuilder() const {
+        return eqBuilder_;
+    }
+
     // TODO: Make same as mapping-based
     void updateTranscriptLengthsAtomic(std::atomic<bool>& done) {
         if (sl_.try_lock()) {
             if (!done) {
+                PhaseTelemetry::ScopedTimer timer(telemetry_.get(), TelemetryPhase::BURN_IN_LENGTHS);
 
                 auto fld = flDist_.get();
                 // Convert the PMF to non-log scale
@@ -436,6 +442,8 @@ class AlignmentLibrary {
     size_t quantificationPasses_;
     SpinLock sl_;
     EquivalenceClassBuilder eqBuilder_;
+    // Where we record the time spent on the burn-in length update
+    std::shared_ptr<PhaseTelemetry> telemetry_;
 
     /** Positional bias things**/
     std::vector<SimplePosBias> posBiasFW_;
@@ -0,0 +1,90 @@
+#ifndef __ASYNC_OUTPUT_WRITER_HPP__
+#define __ASYNC_OUTPUT_WRITER_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "tbb/concurrent_queue.h"
+
+/**
+ * Moves large blocks of already-formatted text (e.g. SAM records or the
+ * names of unmapped reads) from many producer threads to a single output
+ * stream.
+ *
+ * Producers accumulate output in their own (thread-local) buffers and
+ * hand off whole buffers with write(); the buffer is moved, not copied,
+ * onto a bounded queue that is drained by a dedicated writer thread.  Thus,
+ * mapping threads never block on the output stream itself.  If the writer
+ * falls behind and the queue fills, producers wait for space; the number of
+ * times this happens is recorded so that it can be reported.
+ */
+class AsyncOutputWriter {
+public:
+    /**
+     * Start a writer thread that writes to `out`.  At most `maxQueuedChunks`
+     * buffers may be waiting to be written at any time.
+     */
+    AsyncOutputWriter(std::ostream& out, size_t maxQueuedChunks = 64) : out_(out) {
+        queue_.set_capacity(maxQueuedChunks);
+        writerThread_ = std::thread([this]() -> void { drain_(); });
+    }
+
+    AsyncOutputWriter(const AsyncOutputWriter&) = delete;
+    AsyncOutputWriter& operator=(const AsyncOutputWriter&) = delete;
+
+    ~AsyncOutputWriter() { close(); }
+
+    /**
+     * Hand off the contents of `chunk` to be written.  Empty chunks are
+     * ignored.
+     */
+    void write(std::string&& chunk) {
+        if (chunk.empty()) { return; }
+        if (!queue_.try_push(std::move(chunk))) {
+            ++numStalls_;
+            queue_.push(std::move(chunk));
+        }
+    }
+
+    /**
+     * Write everything that has been handed off, flush the stream and
+     * stop the writer thread.  No more writes may be performed after this.
+     */
+    void close() {
+        if (writerThread_.joinable()) {
+            // An empty chunk tells the writer thread to stop
+            queue_.push(std::string());
+            writerThread_.join();
+            out_.flush();
+        }
+    }
+
+    uint64_t bytesWritten() const { return bytesWritten_; }
+    uint64_t chunksWritten() const { return chunksWritten_; }
+    // The number of times a producer had to wait for space in the queue
+    uint64_t numStalls() const { return numStalls_; }
+
+private:
+    void drain_() {
+        std::string chunk;
+        while (true) {
+            queue_.pop(chunk);
+            if (chunk.empty()) { break; }
+            out_.write(chunk.data(), chunk.size());
+            bytesWritten_ += chunk.size();
+            ++chunksWritten_;
+        }
+    }
+
+    std::ostream& out_;
+    tbb::concurrent_bounded_queue<std::string> queue_;
+    std::thread writerThread_;
+    std::atomic<uint64_t> bytesWritten_{0};
+    std::atomic<uint64_t> chunksWritten_{0};
+    std::atomic<uint64_t> numStalls_{0};
+};
+
+#endif // __ASYNC_OUTPUT_WRITER_HPP__
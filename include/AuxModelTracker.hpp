@@ -0,0 +1,236 @@
+#ifndef __AUX_MODEL_TRACKER_HPP__
+#define __AUX_MODEL_TRACKER_HPP__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cereal/archives/json.hpp"
+
+/**
+ * The auxiliary models learned during the online phase.
+ */
+enum class AuxModel : uint8_t {
+    FRAG_LENGTH = 0,  // the fragment length distribution
+    POS_BIAS = 1,     // the observed positional bias
+    GC_BIAS = 2,      // the observed fragment-GC bias
+    SEQ_BIAS = 3,     // the observed sequence-specific bias
+    NUM_MODELS = 4
+};
+
+/**
+ * How a model is updated: by every fragment, by a random subset of the
+ * fragments (each given a correspondingly larger weight), or not at all.
+ */
+enum class AuxModelUpdate : uint8_t {
+    FULL = 0,
+    SAMPLED = 1,
+    FROZEN = 2
+};
+
+/**
+ * Decides, for each of the auxiliary models, how much work is still worth
+ * spending on it.
+ *
+ * Every `windowSize` fragments, each worker thread takes a (normalized)
+ * snapshot of its own copy of every model it is still updating, and
+ * measures how far it moved since the previous snapshot (by the total
+ * variation distance).  Once a model has moved less than `tolerance` for
+ * `numStableWindows` consecutive windows, it is switched from FULL to
+ * SAMPLED updates and, after another such run, from SAMPLED to FROZEN.
+ * The decision is shared by all threads; the first thread to see a model
+ * settle makes it.
+ *
+ * The switches (and the fragment counts at which they happened) are
+ * written to meta_info.json.
+ */
+class AuxModelTracker {
+public:
+    static constexpr size_t numModels = static_cast<size_t>(AuxModel::NUM_MODELS);
+    static constexpr uint32_t numStableWindows = 2;
+
+    static const char* modelName(AuxModel m) {
+        static const char* names[] = {"fragment_length", "positional_bias",
+                                      "gc_bias", "sequence_bias"};
+        return names[static_cast<size_t>(m)];
+    }
+
+    static const char* updateName(AuxModelUpdate u) {
+        static const char* names[] = {"full", "sampled", "frozen"};
+        return names[static_cast<size_t>(u)];
+    }
+
+    /** The state of a single worker thread. */
+    struct ThreadState {
+        // The last snapshot of each model, and the mode it was taken in
+        std::array<std::vector<double>, numModels> prev;
+        std::array<AuxModelUpdate, numModels> prevMode{};
+        // The number of consecutive windows in which each model was stable
+        std::array<uint32_t, numModels> stableWindows{};
+        uint64_t fragsSinceCheck{0};
+    };
+
+    AuxModelTracker() {
+        for (size_t i = 0; i < numModels; ++i) {
+            modes_[i] = AuxModelUpdate::FULL;
+            tracked_[i] = false;
+            lastChange_[i] = 0.0;
+            sampledAt_[i] = 0;
+            frozenAt_[i] = 0;
+        }
+    }
+
+    AuxModelTracker(const AuxModelTracker&) = delete;
+    AuxModelTracker& operator=(const AuxModelTracker&) = delete;
+
+    /** A tolerance of 0 disables the tracking (every model is always updated). */
+    void configure(double tolerance, uint64_t windowSize = 100000,
+                   double sampleRate = 0.1) {
+        tolerance_ = tolerance;
+        windowSize_ = windowSize;
+        sampleRate_ = sampleRate;
+        logWeight_ = -std::log(sampleRate);
+    }
+
+    bool enabled() const { return tolerance_ > 0.0; }
+    double sampleRate() const { return sampleRate_; }
+
+    AuxModelUpdate mode(AuxModel m) const { return modes_[static_cast<size_t>(m)]; }
+
+    /**
+     * Whether a fragment should update a model that is in mode `u`;
+     * `sampled` says whether the fragment was drawn (with probability
+     * sampleRate()) for the sampled updates.
+     */
+    static bool shouldUpdate(AuxModelUpdate u, bool sampled) {
+        return u == AuxModelUpdate::FULL or (u == AuxModelUpdate::SAMPLED and sampled);
+    }
+
+    /**
+     * Whether a fragment should update model `m`; this draws from `eng`
+     * only if the model is being sampled.
+     */
+    template <typename RNG>
+    bool shouldUpdate(AuxModel m, RNG& eng) const {
+        auto u = mode(m);
+        return u == AuxModelUpdate::FULL or
+               (u == AuxModelUpdate::SAMPLED and eng.uniform01() < sampleRate_);
+    }
+
+    /**
+     * The (log) factor by which to scale such an update, so that the
+     * sampled updates add the same mass, in expectation, as full ones.
+     */
+    double logWeight(AuxModelUpdate u) const {
+        return (u == AuxModelUpdate::SAMPLED) ? logWeight_ : 0.0;
+    }
+
+    /**
+     * Record that this thread processed `n` more fragments; returns true
+     * if it's time for the thread to observe its models again.
+     */
+    bool windowDone(ThreadState& ts, uint64_t n) const {
+        if (!enabled()) { return false; }
+        ts.fragsSinceCheck += n;
+        if (ts.fragsSinceCheck < windowSize_) { return false; }
+        ts.fragsSinceCheck = 0;
+        return true;
+    }
+
+    /**
+     * Observe the current (unnormalized) masses of model `m`; this
+     * overwrites `masses`.  Returns true if this observation switched the
+     * model to its next mode.
+     */
+    bool observe(AuxModel m, ThreadState& ts, std::vector<double>& masses,
+                 uint64_t numAssignedFragments) {
+        size_t idx = static_cast<size_t>(m);
+        auto cur = modes_[idx].load();
+        if (cur == AuxModelUpdate::FROZEN) { return false; }
+        tracked_[idx] = true;
+
+        double total{0.0};
+        for (auto x : masses) { total += x; }
+        if (!(total > 0.0)) { return false; }
+        for (auto& x : masses) { x /= total; }
+
+        // Only windows spent entirely in the current mode count
+        auto& prev = ts.prev[idx];
+        bool switched{false};
+        if (ts.prevMode[idx] != cur) {
+            ts.prevMode[idx] = cur;
+            ts.stableWindows[idx] = 0;
+        } else if (prev.size() == masses.size()) {
+            double dist{0.0};
+            for (size_t i = 0; i < masses.size(); ++i) {
+                dist += std::abs(masses[i] - prev[i]);
+            }
+            dist *= 0.5;
+            lastChange_[idx] = dist;
+            if (dist < tolerance_) {
+                if (++ts.stableWindows[idx] >= numStableWindows) {
+                    switched = advance_(idx, cur, numAssignedFragments);
+                    ts.stableWindows[idx] = 0;
+                }
+            } else {
+                ts.stableWindows[idx] = 0;
+            }
+        }
+        prev.swap(masses);
+        return switched;
+    }
+
+    /** Write the settings and the decisions as the fields of a JSON object. */
+    template <typename Archive>
+    void save(Archive& ar) const {
+        ar(cereal::make_nvp("tolerance", tolerance_));
+        ar(cereal::make_nvp("window_size", windowSize_));
+        ar(cereal::make_nvp("sample_rate", sampleRate_));
+        for (size_t i = 0; i < numModels; ++i) {
+            if (!tracked_[i]) { continue; }
+            ar.setNextName(modelName(static_cast<AuxModel>(i)));
+            ar.startNode();
+            ar(cereal::make_nvp("final_update", std::string(updateName(modes_[i]))));
+            ar(cereal::make_nvp("last_change", lastChange_[i].load()));
+            if (sampledAt_[i] > 0) {
+                ar(cereal::make_nvp("sampled_after_fragments", sampledAt_[i].load()));
+            }
+            if (frozenAt_[i] > 0) {
+                ar(cereal::make_nvp("frozen_after_fragments", frozenAt_[i].load()));
+            }
+            ar.finishNode();
+        }
+    }
+
+private:
+    bool advance_(size_t idx, AuxModelUpdate cur, uint64_t numAssignedFragments) {
+        auto next = (cur == AuxModelUpdate::FULL) ? AuxModelUpdate::SAMPLED
+                                                  : AuxModelUpdate::FROZEN;
+        if (!modes_[idx].compare_exchange_strong(cur, next)) { return false; }
+        // Make sure a count of 0 still reads as "switched"
+        uint64_t at = std::max(numAssignedFragments, uint64_t(1));
+        if (next == AuxModelUpdate::SAMPLED) {
+            sampledAt_[idx] = at;
+        } else {
+            frozenAt_[idx] = at;
+        }
+        return true;
+    }
+
+    double tolerance_{0.0};
+    uint64_t windowSize_{100000};
+    double sampleRate_{0.1};
+    double logWeight_{-std::log(0.1)};
+
+    std::array<std::atomic<AuxModelUpdate>, numModels> modes_;
+    std::array<std::atomic<bool>, numModels> tracked_;
+    std::array<std::atomic<double>, numModels> lastChange_;
+    std::array<std::atomic<uint64_t>, numModels> sampledAt_;
+    std::array<std::atomic<uint64_t>, numModels> frozenAt_;
+};
+
+#endif // __AUX_MODEL_TRACKER_HPP__
@@ -29,12 +29,13 @@ static void smem_aux_destroy(smem_aux_t *a)
     free(a);
 }
 
+static void mem_collect_extra_intv(const SalmonOpts& sopt, const mem_opt_t *opt, SalmonIndex* sidx, int len, const uint8_t *seq, smem_aux_t *a);
+
 static void mem_collect_intv(const SalmonOpts& sopt, const mem_opt_t *opt, SalmonIndex* sidx, int len, const uint8_t *seq, smem_aux_t *a)
 {
     const bwt_t* bwt = sidx->bwaIndex()->bwt;
-    int i, k, x = 0, old_n;
+    int i, x = 0;
     int start_width = (opt->flag & MEM_F_SELF_OVLP)? 2 : 1;
-    int split_len = (int)(opt->min_seed_len * opt->split_factor + .499);
     a->mem.n = 0;
 
     // first pass: find all SMEMs
@@ -75,6 +76,47 @@ static void mem_collect_intv(const SalmonOpts& sopt, const mem_opt_t *opt, Salmo
         }
     }
 
+    mem_collect_extra_intv(sopt, opt, sidx, len, seq, a);
+}
+
+/**
+ * The first pass of mem_collect_intv, for all of the queries of @batch at
+ * once (see bwautils::SMEMBatch); the remaining passes are done, per query,
+ * by mem_collect_extra_intv.
+ */
+static void mem_collect_intv_batch(const mem_opt_t *opt, SalmonIndex* sidx, bwautils::SMEMBatch& batch)
+{
+    int start_width = (opt->flag & MEM_F_SELF_OVLP)? 2 : 1;
+    if (sidx->hasAuxKmerIndex()) {
+        KmerIntervalMap& auxIdx = sidx->auxIndex();
+        int klen = static_cast<int>(auxIdx.k());
+        batch.search(start_width, opt->min_seed_len,
+                     [&auxIdx, klen](const uint8_t* q, int len, int x, bwtintv_t& ik) -> bool {
+                        // Make sure there are at least k bases left
+                        if (len - x < klen) { return false; }
+                        // search for this key in the auxiliary index
+                        KmerKey kmer(const_cast<uint8_t*>(&(q[x])), klen);
+                        auto it = auxIdx.find(kmer);
+                        if (it == auxIdx.end()) { return false; }
+                        ik = it->second;
+                        return true;
+                     });
+    } else {
+        batch.search(start_width, opt->min_seed_len);
+    }
+}
+
+/**
+ * The passes of mem_collect_intv after the first (which has already placed
+ * the SMEMs of @seq in a->mem).
+ */
+static void mem_collect_extra_intv(const SalmonOpts& sopt, const mem_opt_t *opt, SalmonIndex* sidx, int len, const uint8_t *seq, smem_aux_t *a)
+{
+    const bwt_t* bwt = sidx->bwaIndex()->bwt;
+    int i, k, x = 0, old_n;
+    int start_width = (opt->flag & MEM_F_SELF_OVLP)? 2 : 1;
+    int split_len = (int)(opt->min_seed_len * opt->split_factor + .499);
+
     // For sensitive / extra-sensitive mode only
     if (sopt.sensitive or sopt.extraSeedPass) {
         // second pass: find MEMs inside a long SMEM
@@ -1,6 +1,11 @@
 #ifndef __BWA_UTILS_HPP__
 #define __BWA_UTILS_HPP__
 
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
 extern "C" {
 #include "bwa.h"
 #include "bwamem.h"
@@ -29,6 +34,79 @@ namespace bwautils {
     int bwt_smem1a_with_kmer(const bwt_t *bwt, int len, const uint8_t *q, int x, int min_intv, uint64_t max_intv, bwtintv_t initial_interval, bwtintv_v *mem, bwtintv_v *tmpvec[2]);
     
     int bwt_smem1_with_kmer(const bwt_t *bwt, int len, const uint8_t *q, int x, int min_intv, bwtintv_t initial_interval, bwtintv_v *mem, bwtintv_v *tmpvec[2]);
+
+    /**
+     * Finds the SMEMs of a batch of queries (e.g. the reads of a chunk),
+     * exactly as repeated calls to bwt_smem1 (or bwt_smem1_with_kmer) would,
+     * but with the searches of up to @numInFlight queries interleaved.
+     *
+     * Each search is kept as a small state machine that performs a single
+     * bwt_extend() per step, and then prefetches the occurrence blocks that
+     * its next extension will read.  By the time the search is stepped
+     * again (after all the others in flight), those blocks are usually in
+     * the cache, so the latency of the (otherwise dependent) BWT lookups is
+     * overlapped across queries.
+     */
+    class SMEMBatch {
+    public:
+        /**
+         * Sets @ik to the interval of the seed starting at @x in @q (with
+         * the length of the seed in ik.info), or returns false if no search
+         * should start at @x.
+         */
+        using Seeder = std::function<bool(const uint8_t* q, int len, int x, bwtintv_t& ik)>;
+
+        SMEMBatch(const bwt_t* bwt, uint32_t numInFlight);
+        ~SMEMBatch();
+
+        SMEMBatch(const SMEMBatch&) = delete;
+        SMEMBatch& operator=(const SMEMBatch&) = delete;
+
+        /** Remove all of the queries (the buffers are kept for reuse). */
+        void clear();
+
+        /** Add a query (in ASCII); it is encoded and copied into the batch. */
+        size_t add(const std::string& seq);
+
+        /**
+         * Find the SMEMs of every query, keeping those of length at least
+         * @minSeedLen.  Without a @seeder, each search starts from the
+         * interval of a single base.
+         */
+        void search(int minIntv, int minSeedLen, const Seeder& seeder = nullptr);
+
+        size_t size() const { return numQueries_; }
+        const uint8_t* query(size_t i) const { return reinterpret_cast<const uint8_t*>(cursors_[i].seq.data()); }
+        int queryLength(size_t i) const { return static_cast<int>(cursors_[i].seq.size()); }
+        /** The SMEMs of query @i, sorted by their start in the query. */
+        const bwtintv_v& mems(size_t i) const { return cursors_[i].mems; }
+
+    private:
+        enum class Phase : uint8_t { START, FORWARD, BACKWARD, DONE };
+
+        struct Cursor {
+            std::string seq; // the encoded query
+            Phase phase{Phase::START};
+            int x{0}; // where the current search started
+            int i{0}; // the current position of the search
+            size_t j{0}; // the next interval (of prev) to extend backward
+            int ret{0}; // where the next search will start
+            int prev{0}; // which of ivs is the previous set of intervals
+            bwtintv_t ik;
+            bwtintv_v ivs[2]; // the intervals of the current search
+            bwtintv_v mem1; // the SMEMs of the current search
+            bwtintv_v mems; // all of the SMEMs found so far
+        };
+
+        bool step_(Cursor& c, int minIntv, int minSeedLen, const Seeder& seeder);
+        void prefetch_(const Cursor& c) const;
+
+        const bwt_t* bwt_;
+        uint32_t numInFlight_;
+        size_t numQueries_{0};
+        std::vector<Cursor> cursors_;
+        std::vector<size_t> active_;
+    };
 }
 
 #endif // __BWA_UTILS_HPP__
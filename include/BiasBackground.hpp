@@ -0,0 +1,165 @@
+#ifndef __BIAS_BACKGROUND_HPP__
+#define __BIAS_BACKGROUND_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "DistributionUtils.hpp"
+#include "GCFragModel.hpp"
+#include "SBModel.hpp"
+#include "SimplePosBias.hpp"
+
+/**
+ * The expected (background) distributions of the sequence-specific,
+ * fragment-GC and positional bias models: what they would look like if the
+ * fragments were drawn uniformly from the transcripts, in proportion to the
+ * transcripts' abundances.
+ *
+ * The background is a sum over the transcripts, each weighted by its
+ * abundance over its effective length, so one that was computed from the
+ * online abundance estimates (while the rest of the reads are still being
+ * mapped) can later be brought up to date with the offline estimates by
+ * adding in the *change* in weight of just those transcripts whose weight
+ * changed by more than `weightTolerance`.  This is only done if the
+ * fragment length distribution (which the background also depends on) has
+ * moved by less than `fldTolerance` in the meantime.
+ */
+class BiasBackground {
+public:
+    static constexpr double weightTolerance = 0.05;
+    static constexpr double fldTolerance = 0.01;
+    static constexpr size_t numLengthClasses = 5;
+
+    /** The expected counts; these can be summed (e.g. over threads). */
+    struct Counts {
+        Counts(size_t numCondBins, size_t numGCBins) :
+            gc(numCondBins, numGCBins, distribution_utils::DistributionSpace::LINEAR),
+            pos5(numLengthClasses, std::vector<double>(SimplePosBias().numBins(), 0.0)),
+            pos3(numLengthClasses, std::vector<double>(SimplePosBias().numBins(), 0.0)) {}
+
+        void combine(const Counts& other) {
+            seqFW.combineCounts(other.seqFW);
+            seqRC.combineCounts(other.seqRC);
+            gc.combineCounts(other.gc);
+            for (size_t c = 0; c < numLengthClasses; ++c) {
+                for (size_t b = 0; b < pos5[c].size(); ++b) {
+                    pos5[c][b] += other.pos5[c][b];
+                    pos3[c][b] += other.pos3[c][b];
+                }
+            }
+        }
+
+        /** The positional masses `pos` as (unfinalized) positional models. */
+        static std::vector<SimplePosBias> posBias(const std::vector<std::vector<double>>& pos) {
+            std::vector<SimplePosBias> models(numLengthClasses);
+            for (size_t c = 0; c < numLengthClasses; ++c) {
+                for (size_t b = 0; b < pos[c].size(); ++b) {
+                    if (pos[c][b] > 0.0) { models[c].addMass(b, std::log(pos[c][b])); }
+                }
+            }
+            return models;
+        }
+
+        SBModel seqFW;
+        SBModel seqRC;
+        GCFragModel gc;
+        // The positional masses of each length class; unlike SimplePosBias,
+        // these are kept in linear space, so that a change in weight can
+        // take mass away.
+        std::vector<std::vector<double>> pos5;
+        std::vector<std::vector<double>> pos3;
+    };
+
+    BiasBackground(size_t numCondBins, size_t numGCBins) :
+        counts(numCondBins, numGCBins) {}
+
+    BiasBackground(const BiasBackground&) = delete;
+    BiasBackground& operator=(const BiasBackground&) = delete;
+
+    /** Whether `counts`, `weights` and `fldPDF` have been filled in. */
+    bool ready() const { return ready_; }
+    void setReady() { ready_ = true; }
+
+    /**
+     * The total variation distance between `pdf` and the fragment length
+     * distribution that the background was computed with.
+     */
+    double fldDistance(const std::vector<double>& pdf) const {
+        double dist{0.0};
+        size_t n = std::max(pdf.size(), fldPDF.size());
+        for (size_t i = 0; i < n; ++i) {
+            double a = (i < pdf.size()) ? pdf[i] : 0.0;
+            double b = (i < fldPDF.size()) ? fldPDF[i] : 0.0;
+            dist += std::abs(a - b);
+        }
+        return 0.5 * dist;
+    }
+
+    /**
+     * Given the current weight of each transcript, return the change in
+     * weight to add into `counts` (0 for the transcripts whose weight has
+     * hardly changed), and record the new weights.  Only the relative
+     * weights matter, so the new weights are first brought to the scale of
+     * the old ones, by the median ratio between the two; that way, a few
+     * transcripts whose weight changed a lot don't make every other weight
+     * look changed.  The largest relative change in weight that is left
+     * out is recorded in `maxWeightDeviation`.
+     */
+    std::vector<double> reweigh(const std::vector<double>& newWeights, size_t& numChanged) {
+        std::vector<double> ratios;
+        double oldTotal{0.0};
+        double newTotal{0.0};
+        for (size_t i = 0; i < newWeights.size(); ++i) {
+            oldTotal += weights[i];
+            newTotal += newWeights[i];
+            if (weights[i] > 0.0 and newWeights[i] > 0.0) {
+                ratios.push_back(weights[i] / newWeights[i]);
+            }
+        }
+        double scale = (newTotal > 0.0) ? oldTotal / newTotal : 0.0;
+        if (!ratios.empty()) {
+            auto mid = ratios.begin() + ratios.size() / 2;
+            std::nth_element(ratios.begin(), mid, ratios.end());
+            scale = *mid;
+        }
+
+        std::vector<double> delta(newWeights.size(), 0.0);
+        numChanged = 0;
+        maxWeightDeviation = 0.0;
+        for (size_t i = 0; i < newWeights.size(); ++i) {
+            double w = newWeights[i] * scale;
+            double d = w - weights[i];
+            double m = std::max(w, weights[i]);
+            if (std::abs(d) > weightTolerance * m) {
+                delta[i] = d;
+                weights[i] = w;
+                ++numChanged;
+            } else if (m > 0.0) {
+                maxWeightDeviation = std::max(maxWeightDeviation, std::abs(d) / m);
+            }
+        }
+        return delta;
+    }
+
+    Counts counts;
+    // The weight that each transcript was added with
+    std::vector<double> weights;
+    // The (non-logged) fragment length pdf that the background used
+    std::vector<double> fldPDF;
+    // Whether the background was brought up to date (rather than computed
+    // afresh) for the final effective lengths and, if so, how far it is
+    // from the exact one: the largest relative change in the weight of a
+    // transcript that was left out, and the fldDistance() to the final
+    // fragment length distribution.
+    bool used{false};
+    double maxWeightDeviation{0.0};
+    double fldDeviation{0.0};
+
+private:
+    std::atomic<bool> ready_{false};
+};
+
+#endif // __BIAS_BACKGROUND_HPP__
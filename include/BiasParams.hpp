@@ -1,6 +1,7 @@
 #ifndef __BIAS_PARAMS__
 #define __BIAS_PARAMS__
 
+#include "AuxModelTracker.hpp"
 #include "SBModel.hpp"
 #include "GCFragModel.hpp"
 #include "ReadKmerDist.hpp"
@@ -34,6 +35,11 @@ struct BiasParams {
     SBModel seqBiasModelFW;
     SBModel seqBiasModelRC;
 
+  /**
+   * How far this thread's models have moved lately
+   **/
+    AuxModelTracker::ThreadState auxModelState;
+
   BiasParams(size_t numCondBins=3,
 	     size_t numGCBins=101,
 	     bool seqBiasPseudocount=false) : seqBiasFW(seqBiasPseudocount), seqBiasRC(seqBiasPseudocount),
@@ -2,58 +2,58 @@
 #define __CLUSTER_FOREST_HPP__
 
 
-#include <boost/pending/disjoint_sets.hpp>
+#include "tbb/enumerable_thread_specific.h"
 
 #include "Transcript.hpp"
 #include "TranscriptCluster.hpp"
-#include "SalmonSpinLock.hpp"
+#include "SalmonUtils.hpp"
 
-#include <unordered_set>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <unordered_map>
 #include <vector>
-#include <mutex>
 
-/** A forest of transcript clusters */
+/**
+ * A forest of transcript clusters.
+ *
+ * The clusters are kept in a concurrent union-find structure; linking is
+ * done with a compare-and-swap on the parent of a root, and finds compress
+ * paths (by path halving) as they go, so that merging the clusters of a
+ * multi-mapping fragment never takes a lock.  The hit counts and masses
+ * are accumulated, per thread, on the transcript named in the update (so
+ * that threads hitting the same, highly expressed, transcripts don't fight
+ * over its cache line); a thread only keeps entries for the transcripts it
+ * has updated since the last getClusters(), so the accumulators take space
+ * in proportion to the transcripts hit, not numTranscripts per thread.  The
+ * clusters themselves --- their members and totals, which fold in every
+ * thread's accumulators --- are only materialized when getClusters() is
+ * called.
+ */
 class ClusterForest {
 public:
     ClusterForest(size_t numTranscripts, std::vector<Transcript>& refs) :
-        rank_(std::vector<size_t>(numTranscripts, 0)),
-        parent_(std::vector<size_t>(numTranscripts, 0)),
-        disjointSets_(&rank_[0], &parent_[0]),
-        clusters_(std::vector<TranscriptCluster>(numTranscripts))
+        parent_(numTranscripts),
+        counts_(numTranscripts, 0.0),
+        logMasses_(numTranscripts),
+        clusters_(numTranscripts)
     {
         // Initially make a unique set for each transcript
         for(size_t tnum = 0; tnum < numTranscripts; ++tnum) {
-            disjointSets_.make_set(tnum);
-            clusters_[tnum].members_.push_front(tnum);
-            clusters_[tnum].addMass(refs[tnum].mass());
+            parent_[tnum].store(tnum);
+            logMasses_[tnum] = refs[tnum].mass();
         }
     }
 
     template <typename FragT>
     void mergeClusters(typename std::vector<FragT>::iterator start,
                        typename std::vector<FragT>::iterator finish) {
-        // Use a lock_guard to ensure this is a locked (and exception-safe) operation
-#if defined __APPLE__
-        spin_lock::scoped_lock sl(clusterMutex_);
-#else
-        std::lock_guard<std::mutex> lock(clusterMutex_);
-#endif
-        size_t firstCluster, otherCluster;
+        auto& cache = mergeCache_.local();
         auto firstTranscriptID = start->transcriptID();
         ++start;
 
         for (auto it = start; it != finish; ++it) {
-            firstCluster = disjointSets_.find_set(firstTranscriptID);
-            otherCluster = disjointSets_.find_set(it->transcriptID());
-            if (otherCluster != firstCluster)  {
-                disjointSets_.link(firstCluster, otherCluster);
-                auto parentClust = disjointSets_.find_set(it->transcriptID());
-                auto childClust = (parentClust == firstCluster)  ? otherCluster : firstCluster;
-                if (parentClust == firstCluster or parentClust == otherCluster) {
-                    clusters_[parentClust].merge(clusters_[childClust]);
-                    clusters_[childClust].deactivate();
-                } else { std::cerr << "DANGER\n"; }
-            }
+            merge_(cache, firstTranscriptID, it->transcriptID());
         }
     }
 
@@ -61,97 +61,123 @@ public:
     template <typename FragT>
     void mergeClusters(typename std::vector<FragT*>::iterator start,
                        typename std::vector<FragT*>::iterator finish) {
-        // Use a lock_guard to ensure this is a locked (and exception-safe) operation
-#if defined __APPLE__
-        spin_lock::scoped_lock sl(clusterMutex_);
-#else
-        std::lock_guard<std::mutex> lock(clusterMutex_);
-#endif
-
+        auto& cache = mergeCache_.local();
         auto firstTranscriptID = (*start)->transcriptID();
-        decltype(firstTranscriptID) firstCluster, otherCluster;
         ++start;
 
         for (auto it = start; it != finish; ++it) {
-            firstCluster = disjointSets_.find_set(firstTranscriptID);
-            otherCluster = disjointSets_.find_set((*it)->transcriptID());
-            if (otherCluster != firstCluster)  {
-                disjointSets_.link(firstCluster, otherCluster);
-                auto parentClust = disjointSets_.find_set((*it)->transcriptID());
-                auto childClust = (parentClust == firstCluster)  ? otherCluster : firstCluster;
-                if (parentClust == firstCluster or parentClust == otherCluster) {
-                    clusters_[parentClust].merge(clusters_[childClust]);
-                    clusters_[childClust].deactivate();
-                } else { std::cerr << "DANGER\n"; }
-            }
+            merge_(cache, firstTranscriptID, (*it)->transcriptID());
         }
     }
 
-
-    /*
-    void mergeClusters(AlignmentBatch<ReadPair>::iterator start, AlignmentBatch<ReadPair>::iterator finish) {
-        // Use a lock_guard to ensure this is a locked (and exception-safe) operation
-        std::lock_guard<std::mutex> lock(clusterMutex_);
-        size_t firstCluster, otherCluster;
-        auto firstTranscriptID = start->read1->core.tid;
-        ++start;
-
-        for (auto it = start; it != finish; ++it) {
-            firstCluster = disjointSets_.find_set(firstTranscriptID);
-            otherCluster = disjointSets_.find_set(it->read1->core.tid);
-            if (otherCluster != firstCluster)  {
-                disjointSets_.link(firstCluster, otherCluster);
-                auto parentClust = disjointSets_.find_set(it->read1->core.tid);
-                auto childClust = (parentClust == firstCluster)  ? otherCluster : firstCluster;
-                if (parentClust == firstCluster or parentClust == otherCluster) {
-                    clusters_[parentClust].merge(clusters_[childClust]);
-                    clusters_[childClust].deactivate();
-                } else { std::cerr << "DANGER\n"; }
-            }
-        }
-    }
-*/
     void updateCluster(size_t memberTranscript, size_t newCount, double logNewMass, bool updateCount) {
-        // Use a lock_guard to ensure this is a locked (and exception-safe) operation
-#if defined __APPLE__
-        spin_lock::scoped_lock sl(clusterMutex_);
-#else
-        std::lock_guard<std::mutex> lock(clusterMutex_);
-#endif
-        auto clusterID = disjointSets_.find_set(memberTranscript);
-        auto& cluster = clusters_[clusterID];
+        auto& total = accumulators_.local()[memberTranscript];
         if (updateCount) {
-            cluster.incrementCount(newCount);
+            total.count += newCount;
         }
-        cluster.addMass(logNewMass);
+        total.logMass = salmon::math::logAdd(total.logMass, logNewMass);
     }
 
+    /**
+     * Materialize the current clusters; this must not be called
+     * concurrently with mergeClusters() or updateCluster().
+     */
     std::vector<TranscriptCluster*> getClusters() {
+        for (auto& c : clusters_) { c.reset(); }
+
+        // Fold the threads' accumulators into the transcripts' totals; the
+        // accumulators are then cleared, so that a later call doesn't count
+        // them twice.
+        for (auto& acc : accumulators_) {
+            for (auto& kv : acc) {
+                counts_[kv.first] += kv.second.count;
+                logMasses_[kv.first] = salmon::math::logAdd(logMasses_[kv.first],
+                                                            kv.second.logMass);
+            }
+        }
+        accumulators_.clear();
+
         std::vector<TranscriptCluster*> clusters;
-        std::unordered_set<size_t> observedReps;
         for (size_t i = 0; i < clusters_.size(); ++i) {
-            auto rep = disjointSets_.find_set(i);
-            if (observedReps.find(rep) == observedReps.end()) {
-                if (!clusters_[rep].isActive()) {
-                    std::cerr << "returning a non-active cluster!\n";
-                    std::exit(1);
-                }
-                clusters.push_back(&clusters_[rep]);
-                observedReps.insert(rep);
+            auto rep = find_(i);
+            auto& cluster = clusters_[rep];
+            if (cluster.members_.empty()) {
+                clusters.push_back(&cluster);
             }
+            cluster.members_.push_back(i);
+            cluster.incrementCount(counts_[i]);
+            cluster.addMass(logMasses_[i]);
         }
         return clusters;
     }
 private:
-    std::vector<size_t> rank_;
-    std::vector<size_t> parent_;
-    boost::disjoint_sets<size_t*, size_t*> disjointSets_;
+    /** A transcript's (not yet folded in) hit count and log mass. */
+    struct MassTotal {
+        double count{0.0};
+        double logMass{salmon::math::LOG_0};
+    };
+    // One thread's totals, for just the transcripts it has updated
+    using MassAccumulator = std::unordered_map<uint32_t, MassTotal>;
+
+    /**
+     * A small, direct-mapped cache of the (unordered) pairs of transcripts
+     * that this thread has already placed in the same cluster.  Since
+     * clusters are never split, a pair found here needs no further work.
+     */
+    struct MergeCache {
+        static constexpr uint32_t numSlotBits = 10;
+        // No key is ever all 1s (the pairs are of distinct transcripts)
+        MergeCache() { slots.fill(std::numeric_limits<uint64_t>::max()); }
+        std::array<uint64_t, (1u << numSlotBits)> slots;
+    };
+
+    void merge_(MergeCache& cache, uint32_t t1, uint32_t t2) {
+        if (t1 == t2) { return; }
+        uint64_t key = (t1 < t2) ? ((static_cast<uint64_t>(t1) << 32) | t2)
+                                 : ((static_cast<uint64_t>(t2) << 32) | t1);
+        auto& slot = cache.slots[(key * 0x9E3779B97F4A7C15ULL) >> (64 - MergeCache::numSlotBits)];
+        if (slot == key) { return; }
+        union_(t1, t2);
+        slot = key;
+    }
+
+    uint32_t find_(uint32_t x) {
+        while (true) {
+            uint32_t p = parent_[x].load(std::memory_order_acquire);
+            if (p == x) { return x; }
+            uint32_t gp = parent_[p].load(std::memory_order_acquire);
+            // Path halving; if this fails, someone else has already
+            // updated x's parent, which is fine.
+            if (gp != p) {
+                parent_[x].compare_exchange_weak(p, gp, std::memory_order_release,
+                                                 std::memory_order_relaxed);
+            }
+            x = gp;
+        }
+    }
+
+    void union_(uint32_t t1, uint32_t t2) {
+        while (true) {
+            uint32_t r1 = find_(t1);
+            uint32_t r2 = find_(t2);
+            if (r1 == r2) { return; }
+            // Always link the root with the larger id below the other one,
+            // so that concurrent links can't form a cycle.
+            if (r1 < r2) { std::swap(r1, r2); }
+            uint32_t expected = r1;
+            if (parent_[r1].compare_exchange_strong(expected, r2, std::memory_order_acq_rel)) {
+                return;
+            }
+            // r1 was linked below some other root in the meantime; try again
+        }
+    }
+
+    std::vector<std::atomic<uint32_t>> parent_;
+    std::vector<double> counts_;
+    std::vector<double> logMasses_;
     std::vector<TranscriptCluster> clusters_;
-    #if defined __APPLE__
-    spin_lock clusterMutex_;
-    #else
-    std::mutex clusterMutex_;
-    #endif
+    tbb::enumerable_thread_specific<MergeCache> mergeCache_;
+    tbb::enumerable_thread_specific<MassAccumulator> accumulators_;
 };
 
 #endif // __CLUSTER_FOREST_HPP__
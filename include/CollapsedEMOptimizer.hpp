@@ -36,4 +36,28 @@ class CollapsedEMOptimizer {
                 uint32_t maxIter);
 };
 
+namespace salmon {
+namespace detail {
+/**
+ * Not part of the API; declared here only so that salmon_bench can time it
+ * on its own.
+ *
+ * Draw bootstrap samples (until bsNum reaches sopt.numBootstraps), estimating
+ * abundances for each with the (VB)EM algorithm, and pass each result (along
+ * with its replicate number) to writeBootstrap.  This is the work done by
+ * each thread in CollapsedEMOptimizer::gatherBootstraps().
+ */
+bool doBootstrap(
+    std::vector<std::vector<uint32_t>>& txpGroups,
+    std::vector<std::vector<double>>& txpGroupCombinedWeights,
+    std::vector<Transcript>& transcripts, Eigen::VectorXd& effLens,
+    std::vector<double>& sampleWeights, uint64_t totalNumFrags,
+    uint64_t numMappedFrags, double uniformTxpWeight,
+    std::atomic<uint32_t>& bsNum, SalmonOpts& sopt,
+    std::vector<double>& priorAlphas,
+    std::function<void(uint32_t, const std::vector<double>&)>& writeBootstrap,
+    double relDiffTolerance, uint32_t maxIter);
+}
+}
+
 #endif // COLLAPSED_EM_OPTIMIZER_HPP
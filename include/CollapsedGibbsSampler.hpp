@@ -3,6 +3,7 @@
 
 #include <unordered_map>
 #include <functional>
+#include <vector>
 
 #include "tbb/atomic.h"
 #include "tbb/task_scheduler_init.h"
@@ -26,5 +27,40 @@ class CollapsedGibbsSampler {
                       uint32_t numSamples = 500);
 };
 
+class Transcript;
+class TranscriptGroup;
+struct TGValue;
+class MultinomialSampler;
+
+namespace salmon {
+namespace detail {
+/**
+ * Not part of the API: the building blocks of CollapsedGibbsSampler::sample(),
+ * declared here only so that salmon_bench can time them on their own.
+ */
+
+// Draw the initial assignment of each class' fragments to its transcripts
+void initCountMap_(
+        std::vector<std::pair<const TranscriptGroup, TGValue>>& eqVec,
+        std::vector<Transcript>& transcriptsIn,
+        double priorAlpha,
+        MultinomialSampler& msamp,
+        std::vector<uint64_t>& countMap,
+        std::vector<double>& probMap,
+        Eigen::VectorXd& effLens,
+        std::vector<int>& txpCounts);
+
+// Perform one round of (partial) re-sampling of the fragment assignments
+void sampleRound_(
+        std::vector<std::pair<const TranscriptGroup, TGValue>>& eqVec,
+        std::vector<uint64_t>& countMap,
+        std::vector<double>& probMap,
+        Eigen::VectorXd& effLens,
+        double priorAlpha,
+        std::vector<int>& txpCount,
+        MultinomialSampler& msamp);
+}
+}
+
 #endif // COLLAPSED_EM_OPTIMIZER_HPP
 
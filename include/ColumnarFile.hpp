@@ -0,0 +1,174 @@
+#ifndef __COLUMNAR_FILE_HPP__
+#define __COLUMNAR_FILE_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A simple, self-describing binary columnar file format, used as an
+ * (optional) alternative to salmon's text outputs.
+ *
+ * Layout (all numbers, in the columns and in the footer, are stored
+ * little-endian; on a big-endian host they are byte-swapped on the way in
+ * and out):
+ *
+ *   [ magic (8 bytes) ]
+ *   [ column 0 data ] [ column 1 data ] ... [ column n-1 data ]
+ *   [ footer ]
+ *   [ footer offset (uint64_t) ] [ magic (8 bytes) ]
+ *
+ * Each column is stored (and compressed) independently, so that a reader
+ * can load just the columns it needs.  Numeric columns are stored as
+ * fixed-width arrays.  A string column is stored as a table of
+ * (numRows + 1) uint64_t offsets followed by the concatenated characters.
+ * The footer is the index; for every column it records the name, type,
+ * number of rows, location, and stored / uncompressed sizes.
+ */
+namespace salmon {
+namespace columnar {
+
+enum class ColumnType : uint8_t {
+    UINT32 = 0,
+    UINT64 = 1,
+    INT32 = 2,
+    FLOAT64 = 3,
+    STRING = 4
+};
+
+template <typename T> struct ColumnTypeOf;
+template <> struct ColumnTypeOf<uint32_t> { static constexpr ColumnType value = ColumnType::UINT32; };
+template <> struct ColumnTypeOf<uint64_t> { static constexpr ColumnType value = ColumnType::UINT64; };
+template <> struct ColumnTypeOf<int32_t> { static constexpr ColumnType value = ColumnType::INT32; };
+template <> struct ColumnTypeOf<double> { static constexpr ColumnType value = ColumnType::FLOAT64; };
+
+/** The width in bytes of a value of a numeric column of type `type`. */
+size_t valueWidth(ColumnType type);
+
+/**
+ * Convert the `len / width` values of `width` bytes each in `data` between
+ * host order and little-endian (in either direction); a no-op on
+ * little-endian hosts.
+ */
+void convertLittleEndian(char* data, size_t len, size_t width);
+
+/**
+ * The footer entry describing a single column.
+ */
+struct ColumnInfo {
+    std::string name;
+    ColumnType type;
+    bool compressed;
+    uint64_t numRows;
+    uint64_t offset;       // file offset of the stored data
+    uint64_t storedSize;   // size of the data as stored in the file
+    uint64_t rawSize;      // size of the data after decompression
+};
+
+/**
+ * Writes a columnar file.  Columns are written to disk as they are
+ * added (so, e.g., bootstrap replicates can be streamed), and the
+ * footer is written by close() (or on destruction).
+ */
+class ColumnarWriter {
+public:
+    /**
+     * Create the file `path`; `compressionLevel` is a zlib level
+     * (0 disables compression).  Throws std::runtime_error if the file
+     * cannot be created.
+     */
+    explicit ColumnarWriter(const std::string& path, int compressionLevel = 6);
+    ~ColumnarWriter();
+
+    ColumnarWriter(const ColumnarWriter&) = delete;
+    ColumnarWriter& operator=(const ColumnarWriter&) = delete;
+
+    template <typename T>
+    void addColumn(const std::string& name, const std::vector<T>& values) {
+        addColumn_(name, ColumnTypeOf<T>::value, values.size(),
+                   reinterpret_cast<const char*>(values.data()),
+                   values.size() * sizeof(T), sizeof(T));
+    }
+
+    void addColumn(const std::string& name, const std::vector<std::string>& values);
+
+    /**
+     * Write the footer and close the file.  No columns may be added
+     * after this is called.
+     */
+    void close();
+
+    size_t numColumns() const { return columns_.size(); }
+
+private:
+    // `data` is in host order, as values of `width` bytes each
+    void addColumn_(const std::string& name, ColumnType type, uint64_t numRows,
+                    const char* data, size_t len, size_t width);
+
+    std::ofstream out_;
+    int compressionLevel_;
+    std::vector<ColumnInfo> columns_;
+    bool closed_{false};
+};
+
+/**
+ * Provides random access to the columns of a file written by
+ * ColumnarWriter.  Only the footer is read on construction; a column is
+ * read (and decompressed) the first time it is requested, and then kept
+ * in memory so that repeated row lookups are cheap.
+ */
+class ColumnarReader {
+public:
+    /**
+     * Open `path` and read its index.  Throws std::runtime_error if the
+     * file is missing or is not a valid columnar file.
+     */
+    explicit ColumnarReader(const std::string& path);
+
+    const std::vector<ColumnInfo>& columns() const { return columns_; }
+    bool hasColumn(const std::string& name) const;
+    const ColumnInfo& columnInfo(const std::string& name) const;
+
+    /** Return the entire column `name`, which must hold values of type T. */
+    template <typename T>
+    std::vector<T> column(const std::string& name) {
+        const auto& raw = rawColumn_(name, ColumnTypeOf<T>::value);
+        std::vector<T> values(raw.size() / sizeof(T));
+        if (!values.empty()) { std::memcpy(&values[0], raw.data(), raw.size()); }
+        return values;
+    }
+
+    /** Return the value in row `row` of column `name`. */
+    template <typename T>
+    T value(const std::string& name, size_t row) {
+        const auto& raw = rawColumn_(name, ColumnTypeOf<T>::value);
+        if ((row + 1) * sizeof(T) > raw.size()) {
+            throw std::out_of_range("row " + std::to_string(row) + " is out of range for column " + name);
+        }
+        T v;
+        std::memcpy(&v, raw.data() + row * sizeof(T), sizeof(T));
+        return v;
+    }
+
+    std::vector<std::string> stringColumn(const std::string& name);
+    std::string stringValue(const std::string& name, size_t row);
+
+private:
+    const std::vector<char>& rawColumn_(const std::string& name, ColumnType type);
+
+    std::ifstream in_;
+    std::string path_;
+    std::vector<ColumnInfo> columns_;
+    std::unordered_map<std::string, size_t> columnIndex_;
+    // The columns read so far, in host order
+    std::unordered_map<std::string, std::vector<char>> cache_;
+};
+
+}
+}
+
+#endif // __COLUMNAR_FILE_HPP__
@@ -17,9 +17,11 @@ enum class DistributionSpace : uint8_t { LOG = 0, LINEAR = 1 };
    *  \param fld A pointer to the FragmentLengthDistribution from which 
    *             samples will be drawn.
    *  \param numSamples  The number of samples to draw.
+   *  \param seed  The seed of the run (the samples are drawn from its
+   *              FLD_SAMPLES stream).
    */ 
 std::vector<int32_t> samplesFromLogPMF(FragmentLengthDistribution* fld,
-                                       int32_t numSamples);
+                                       int32_t numSamples, uint64_t seed);
 
   /**
    * The following two functions compute conditional means of the empirical fragment length 
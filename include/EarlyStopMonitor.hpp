@@ -0,0 +1,177 @@
+#ifndef __EARLY_STOP_MONITOR_HPP__
+#define __EARLY_STOP_MONITOR_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "cereal/archives/json.hpp"
+#include "spdlog/spdlog.h"
+
+#include "EquivalenceClassBuilder.hpp"
+#include "SalmonMath.hpp"
+#include "Transcript.hpp"
+
+/**
+ * Decides when the online phase has seen enough fragments that reading
+ * the rest of the input is unlikely to change the estimates.
+ *
+ * Every `checkInterval` assigned fragments (once burn-in is complete), one
+ * of the worker threads compares the current online estimates of the
+ * fraction of fragments coming from each transcript with those at the
+ * previous check, and counts the equivalence classes discovered since
+ * then.  Once, for `numStableChecks` checks in a row, the estimates have
+ * moved by less than `tolerance` (in total variation distance) and fewer
+ * than `tolerance` new equivalence classes were discovered per fragment,
+ * the monitor asks that no more input be read.
+ *
+ * The largest change seen over those last checks is reported (in
+ * meta_info.json) as the estimated error of the abundances, along with the
+ * fraction of the input that was read.
+ */
+class EarlyStopMonitor {
+public:
+    static constexpr uint64_t checkInterval = 1000000;
+    static constexpr uint32_t numStableChecks = 3;
+
+    EarlyStopMonitor(double tolerance, uint64_t minFragments) :
+        tolerance_(tolerance),
+        nextCheck_(std::max(minFragments, uint64_t(checkInterval))) {}
+
+    EarlyStopMonitor(const EarlyStopMonitor&) = delete;
+    EarlyStopMonitor& operator=(const EarlyStopMonitor&) = delete;
+
+    bool stopped() const { return stopped_; }
+
+    /**
+     * Called by the worker threads as they assign fragments; returns true
+     * if no more input should be read.  This is cheap unless a check is
+     * due, and at most one thread performs any given check.
+     */
+    bool check(uint64_t numAssignedFragments, std::vector<Transcript>& transcripts,
+               EquivalenceClassBuilder& eqBuilder, spdlog::logger* log) {
+        if (stopped_) { return true; }
+        if (numAssignedFragments < nextCheck_) { return false; }
+        std::unique_lock<std::mutex> l(mutex_, std::try_to_lock);
+        if (!l.owns_lock() or numAssignedFragments < nextCheck_) { return stopped_; }
+        nextCheck_ = numAssignedFragments + checkInterval;
+
+        // The fraction of fragments assigned to each transcript (the
+        // masses are updated concurrently, which is fine for this purpose)
+        using salmon::math::LOG_0;
+        size_t numTranscripts = transcripts.size();
+        std::vector<double> fracs(numTranscripts);
+        double logTotalMass{LOG_0};
+        for (size_t i = 0; i < numTranscripts; ++i) {
+            fracs[i] = transcripts[i].mass(false);
+            logTotalMass = salmon::math::logAdd(logTotalMass, fracs[i]);
+        }
+        if (logTotalMass == LOG_0) { return false; }
+        for (auto& f : fracs) { f = std::exp(f - logTotalMass); }
+
+        // Classes merged or dropped to bound memory were still discovered
+        uint64_t numClasses = eqBuilder.numEqClasses() + eqBuilder.numDroppedClasses() +
+            eqBuilder.numMergedClasses();
+        ++numChecks_;
+
+        if (prevFracs_.size() == numTranscripts) {
+            double change{0.0};
+            for (size_t i = 0; i < numTranscripts; ++i) {
+                change += std::abs(fracs[i] - prevFracs_[i]);
+            }
+            change *= 0.5;
+            uint64_t newClasses = (numClasses > prevNumClasses_) ? numClasses - prevNumClasses_ : 0;
+            double newClassRate = static_cast<double>(newClasses) /
+                                  (numAssignedFragments - prevNumAssigned_);
+
+            lastChange_ = change;
+            lastNewClassRate_ = newClassRate;
+            if (change < tolerance_ and newClassRate < tolerance_) {
+                recentChanges_.push_back(change);
+                if (recentChanges_.size() >= numStableChecks) {
+                    estimatedError_ = *std::max_element(recentChanges_.begin(),
+                                                        recentChanges_.end());
+                    numFragmentsUsed_ = numAssignedFragments;
+                    stopped_ = true;
+                    if (log) {
+                        log->info("The abundance estimates have converged (estimated "
+                                  "error = {}) after {} assigned fragments; no more "
+                                  "input will be read", estimatedError_, numAssignedFragments);
+                    }
+                }
+            } else {
+                recentChanges_.clear();
+            }
+        }
+        prevFracs_.swap(fracs);
+        prevNumClasses_ = numClasses;
+        prevNumAssigned_ = numAssignedFragments;
+        return stopped_;
+    }
+
+    /**
+     * Record that `bytesConsumed` of the `files` of a read library were
+     * read.  The fraction of the input used can only be known if all of
+     * the input files are regular files.
+     */
+    void addInput(const std::vector<std::string>& files, uint64_t bytesConsumed) {
+        std::lock_guard<std::mutex> l(mutex_);
+        for (auto& f : files) {
+            boost::system::error_code ec;
+            if (boost::filesystem::is_regular_file(f, ec)) {
+                inputBytes_ += boost::filesystem::file_size(f, ec);
+            } else {
+                inputSizeKnown_ = false;
+            }
+        }
+        bytesConsumed_ += bytesConsumed;
+    }
+
+    /** Write the outcome as the fields of a JSON object. */
+    template <typename Archive>
+    void save(Archive& ar) const {
+        ar(cereal::make_nvp("tolerance", tolerance_));
+        ar(cereal::make_nvp("stopped_early", stopped_.load()));
+        ar(cereal::make_nvp("num_checks", numChecks_));
+        if (stopped_) {
+            ar(cereal::make_nvp("num_assigned_fragments_used", numFragmentsUsed_));
+            ar(cereal::make_nvp("estimated_error", estimatedError_));
+        } else {
+            ar(cereal::make_nvp("last_change", lastChange_));
+        }
+        ar(cereal::make_nvp("last_new_eq_class_rate", lastNewClassRate_));
+        if (inputSizeKnown_ and inputBytes_ > 0) {
+            double frac = std::min(1.0, static_cast<double>(bytesConsumed_) / inputBytes_);
+            ar(cereal::make_nvp("fraction_of_input_used", frac));
+        }
+    }
+
+private:
+    double tolerance_;
+    std::atomic<uint64_t> nextCheck_;
+    std::atomic<bool> stopped_{false};
+    std::mutex mutex_;
+
+    std::vector<double> prevFracs_;
+    uint64_t prevNumClasses_{0};
+    uint64_t prevNumAssigned_{0};
+    uint64_t numChecks_{0};
+    std::deque<double> recentChanges_;
+    double lastChange_{1.0};
+    double lastNewClassRate_{1.0};
+    double estimatedError_{1.0};
+    uint64_t numFragmentsUsed_{0};
+
+    uint64_t inputBytes_{0};
+    uint64_t bytesConsumed_{0};
+    bool inputSizeKnown_{true};
+};
+
+#endif // __EARLY_STOP_MONITOR_HPP__
@@ -1,11 +1,14 @@
 #ifndef EQUIVALENCE_CLASS_BUILDER_HPP
 #define EQUIVALENCE_CLASS_BUILDER_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <unordered_map>
 #include <vector>
 #include <thread>
 #include <memory>
 #include <mutex>
+#include <numeric>
 
 // Logger includes
 #include "spdlog/spdlog.h"
@@ -67,6 +70,7 @@ class EquivalenceClassBuilder {
         EquivalenceClassBuilder(std::shared_ptr<spdlog::logger> loggerIn) :
 		logger_(loggerIn) {
             countMap_.reserve(1000000);
+            reassignedMass_ = 0.0;
         }
 
         ~EquivalenceClassBuilder() {}
@@ -87,9 +91,107 @@ class EquivalenceClassBuilder {
 			  "for further processing", countVec_.size());
             logger_->info("Counted {} total reads in the equivalence classes ",
                     totalCount);
+            if (numMergedClasses_ > 0) {
+                logger_->warn("To bound memory, {} rarely-observed equivalence classes "
+                              "(containing {} fragments) were merged into classes "
+                              "with one fewer target; this moved {:.1f} fragments' "
+                              "worth of probability off of the left-out targets",
+                              numMergedClasses_.load(), numMergedFragments_.load(),
+                              reassignedMass_.load());
+            }
+            if (numDroppedClasses_ > 0) {
+                logger_->warn("To bound memory, {} rarely-observed equivalence classes "
+                              "(containing {} fragments) were dropped",
+                              numDroppedClasses_.load(), numDroppedFragments_.load());
+            }
             return true;
         }
 
+        size_t numEqClasses() const { return countMap_.size(); }
+
+        /**
+         * If there are more than `maxClasses` equivalence classes, remove
+         * those observed the fewest times, so that at most `targetClasses`
+         * remain.  This may be called while fragments are being added; a
+         * class that is removed may (e.g. if it is observed again) be
+         * re-created later, and one that has been observed more often in
+         * the meantime may be kept.  Returns the number of classes removed.
+         */
+        size_t compact(size_t maxClasses, size_t targetClasses) {
+            if (countMap_.size() <= maxClasses) { return 0; }
+
+            std::vector<TranscriptGroup> candidates;
+            uint64_t maxRemovedCount{0};
+            {
+                auto lt = countMap_.lock_table();
+                std::vector<uint64_t> counts;
+                for (auto& kv : lt) { counts.push_back(kv.second.count); }
+                if (counts.size() <= targetClasses) { return 0; }
+                size_t numToRemove = counts.size() - targetClasses;
+                std::nth_element(counts.begin(), counts.begin() + (numToRemove - 1), counts.end());
+                maxRemovedCount = counts[numToRemove - 1];
+                for (auto& kv : lt) {
+                    if (candidates.size() == numToRemove) { break; }
+                    if (kv.second.count <= maxRemovedCount) {
+                        candidates.push_back(kv.first);
+                    }
+                }
+            }
+            return removeClasses_(candidates, maxRemovedCount);
+        }
+
+        /**
+         * Like compact(), but keeps the (estimated) memory used by the
+         * equivalence classes under `maxBytes`; if it is over, about a
+         * quarter of the memory is freed, so that this needn't be done again
+         * right away.
+         */
+        size_t compactToMemory(size_t maxBytes) {
+            size_t numClasses{0};
+            size_t totalBytes{0};
+            {
+                auto lt = countMap_.lock_table();
+                for (auto& kv : lt) {
+                    ++numClasses;
+                    totalBytes += classBytes_(kv.second);
+                }
+            }
+            if (totalBytes <= maxBytes) { return 0; }
+            double keepFrac = 0.75 * static_cast<double>(maxBytes) / totalBytes;
+            size_t targetClasses = static_cast<size_t>(keepFrac * numClasses);
+            return compact(targetClasses, targetClasses);
+        }
+
+        /**
+         * Remove every class observed fewer than `minCount` times; this is
+         * meant to be called once all of the fragments have been added (and
+         * before finish()).  Returns the number of classes removed.
+         */
+        size_t pruneBelow(uint64_t minCount) {
+            if (minCount == 0) { return 0; }
+            std::vector<TranscriptGroup> candidates;
+            {
+                auto lt = countMap_.lock_table();
+                for (auto& kv : lt) {
+                    if (kv.second.count < minCount) {
+                        candidates.push_back(kv.first);
+                    }
+                }
+            }
+            return removeClasses_(candidates, minCount - 1);
+        }
+
+        uint64_t numDroppedClasses() const { return numDroppedClasses_; }
+        uint64_t numDroppedFragments() const { return numDroppedFragments_; }
+        uint64_t numMergedClasses() const { return numMergedClasses_; }
+        uint64_t numMergedFragments() const { return numMergedFragments_; }
+        /**
+         * Of the fragments in merged classes, how many (in expectation,
+         * under their conditional probabilities) came from the target that
+         * was left out of the class they were merged into.
+         */
+        double reassignedMass() const { return reassignedMass_; }
+
         inline void addGroup(TranscriptGroup&& g,
                              std::vector<double>& weights,
 			     std::vector<double>& posWeights) {
@@ -121,10 +223,123 @@ class EquivalenceClassBuilder {
         }
 
     private:
+        // How many of a removed class's targets (those with the least
+        // weight) are tried as the one to leave out when merging it
+        static constexpr size_t maxMergeCandidates = 4;
+
+        static size_t classBytes_(const TGValue& v) {
+            size_t perTarget = sizeof(uint32_t) + sizeof(tbb::atomic<double>) *
+                (v.posWeights.empty() ? 1 : 2);
+            return sizeof(std::pair<TranscriptGroup, TGValue>) + v.weights.size() * perTarget;
+        }
+
+        /**
+         * Take each of the `candidates` that (still) has been observed at
+         * most `maxCount` times out of the map, then fold it into a
+         * near-identical class (its label with one target left out) that is
+         * still in the map, if there is one, and drop it otherwise.
+         *
+         * A class is copied and erased under the same lock, so a fragment
+         * that is added to it concurrently either makes it into the copy
+         * (and so is merged or counted as dropped) or re-creates the class.
+         */
+        size_t removeClasses_(const std::vector<TranscriptGroup>& candidates, uint64_t maxCount) {
+            std::vector<std::pair<TranscriptGroup, TGValue>> removed;
+            for (auto& g : candidates) {
+                countMap_.erase_fn(g, [&](TGValue& v) -> bool {
+                        if (v.count > maxCount) { return false; }
+                        removed.emplace_back(g, v);
+                        return true;
+                    });
+            }
+            for (auto& kv : removed) {
+                uint64_t count = kv.second.count;
+                if (mergeClass_(kv.first, kv.second)) {
+                    ++numMergedClasses_;
+                    numMergedFragments_ += count;
+                } else {
+                    ++numDroppedClasses_;
+                    numDroppedFragments_ += count;
+                }
+            }
+            return removed.size();
+        }
+
+        bool mergeClass_(const TranscriptGroup& g, const TGValue& v) {
+            size_t k = g.txps.size();
+            if (k < 2) { return false; }
+
+            std::vector<double> weights(k);
+            double totalWeight{0.0};
+            for (size_t i = 0; i < k; ++i) {
+                weights[i] = v.weights[i];
+                totalWeight += weights[i];
+            }
+            if (totalWeight <= 0.0) { return false; }
+
+            // Try leaving out the targets with the least weight first
+            std::vector<size_t> order(k);
+            std::iota(order.begin(), order.end(), 0);
+            size_t numCandidates = std::min(k, maxMergeCandidates);
+            std::partial_sort(order.begin(), order.begin() + numCandidates, order.end(),
+                              [&weights](size_t i, size_t j) -> bool {
+                                  return weights[i] < weights[j];
+                              });
+
+            bool hasPos = !v.posWeights.empty();
+            uint64_t count = v.count;
+            for (size_t c = 0; c < numCandidates; ++c) {
+                size_t out = order[c];
+                double sharedWeight = totalWeight - weights[out];
+                if (sharedWeight <= 0.0) { continue; }
+
+                std::vector<uint32_t> txps;
+                txps.reserve(k - 1);
+                for (size_t i = 0; i < k; ++i) {
+                    if (i != out) { txps.push_back(g.txps[i]); }
+                }
+                TranscriptGroup target(txps);
+
+                auto mergefn = [&](TGValue& x) -> void {
+                    // Each fragment's aux weights sum to 1 over its class, so
+                    // the removed class's weights on the targets it shares
+                    // with `x` are rescaled to count for `count` fragments
+                    // again (i.e. each fragment's probability is renormalized
+                    // over the targets that remain).  The positional weights
+                    // need no rescaling: each is a fragment's start position
+                    // probability on one target, whatever else is in its
+                    // class, and they are averaged over the count.
+                    double xWeight{0.0};
+                    for (auto& w : x.weights) { xWeight += w; }
+                    uint64_t xCount = x.count;
+                    double scale = (xWeight > 0.0 and xCount > 0) ?
+                        (xWeight / xCount) * count / sharedWeight : 0.0;
+                    for (size_t i = 0; i < k - 1; ++i) {
+                        size_t src = (i < out) ? i : i + 1;
+                        x.weights[i] = x.weights[i] + scale * weights[src];
+                        if (hasPos and x.posWeights.size() == x.weights.size()) {
+                            x.posWeights[i] = x.posWeights[i] + v.posWeights[src];
+                        }
+                    }
+                    x.count += count;
+                };
+                if (countMap_.update_fn(target, mergefn)) {
+                    salmon::utils::incLoop(reassignedMass_, count * weights[out] / totalWeight);
+                    return true;
+                }
+            }
+            return false;
+        }
+
         std::atomic<bool> active_;
 	    cuckoohash_map<TranscriptGroup, TGValue, TranscriptGroupHasher> countMap_;
         std::vector<std::pair<const TranscriptGroup, TGValue>> countVec_;
     	std::shared_ptr<spdlog::logger> logger_;
+        std::atomic<uint64_t> numDroppedClasses_{0};
+        std::atomic<uint64_t> numDroppedFragments_{0};
+        std::atomic<uint64_t> numMergedClasses_{0};
+        std::atomic<uint64_t> numMergedFragments_{0};
+        tbb::atomic<double> reassignedMass_;
 };
 
 #endif // EQUIVALENCE_CLASS_BUILDER_HPP
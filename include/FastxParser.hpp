@@ -126,6 +126,11 @@ public:
   ReadGroup<T> getReadGroup();
   bool refill(ReadGroup<T>& rg);
   void finishedWithGroup(ReadGroup<T>& s);
+  // Ask the parsing threads to stop reading (e.g. because the consumers
+  // have seen enough); the reads already parsed can still be refilled.
+  void stop() { stopRequested_ = true; }
+  // The number of (possibly compressed) input bytes parsed so far
+  uint64_t bytesConsumed() const { return bytesConsumed_; }
 
 private:
   moodycamel::ProducerToken getProducerToken_();
@@ -135,6 +140,8 @@ private:
   std::vector<std::string> inputStreams2_;
   uint32_t numParsers_;
   std::atomic<uint32_t> numParsing_;
+  std::atomic<bool> stopRequested_{false};
+  std::atomic<uint64_t> bytesConsumed_{0};
   std::vector<std::unique_ptr<std::thread>> parsingThreads_;
   size_t blockSize_;
   moodycamel::ConcurrentQueue<std::unique_ptr<ReadChunk<T>>> readQueue_,
@@ -114,6 +114,18 @@ public:
 
   distribution_utils::DistributionSpace distributionSpace() const { return dspace_; }
 
+    /**
+     * Append the (linear-space) count of every bin to out.
+     */
+    void appendMasses(std::vector<double>& out) const {
+      for (size_t r = 0; r < condBins_; ++r) {
+        for (size_t c = 0; c < numGCBins_; ++c) {
+          double v = counts_(r, c);
+          out.push_back((dspace_ == distribution_utils::DistributionSpace::LOG) ? std::exp(v) : v);
+        }
+      }
+    }
+
     void combineCounts(const GCFragModel& other) {
       if (dspace_ != other.dspace_) {
 	std::cerr << "Cannot combine distributions that live in a different space!\n";
@@ -10,6 +10,7 @@
 #include <boost/iostreams/device/file.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 
+#include "ColumnarFile.hpp"
 #include "SalmonSpinLock.hpp"
 #include "SalmonOpts.hpp"
 #include "ReadExperiment.hpp"
@@ -32,6 +33,18 @@ class GZipWriter {
     const std::string& tstring  = "now"  // the start time of the run
 	);
 
+    /**
+     * (Re-)write aux/meta_info.json; writeMeta() does this, but it can be
+     * called again at the end of the run so that the recorded telemetry
+     * includes any bootstrapping or Gibbs sampling.
+     */
+    template <typename ExpT>
+    bool writeMetaInfo(
+	const SalmonOpts& opts,
+	const ExpT& experiment,
+    const std::string& tstring  = "now"  // the start time of the run
+	);
+
     template <typename ExpT>
     bool writeAbundances(
       const SalmonOpts& sopt,
@@ -45,6 +58,8 @@ class GZipWriter {
      boost::filesystem::path bsPath_;
      std::shared_ptr<spdlog::logger> logger_;
      std::unique_ptr<boost::iostreams::filtering_ostream> bsStream_{nullptr};
+     // Bootstraps in the binary columnar format (if requested)
+     std::unique_ptr<salmon::columnar::ColumnarWriter> bsColumns_{nullptr};
 // only one writer thread at a time
 #if defined __APPLE__
         spin_lock writeMutex_;
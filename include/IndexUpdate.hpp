@@ -0,0 +1,66 @@
+#ifndef __INDEX_UPDATE_HPP__
+#define __INDEX_UPDATE_HPP__
+
+#include <string>
+#include <vector>
+
+namespace salmon {
+namespace index_update {
+
+/**
+ * The transcripts of a quasi-index that has been updated in place (with
+ * `salmon index --addTranscripts/--removeTranscripts`).
+ *
+ * A removed transcript of the original (base) index stays in it, and is
+ * only masked; its name is recorded in <index>/masked.txt.  A removed
+ * transcript that had been added is dropped from the added transcripts
+ * (the index of which, in <index>/delta, is re-built).  So the names of
+ * the added transcripts are distinct, and a name can appear at most
+ * twice: masked in the base index, and added.
+ */
+struct IndexTranscripts {
+    std::vector<std::string> base;
+    std::vector<std::string> maskedBase;
+    std::vector<std::string> added;
+};
+
+/**
+ * What a single update does to an index; if `error` is not empty, the
+ * update must be rejected (and nothing changed).
+ */
+struct UpdatePlan {
+    // base transcripts to mask
+    std::vector<std::string> maskBase;
+    // added transcripts to drop
+    std::vector<std::string> dropAdded;
+    // transcripts to remove that aren't (or are no longer) in the index
+    std::vector<std::string> notFound;
+    std::string error;
+};
+
+/**
+ * Plan the removal of the transcripts named in `remove`, followed by the
+ * addition of those named in `add`.  An added name must not already be in
+ * the index, unless it is (or is being) removed; so a transcript can be
+ * replaced by removing it and adding it again.
+ */
+UpdatePlan planUpdate(const IndexTranscripts& current,
+                      const std::vector<std::string>& remove,
+                      const std::vector<std::string>& add);
+
+/**
+ * Which of the transcripts of an updated index (the `base` ones, followed
+ * by `numAdded` added ones) are masked.  Only base transcripts are masked,
+ * so a name that was removed and then added again resolves to the added
+ * copy.  The names in `maskedBase` that aren't in `base` are placed in
+ * `unknown`.
+ */
+std::vector<bool> maskedTranscripts(const std::vector<std::string>& base,
+                                    size_t numAdded,
+                                    const std::vector<std::string>& maskedBase,
+                                    std::vector<std::string>& unknown);
+
+}
+}
+
+#endif // __INDEX_UPDATE_HPP__
@@ -3,6 +3,7 @@
 
 
 #include "BWAMemStaticFuncs.hpp"
+#include "NumaTopology.hpp"
 #include "RapMapUtils.hpp"
 
 class SMEMAlignment {
@@ -544,20 +545,22 @@ void processMiniBatch(
         FragmentLengthDistribution& fragLengthDist,
         BiasParams& observedGCParams,
         std::atomic<uint64_t>& numAssignedFragments,
-        std::default_random_engine& randEng,
+        salmon::rng::RNG& randEng,
         bool initialRound,
         std::atomic<bool>& burnedIn,
         double& maxZeroFrac
         );
 
+/**
+ *  Turn the MEMs in auxHits->mem (of a read of length @readLen) into
+ *  per-transcript hits.
+ */
 template <typename CoverageCalculator>
-inline void collectHitsForRead(SalmonIndex* sidx, const bwtintv_v* a, smem_aux_t* auxHits,
-                        mem_opt_t* memOptions, const SalmonOpts& salmonOpts, const uint8_t* read, uint32_t readLen,
+inline void collectHitsForMEMs(SalmonIndex* sidx, smem_aux_t* auxHits,
+                        mem_opt_t* memOptions, const SalmonOpts& salmonOpts, uint32_t readLen,
                         std::vector<CoverageCalculator>& hits) {
-                        //std::unordered_map<uint64_t, CoverageCalculator>& hits) {
 
     bwaidx_t* idx = sidx->bwaIndex();
-    mem_collect_intv(salmonOpts, memOptions, sidx, readLen, read, auxHits);
 
     // For each MEM
     int firstSeedLen{-1};
@@ -734,6 +737,36 @@ inline void collectHitsForRead(SalmonIndex* sidx, const bwtintv_v* a, smem_aux_t
     }
 }
 
+template <typename CoverageCalculator>
+inline void collectHitsForRead(SalmonIndex* sidx, const bwtintv_v* a, smem_aux_t* auxHits,
+                        mem_opt_t* memOptions, const SalmonOpts& salmonOpts, const uint8_t* read, uint32_t readLen,
+                        std::vector<CoverageCalculator>& hits) {
+                        //std::unordered_map<uint64_t, CoverageCalculator>& hits) {
+
+    mem_collect_intv(salmonOpts, memOptions, sidx, readLen, read, auxHits);
+    collectHitsForMEMs(sidx, auxHits, memOptions, salmonOpts, readLen, hits);
+}
+
+/**
+ *  As collectHitsForRead, but for the @queryIdx-th query of @smems, whose
+ *  SMEMs have already been found (by mem_collect_intv_batch).
+ */
+template <typename CoverageCalculator>
+inline void collectHitsForQuery(SalmonIndex* sidx, bwautils::SMEMBatch& smems, size_t queryIdx,
+                        smem_aux_t* auxHits, mem_opt_t* memOptions, const SalmonOpts& salmonOpts,
+                        std::vector<CoverageCalculator>& hits) {
+    const uint8_t* read = smems.query(queryIdx);
+    int readLen = smems.queryLength(queryIdx);
+
+    const bwtintv_v& mems = smems.mems(queryIdx);
+    auxHits->mem.n = 0;
+    for (size_t i = 0; i < mems.n; ++i) {
+        kv_push(bwtintv_t, auxHits->mem, mems.a[i]);
+    }
+    mem_collect_extra_intv(salmonOpts, memOptions, sidx, readLen, read, auxHits);
+    collectHitsForMEMs(sidx, auxHits, memOptions, salmonOpts, readLen, hits);
+}
+
 inline bool consistentNames(header_sequence_qual& r) {
     return true;
 }
@@ -802,7 +835,9 @@ inline void getHitsForFragment(
                         uint64_t& upperBoundHits,
                         AlignmentGroup<SMEMAlignment>& hitList,
                         uint64_t& hitListCount,
-                        std::vector<Transcript>& transcripts) {
+                        std::vector<Transcript>& transcripts,
+                        bwautils::SMEMBatch* smems = nullptr,
+                        size_t firstQuery = 0) {
 
     //std::unordered_map<uint64_t, CoverageCalculator> leftHits;
     //std::unordered_map<uint64_t, CoverageCalculator> rightHits;
@@ -838,43 +873,54 @@ inline void getHitsForFragment(
     }
     */
 
-    //---------- End 1 ----------------------//
-    {
-        std::string readStr   = frag.first.seq;
-        uint32_t readLen      = readStr.size();
-
-        leftReadLength = readLen;
+    // If the SMEMs of both ends were found by a batched search, then
+    // the ends are the queries @firstQuery and @firstQuery + 1 of @smems.
+    if (smems) {
+        leftReadLength = frag.first.seq.size();
+        rightReadLength = frag.second.seq.size();
+        collectHitsForQuery(sidx, *smems, firstQuery, auxHits,
+                            memOptions, salmonOpts, leftHits);
+        collectHitsForQuery(sidx, *smems, firstQuery + 1, auxHits,
+                            memOptions, salmonOpts, rightHits);
+    } else {
+        //---------- End 1 ----------------------//
+        {
+            std::string readStr   = frag.first.seq;
+            uint32_t readLen      = readStr.size();
+
+            leftReadLength = readLen;
+
+            for (int p = 0; p < readLen; ++p) {
+                readStr[p] = nst_nt4_table[static_cast<int>(readStr[p])];
+            }
 
-        for (int p = 0; p < readLen; ++p) {
-            readStr[p] = nst_nt4_table[static_cast<int>(readStr[p])];
+            collectHitsForRead(sidx, a, auxHits,
+                                memOptions,
+                                salmonOpts,
+                                reinterpret_cast<const uint8_t*>(readStr.c_str()),
+                                readLen,
+                                leftHits);
         }
 
-        collectHitsForRead(sidx, a, auxHits,
-                            memOptions,
-                            salmonOpts,
-                            reinterpret_cast<const uint8_t*>(readStr.c_str()),
-                            readLen,
-                            leftHits);
-    }
-
-    //---------- End 2 ----------------------//
-    {
-        std::string readStr   = frag.second.seq;
-        uint32_t readLen      = readStr.size();
+        //---------- End 2 ----------------------//
+        {
+            std::string readStr   = frag.second.seq;
+            uint32_t readLen      = readStr.size();
 
-        rightReadLength = readLen;
+            rightReadLength = readLen;
 
-        for (int p = 0; p < readLen; ++p) {
-            readStr[p] = nst_nt4_table[static_cast<int>(readStr[p])];
-        }
+            for (int p = 0; p < readLen; ++p) {
+                readStr[p] = nst_nt4_table[static_cast<int>(readStr[p])];
+            }
 
-        collectHitsForRead(sidx, a, auxHits,
-                            memOptions,
-                            salmonOpts,
-                            reinterpret_cast<const uint8_t*>(readStr.c_str()),
-                            readLen,
-                            rightHits);
-     } // end right
+            collectHitsForRead(sidx, a, auxHits,
+                                memOptions,
+                                salmonOpts,
+                                reinterpret_cast<const uint8_t*>(readStr.c_str()),
+                                readLen,
+                                rightHits);
+         } // end right
+    }
 
     size_t numTrivialHits = (leftHits.size() + rightHits.size() > 0) ? 1 : 0;
     upperBoundHits += (leftHits.size() + rightHits.size() > 0) ? 1 : 0;
@@ -1214,7 +1260,9 @@ inline void getHitsForFragment(fastx_parser::ReadSeq& frag,
                         uint64_t& upperBoundHits,
                         AlignmentGroup<SMEMAlignment>& hitList,
                         uint64_t& hitListCount,
-                        std::vector<Transcript>& transcripts) {
+                        std::vector<Transcript>& transcripts,
+                        bwautils::SMEMBatch* smems = nullptr,
+                        size_t firstQuery = 0) {
 
     uint64_t leftHitCount{0};
 
@@ -1226,7 +1274,11 @@ inline void getHitsForFragment(fastx_parser::ReadSeq& frag,
     uint32_t readLength{0};
 
     //---------- get hits ----------------------//
-    {
+    if (smems) {
+        readLength = frag.seq.size();
+        collectHitsForQuery(sidx, *smems, firstQuery, auxHits,
+                            memOptions, salmonOpts, hits);
+    } else {
         std::string readStr   = frag.seq;
         uint32_t readLen      = frag.seq.size();
 
@@ -1362,12 +1414,22 @@ void processReadsMEM(ParserT* parser,
 	           std::mutex& iomutex,
                bool initialRound,
                std::atomic<bool>& burnedIn,
-               volatile bool& writeToCache) {
+               volatile bool& writeToCache, uint32_t threadIdx) {
     	// ERROR
 	salmonOpts.jointLog->error("Quasimapping cannot be used with the FMD index --- please report this bug on GitHub");
 	std::exit(1);
 }
 
+// Add the end(s) of a fragment to a batch of SMEM searches.
+inline void addToSMEMBatch(bwautils::SMEMBatch& smems, fastx_parser::ReadPair& frag) {
+    smems.add(frag.first.seq);
+    smems.add(frag.second.seq);
+}
+
+inline void addToSMEMBatch(bwautils::SMEMBatch& smems, fastx_parser::ReadSeq& frag) {
+    smems.add(frag.seq);
+}
+
 template <typename ParserT, typename CoverageCalculator>
 void processReadsMEM(ParserT* parser,
                ReadExperiment& readExp,
@@ -1389,13 +1451,13 @@ void processReadsMEM(ParserT* parser,
 	           std::mutex& iomutex,
                bool initialRound,
                std::atomic<bool>& burnedIn,
-               volatile bool& writeToCache) {
-  uint64_t count_fwd = 0, count_bwd = 0;
-  // Seed with a real random value, if available
-  std::random_device rd;
+               volatile bool& writeToCache, uint32_t threadIdx) {
+  // Run on (and so allocate from) this worker's NUMA node, if asked
+  if (salmonOpts.numa) { salmonOpts.numa->pinWorker(threadIdx, salmonOpts.numThreads); }
 
-  // Create a random uniform distribution
-  std::default_random_engine eng(rd());
+  uint64_t count_fwd = 0, count_bwd = 0;
+  // This thread's stream of random numbers
+  auto eng = salmon::rng::stream(salmonOpts.rngSeed, salmon::rng::Phase::ONLINE, threadIdx);
 
   uint64_t prevObservedFrags{1};
   uint64_t leftHitCount{0};
@@ -1406,6 +1468,14 @@ void processReadsMEM(ParserT* parser,
   const bwtintv_v *a = nullptr;
   smem_aux_t* auxHits = smem_aux_init();
 
+  // If requested, the SMEMs of all of the reads of a chunk are found
+  // up-front, with the searches of several reads interleaved.
+  std::unique_ptr<bwautils::SMEMBatch> smems{nullptr};
+  if (salmonOpts.smemInterleave > 0) {
+      smems.reset(new bwautils::SMEMBatch(sidx->bwaIndex()->bwt, salmonOpts.smemInterleave));
+  }
+  std::vector<size_t> firstQuery;
+
   auto expectedLibType = rl.format();
 
   uint64_t firstTimestepOfRound = fmCalc.getCurrentTimestep();
@@ -1414,8 +1484,15 @@ void processReadsMEM(ParserT* parser,
   uint64_t localUpperBoundHits{0};
   size_t rangeSize{0};
   double maxZeroFrac{0.0};
+
+  // Time spent waiting on the parser, and mapping
+  PhaseTelemetry::ThreadCounters phaseTimes(salmonOpts.telemetry.get());
+  auto phaseStart = PhaseTelemetry::Clock::now();
+
   auto rg = parser->getReadGroup();
   while (parser->refill(rg)) {
+      phaseTimes.add(TelemetryPhase::PARSE_WAIT, PhaseTelemetry::nanosSince(phaseStart));
+      phaseStart = PhaseTelemetry::Clock::now();
       rangeSize = rg.size();
 
       /*
@@ -1431,6 +1508,16 @@ void processReadsMEM(ParserT* parser,
         std::exit(1);
     }
 
+    if (smems) {
+        smems->clear();
+        firstQuery.resize(rangeSize);
+        for (size_t i = 0; i < rangeSize; ++i) {
+            firstQuery[i] = smems->size();
+            addToSMEMBatch(*smems, rg[i]);
+        }
+        mem_collect_intv_batch(memOptions, sidx, *smems);
+    }
+
     for(size_t i = 0; i < rangeSize; ++i) { // For all the read in this batch
         localUpperBoundHits = 0;
 
@@ -1445,7 +1532,9 @@ void processReadsMEM(ParserT* parser,
                                                coverageThresh,
                                                localUpperBoundHits,
                                                hitList, hitListCount,
-                                               transcripts);
+                                               transcripts,
+                                               smems.get(),
+                                               smems ? firstQuery[i] : 0);
         if (initialRound) {
             upperBoundHits += localUpperBoundHits;
         }
@@ -1475,13 +1564,20 @@ void processReadsMEM(ParserT* parser,
 
 
     } // end for i < j->nb_filled
+    phaseTimes.add(TelemetryPhase::MAPPING, PhaseTelemetry::nanosSince(phaseStart));
 
     prevObservedFrags = numObservedFragments;
     AlnGroupVecRange<SMEMAlignment> hitLists = boost::make_iterator_range(structureVec.begin(), structureVec.begin() + rangeSize);
     processMiniBatch<SMEMAlignment>(readExp, fmCalc,firstTimestepOfRound, rl, salmonOpts, hitLists, transcripts, clusterForest,
                                     fragLengthDist, observedGCParams, numAssignedFragments, eng, initialRound, burnedIn, maxZeroFrac);
-    
+    if (salmonOpts.earlyStop and
+        salmonOpts.earlyStop->check(numAssignedFragments, transcripts, readExp.equivalenceClassBuilder(),
+                                    salmonOpts.jointLog.get())) {
+        parser->stop();
+    }
+    phaseStart = PhaseTelemetry::Clock::now();
   }
+  phaseTimes.add(TelemetryPhase::PARSE_WAIT, PhaseTelemetry::nanosSince(phaseStart));
 
   if (maxZeroFrac > 0.0) {
       salmonOpts.jointLog->info("Thread saw mini-batch with a maximum of {0:.2f}\% zero probability fragments", 
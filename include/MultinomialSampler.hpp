@@ -5,10 +5,14 @@
 #include <vector>
 #include <algorithm>
 
+#include "SalmonRandom.hpp"
+
 class MultinomialSampler {
     public:
-        MultinomialSampler(std::random_device& rd) :
-            gen_(rd()), u01_(0.0, 1.0) {}
+        explicit MultinomialSampler(salmon::rng::RNG gen) : gen_(gen) {}
+
+        // The stream of random numbers from which this sampler draws
+        salmon::rng::RNG& rng() { return gen_; }
 
         void operator()(
                 std::vector<uint64_t>::iterator sampleBegin,
@@ -36,7 +40,7 @@ class MultinomialSampler {
             // If k is small (<= 100), linear search is usually faster
             if (k <= 100) {
                 for (j = 0; j < n; j++) {
-                    u = u01_(gen_);
+                    u = gen_.uniform01();
 
                     for (i = 0; i < k; i++) {
                         if ((z[i] < u) && (u <= z[i+1])) {
@@ -47,7 +51,7 @@ class MultinomialSampler {
                 }
             } else { // k is large enough to warrant binary search
                 for (j = 0; j < n; j++) {
-                    u = u01_(gen_);
+                    u = gen_.uniform01();
 
                     // Find the offset of the element to increment
                     auto it = std::lower_bound(z.begin(), z.end()-1, u);
@@ -65,8 +69,7 @@ class MultinomialSampler {
 
 
     private:
-        std::mt19937 gen_;
-        std::uniform_real_distribution<> u01_;
+        salmon::rng::RNG gen_;
 };
 
 #endif //_MULTINOMIAL_SAMPLER_HPP_
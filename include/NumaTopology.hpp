@@ -0,0 +1,181 @@
+#ifndef __NUMA_TOPOLOGY_HPP__
+#define __NUMA_TOPOLOGY_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace salmon {
+namespace numa {
+
+/**
+ * Parse a Linux cpu (or node) list, such as "0-3,8,10-11", into the ids it
+ * names.  Returns an empty vector if the list is malformed.
+ */
+inline std::vector<int> parseIDList(const std::string& list) {
+    std::vector<int> ids;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() or range == "\n") { continue; }
+        try {
+            auto dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+            if (first < 0 or last < first) { return {}; }
+            for (int i = first; i <= last; ++i) { ids.push_back(i); }
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+    return ids;
+}
+
+/**
+ * The NUMA nodes of the machine, and the CPUs that belong to each.
+ *
+ * Worker threads are spread over the nodes in contiguous blocks (so that
+ * threads with nearby ids, which tend to share the most, share a node),
+ * and each is allowed to run on any CPU of its node.  The memory that a
+ * pinned thread allocates is then (by the kernel's first-touch policy)
+ * local to the node that it runs on.
+ *
+ * For memory that all threads share, such as the index, an
+ * InterleaveScope spreads the pages allocated while it is alive evenly
+ * over all of the nodes, so that no one node's memory bus serves all of
+ * the lookups.
+ */
+class Topology {
+public:
+    /**
+     * Read the topology from sysfs; on machines (or systems) where that
+     * isn't available, this is a single node with every CPU.
+     */
+    static Topology detect() {
+        namespace bfs = boost::filesystem;
+        Topology topo;
+        bfs::path nodeRoot("/sys/devices/system/node");
+        std::string onlineNodes;
+        {
+            std::ifstream ifs((nodeRoot / "online").string());
+            std::getline(ifs, onlineNodes);
+        }
+        for (auto node : parseIDList(onlineNodes)) {
+            std::ifstream ifs((nodeRoot / ("node" + std::to_string(node)) / "cpulist").string());
+            std::string cpuList;
+            std::getline(ifs, cpuList);
+            auto cpus = parseIDList(cpuList);
+            // Skip memory-only nodes
+            if (cpus.empty()) { continue; }
+            topo.nodeIDs_.push_back(node);
+            topo.cpus_.push_back(cpus);
+        }
+        if (topo.nodeIDs_.empty()) {
+            std::vector<int> cpus;
+            for (int i = 0; i < static_cast<int>(std::thread::hardware_concurrency()); ++i) {
+                cpus.push_back(i);
+            }
+            topo.nodeIDs_.push_back(0);
+            topo.cpus_.push_back(cpus);
+        }
+        return topo;
+    }
+
+    Topology() {}
+    Topology(std::vector<int> nodeIDs, std::vector<std::vector<int>> cpus) :
+        nodeIDs_(std::move(nodeIDs)), cpus_(std::move(cpus)) {}
+
+    size_t numNodes() const { return nodeIDs_.size(); }
+    int nodeID(size_t node) const { return nodeIDs_[node]; }
+    const std::vector<int>& cpus(size_t node) const { return cpus_[node]; }
+
+    /** The node (index) on which worker `i` of `numWorkers` should run. */
+    size_t nodeForWorker(size_t i, size_t numWorkers) const {
+        if (numWorkers == 0) { return 0; }
+        return ((i % numWorkers) * numNodes()) / numWorkers;
+    }
+
+    /**
+     * Restrict the calling thread to the CPUs of the node of worker `i`
+     * of `numWorkers`.  Returns false if that couldn't be done.
+     */
+    bool pinWorker(size_t i, size_t numWorkers) const {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus(nodeForWorker(i, numWorkers))) {
+            if (cpu < CPU_SETSIZE) { CPU_SET(cpu, &set); }
+        }
+        return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        return false;
+#endif // __linux__
+    }
+
+private:
+    std::vector<int> nodeIDs_;
+    std::vector<std::vector<int>> cpus_;
+};
+
+/**
+ * While this is alive, the pages that the calling thread (and any thread
+ * it starts) allocates are interleaved over the nodes of `topo`; the
+ * default (local) policy is restored when it is destroyed.  With a null
+ * (or single-node) topology, this does nothing.
+ */
+class InterleaveScope {
+public:
+    explicit InterleaveScope(const Topology* topo) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+        if (topo == nullptr or topo->numNodes() < 2) { return; }
+        constexpr size_t bitsPerWord = 8 * sizeof(unsigned long);
+        int maxNode{0};
+        for (size_t n = 0; n < topo->numNodes(); ++n) {
+            maxNode = std::max(maxNode, topo->nodeID(n));
+        }
+        std::vector<unsigned long> mask(maxNode / bitsPerWord + 1, 0);
+        for (size_t n = 0; n < topo->numNodes(); ++n) {
+            int id = topo->nodeID(n);
+            mask[id / bitsPerWord] |= (1UL << (id % bitsPerWord));
+        }
+        // The kernel reads maxnode - 1 bits of the mask
+        active_ = ::syscall(SYS_set_mempolicy, mpolInterleave, mask.data(),
+                            static_cast<unsigned long>(mask.size() * bitsPerWord + 1)) == 0;
+#endif // __linux__ && SYS_set_mempolicy
+    }
+
+    InterleaveScope(const InterleaveScope&) = delete;
+    InterleaveScope& operator=(const InterleaveScope&) = delete;
+
+    ~InterleaveScope() {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+        if (active_) { ::syscall(SYS_set_mempolicy, mpolDefault, nullptr, 0UL); }
+#endif // __linux__ && SYS_set_mempolicy
+    }
+
+    /** Whether the interleaving policy is in effect. */
+    bool active() const { return active_; }
+
+private:
+    // From <linux/mempolicy.h>, which we don't want to depend on
+    static constexpr int mpolDefault = 0;
+    static constexpr int mpolInterleave = 3;
+    bool active_{false};
+};
+
+}
+}
+
+#endif // __NUMA_TOPOLOGY_HPP__
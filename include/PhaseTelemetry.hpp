@@ -0,0 +1,244 @@
+#ifndef __PHASE_TELEMETRY_HPP__
+#define __PHASE_TELEMETRY_HPP__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <sys/resource.h>
+
+#include "cereal/archives/json.hpp"
+
+#include "spdlog/fmt/fmt.h"
+
+/**
+ * The phases of quantification for which we keep time.
+ */
+enum class TelemetryPhase : uint8_t {
+    PARSE_WAIT = 0,         // worker threads waiting on the read parser
+    MAPPING = 1,            // mapping (or aligning) the reads of a read group
+    EQCLASS_INSERTION = 2,  // inserting fragments into the equivalence classes
+    ONLINE_UPDATE = 3,      // the online (streaming) update of a mini-batch
+    BURN_IN_LENGTHS = 4,    // re-computing effective lengths at the end of burn-in
+    BIAS_BACKGROUND = 5,    // computing the bias "background" and effective lengths
+    EM_ITERATION = 6,       // a single round of the (VB)EM algorithm
+    BOOTSTRAP = 7,          // a single bootstrap replicate
+    NUM_PHASES = 8
+};
+
+/**
+ * Low-overhead, always-on accounting of where the time of a run goes.
+ *
+ * For every phase, we record the total (thread) time spent in it, the
+ * number of times it was entered, and the peak resident set size of the
+ * process observed at the end of an interval of that phase.  Since the
+ * peak RSS is a process-wide high-water mark, the value for a phase is the
+ * largest footprint the process had reached by the time the phase last
+ * completed.
+ *
+ * Hot loops (e.g. the mapping threads) accumulate into a ThreadCounters
+ * object that they own, and which is merged into the shared totals only
+ * when it is flushed (or destroyed); infrequent, coarse-grained phases
+ * (e.g. an EM round) can simply be timed with a ScopedTimer.
+ */
+class PhaseTelemetry {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t numPhases = static_cast<size_t>(TelemetryPhase::NUM_PHASES);
+
+    static const char* phaseName(TelemetryPhase p) {
+        static const char* names[] = {"parse_wait",      "mapping",
+                                      "eq_class_insertion", "online_update",
+                                      "burn_in_effective_lengths", "bias_background",
+                                      "em_iteration",    "bootstrap"};
+        return names[static_cast<size_t>(p)];
+    }
+
+    // The process' peak resident set size (in bytes) so far
+    static uint64_t peakRSS() {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#if defined(__APPLE__)
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+
+    static uint64_t nanosSince(Clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    PhaseTelemetry() : start_(Clock::now()) {
+        for (auto& p : phases_) {
+            p.nanos = 0;
+            p.count = 0;
+            p.peakRSS = 0;
+        }
+    }
+
+    PhaseTelemetry(const PhaseTelemetry&) = delete;
+    PhaseTelemetry& operator=(const PhaseTelemetry&) = delete;
+
+    ~PhaseTelemetry() { stopProgressStream(); }
+
+    /** Record `count` intervals of phase `p` that took `nanos` in total. */
+    void add(TelemetryPhase p, uint64_t nanos, uint64_t count = 1) {
+        auto& s = phases_[static_cast<size_t>(p)];
+        s.nanos += nanos;
+        s.count += count;
+        notePeakRSS_(s, peakRSS());
+    }
+
+    /**
+     * Per-thread counters; these are plain integers, so that they can be
+     * updated in the inner loop of a worker thread at no cost beyond
+     * reading the clock.
+     */
+    class ThreadCounters {
+    public:
+        explicit ThreadCounters(PhaseTelemetry* parent) : parent_(parent) {
+            nanos_.fill(0);
+            counts_.fill(0);
+        }
+        ThreadCounters(const ThreadCounters&) = delete;
+        ThreadCounters& operator=(const ThreadCounters&) = delete;
+        ~ThreadCounters() { flush(); }
+
+        void add(TelemetryPhase p, uint64_t nanos, uint64_t count = 1) {
+            nanos_[static_cast<size_t>(p)] += nanos;
+            counts_[static_cast<size_t>(p)] += count;
+        }
+
+        /** Merge these counters into the parent, and reset them. */
+        void flush() {
+            if (parent_ == nullptr) { return; }
+            uint64_t rss = peakRSS();
+            for (size_t i = 0; i < numPhases; ++i) {
+                if (counts_[i] == 0) { continue; }
+                auto& s = parent_->phases_[i];
+                s.nanos += nanos_[i];
+                s.count += counts_[i];
+                parent_->notePeakRSS_(s, rss);
+                nanos_[i] = 0;
+                counts_[i] = 0;
+            }
+        }
+
+    private:
+        PhaseTelemetry* parent_;
+        std::array<uint64_t, numPhases> nanos_;
+        std::array<uint64_t, numPhases> counts_;
+    };
+
+    /** Times the scope in which it lives as one interval of a phase. */
+    class ScopedTimer {
+    public:
+        ScopedTimer(PhaseTelemetry* telemetry, TelemetryPhase p)
+            : telemetry_(telemetry), phase_(p), start_(Clock::now()) {}
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+        ~ScopedTimer() {
+            if (telemetry_ != nullptr) { telemetry_->add(phase_, nanosSince(start_)); }
+        }
+
+    private:
+        PhaseTelemetry* telemetry_;
+        TelemetryPhase phase_;
+        Clock::time_point start_;
+    };
+
+    uint64_t nanos(TelemetryPhase p) const { return phases_[static_cast<size_t>(p)].nanos; }
+    uint64_t count(TelemetryPhase p) const { return phases_[static_cast<size_t>(p)].count; }
+    uint64_t peakRSS(TelemetryPhase p) const { return phases_[static_cast<size_t>(p)].peakRSS; }
+
+    /**
+     * Every `intervalSecs` seconds, append a snapshot of the counters (as
+     * a single line of JSON) to the file `path`, until stopProgressStream()
+     * is called.
+     */
+    void startProgressStream(const std::string& path, uint32_t intervalSecs) {
+        if (progressThread_.joinable() or intervalSecs == 0) { return; }
+        progressFile_.open(path);
+        stopProgress_ = false;
+        progressThread_ = std::thread([this, intervalSecs]() -> void {
+            std::unique_lock<std::mutex> l(progressMutex_);
+            while (!progressCV_.wait_for(l, std::chrono::seconds(intervalSecs),
+                                         [this]() { return stopProgress_; })) {
+                writeSnapshot_();
+            }
+            // one final snapshot, at the end of the run
+            writeSnapshot_();
+        });
+    }
+
+    void stopProgressStream() {
+        if (!progressThread_.joinable()) { return; }
+        {
+            std::lock_guard<std::mutex> l(progressMutex_);
+            stopProgress_ = true;
+        }
+        progressCV_.notify_all();
+        progressThread_.join();
+        progressFile_.close();
+    }
+
+    /** Write the per-phase totals as the fields of a JSON object. */
+    template <typename Archive>
+    void save(Archive& ar) const {
+        ar(cereal::make_nvp("wall_clock_seconds", nanosSince(start_) * 1e-9));
+        ar(cereal::make_nvp("peak_rss_bytes", peakRSS()));
+        for (size_t i = 0; i < numPhases; ++i) {
+            auto p = static_cast<TelemetryPhase>(i);
+            ar.setNextName(phaseName(p));
+            ar.startNode();
+            ar(cereal::make_nvp("seconds", nanos(p) * 1e-9));
+            ar(cereal::make_nvp("count", count(p)));
+            ar(cereal::make_nvp("peak_rss_bytes", peakRSS(p)));
+            ar.finishNode();
+        }
+    }
+
+private:
+    struct PhaseStats {
+        std::atomic<uint64_t> nanos;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> peakRSS;
+    };
+
+    void notePeakRSS_(PhaseStats& s, uint64_t rss) {
+        uint64_t prev = s.peakRSS;
+        while (rss > prev and !s.peakRSS.compare_exchange_weak(prev, rss)) {}
+    }
+
+    void writeSnapshot_() {
+        fmt::MemoryWriter w;
+        w.write("{{\"elapsed_seconds\": {:.3f}, \"peak_rss_bytes\": {}",
+                nanosSince(start_) * 1e-9, peakRSS());
+        for (size_t i = 0; i < numPhases; ++i) {
+            auto p = static_cast<TelemetryPhase>(i);
+            w.write(", \"{}\": {{\"seconds\": {:.3f}, \"count\": {}}}",
+                    phaseName(p), nanos(p) * 1e-9, count(p));
+        }
+        w.write("}}\n");
+        progressFile_ << w.str();
+        progressFile_.flush();
+    }
+
+    Clock::time_point start_;
+    std::array<PhaseStats, numPhases> phases_;
+
+    std::ofstream progressFile_;
+    std::thread progressThread_;
+    std::mutex progressMutex_;
+    std::condition_variable progressCV_;
+    bool stopProgress_{false};
+};
+
+#endif // __PHASE_TELEMETRY_HPP__
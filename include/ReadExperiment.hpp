@@ -19,6 +19,7 @@ extern "C" {
 #include "SequenceBiasModel.hpp"
 #include "SalmonOpts.hpp"
 #include "SalmonIndex.hpp"
+#include "NumaTopology.hpp"
 #include "SalmonUtils.hpp"
 #include "EquivalenceClassBuilder.hpp"
 #include "SpinLock.hpp" // RapMap's with try_lock
@@ -26,10 +27,15 @@ extern "C" {
 #include "ReadKmerDist.hpp"
 #include "SBModel.hpp"
 #include "SimplePosBias.hpp"
+#include "TaskScheduler.hpp"
 
 // Logger includes
 #include "spdlog/spdlog.h"
 
+// TBB includes
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
 // Boost includes
 #include <boost/filesystem.hpp>
 #include <boost/range/irange.hpp>
@@ -40,6 +46,7 @@ extern "C" {
 // Standard includes
 #include <vector>
 #include <memory>
+#include <functional>
 #include <fstream>
 
 
@@ -54,10 +61,17 @@ class ReadExperiment {
 
     public:
 
+    /**
+     * If `sharedIndex` is provided (and loaded), it is used directly rather
+     * than loading the index from `indexDirectory` again.  This allows
+     * many samples to be quantified, one after the other, against a single
+     * in-memory copy of the index.
+     */
     ReadExperiment(std::vector<ReadLibrary>& readLibraries,
                    //const boost::filesystem::path& transcriptFile,
                    const boost::filesystem::path& indexDirectory,
-		           SalmonOpts& sopt) :
+		           SalmonOpts& sopt,
+                   std::shared_ptr<SalmonIndex> sharedIndex = nullptr) :
         readLibraries_(readLibraries),
         //transcriptFile_(transcriptFile),
         transcripts_(std::vector<Transcript>()),
@@ -67,6 +81,7 @@ class ReadExperiment {
         posBiasRC_(5),
         seqBiasModel_(1.0),
 	eqBuilder_(sopt.jointLog),
+        telemetry_(sopt.telemetry),
         expectedBias_(constExprPow(4, readBias_[0].getK()), 1.0),
 	expectedGC_( sopt.numConditionalGCBins,
 		    sopt.numFragGCBins, distribution_utils::DistributionSpace::LOG),
@@ -98,23 +113,37 @@ class ReadExperiment {
             }
             */
 
-            // ==== Figure out the index type
-            boost::filesystem::path versionPath = indexDirectory / "versionInfo.json";
-            SalmonIndexVersionInfo versionInfo;
-            versionInfo.load(versionPath);
-            if (versionInfo.indexVersion() == 0) {
-                fmt::MemoryWriter infostr;
-                infostr << "Error: The index version file " << versionPath.string()
-                    << " doesn't seem to exist.  Please try re-building the salmon "
-                    "index.";
-                throw std::invalid_argument(infostr.str());
+            if (sharedIndex and sharedIndex->loaded()) {
+                sopt.jointLog->info("Re-using previously loaded index");
+                salmonIndex_ = sharedIndex;
+            } else {
+                // ==== Figure out the index type
+                boost::filesystem::path versionPath = indexDirectory / "versionInfo.json";
+                SalmonIndexVersionInfo versionInfo;
+                versionInfo.load(versionPath);
+                if (versionInfo.indexVersion() == 0) {
+                    fmt::MemoryWriter infostr;
+                    infostr << "Error: The index version file " << versionPath.string()
+                        << " doesn't seem to exist.  Please try re-building the salmon "
+                        "index.";
+                    throw std::invalid_argument(infostr.str());
+                }
+                // Check index version compatibility here
+                auto indexType = versionInfo.indexType();
+                // ==== Figure out the index type
+
+                salmonIndex_.reset(new SalmonIndex(sopt.jointLog, indexType));
+                {
+                    // Spread the index over all of the NUMA nodes, if asked
+                    bool interleave = sopt.numa and sopt.numaPolicy == "interleave";
+                    salmon::numa::InterleaveScope scope(interleave ? sopt.numa.get() : nullptr);
+                    salmonIndex_->load(indexDirectory);
+                    if (scope.active()) {
+                        sopt.jointLog->info("Interleaved the index over {} NUMA nodes",
+                                            sopt.numa->numNodes());
+                    }
+                }
             }
-            // Check index version compatibility here
-            auto indexType = versionInfo.indexType();
-            // ==== Figure out the index type
-
-            salmonIndex_.reset(new SalmonIndex(sopt.jointLog, indexType));
-            salmonIndex_->load(indexDirectory);
 
 	    // Now we'll have either an FMD-based index or a QUASI index
 	    // dispatch on the correct type.
@@ -136,7 +165,7 @@ class ReadExperiment {
                 }
                 break;
             case SalmonIndexType::FMD:
-                loadTranscriptsFromFMD();
+                loadTranscriptsFromFMD(sopt);
                 break;
 	    }
 
@@ -149,51 +178,57 @@ class ReadExperiment {
         return eqBuilder_;
     }
 
+    const EquivalenceClassBuilder& equivalenceClassBuilder() const {
+        return eqBuilder_;
+    }
+
     std::vector<Transcript>& transcripts() { return transcripts_; }
     const std::vector<Transcript>& transcripts() const { return transcripts_; }
 
-    void updateTranscriptLengthsAtomic(std::atomic<bool>& done) {
-        if (sl_.try_lock()) {
-            if (!done) {
-                auto fld = fragLengthDist_.get();
-                // Convert the PMF to non-log scale
-                std::vector<double> logPMF;
-                size_t minVal;
-                size_t maxVal;
-                fld->dumpPMF(logPMF, minVal, maxVal);
-                double sum = salmon::math::LOG_0;
-                for (auto v : logPMF) {
-                    sum = salmon::math::logAdd(sum, v);
-                }
-                for (auto& v : logPMF) {
-                    v -= sum;
-                }
-
-                // Create the non-logged distribution.
-                // Here, we multiply by 100 to discourage small
-                // numbers in the correctionFactorsfromCounts call
-                // below.
-                std::vector<double> pmf(maxVal + 1, 0.0);
-                for (size_t i = minVal; i < maxVal; ++i) {
-                    pmf[i] = 100.0 * std::exp(logPMF[i - minVal]);
-                }
-
-		using distribution_utils::DistributionSpace;
-		// We compute the factors in linear space (since we've de-logged the pmf)
-                auto correctionFactors = distribution_utils::correctionFactorsFromMass(pmf, DistributionSpace::LINEAR);
-		// Since we'll continue treating effective lengths in log space, populate them as such
-		distribution_utils::computeSmoothedEffectiveLengths(pmf.size(), transcripts_, correctionFactors, DistributionSpace::LOG);
+    /**
+     * Recompute the effective lengths of all transcripts from the current
+     * fragment length distribution, and set `done` once they are in place.
+     * Only the first caller does any work.  If a `scheduler` is given, the
+     * work is handed off to its pool so that the caller (usually a mapping
+     * thread that just crossed the burn-in threshold) can return to
+     * mapping immediately; waitForTranscriptLengthUpdate() must be called
+     * before `done` goes out of scope.  In that case, `then` (if given) is
+     * run by the same job once `done` is set.  `first` (if given) is run,
+     * by the first caller only, before the lengths are recomputed.
+     */
+    void updateTranscriptLengthsAtomic(std::atomic<bool>& done,
+                                       std::shared_ptr<salmon::TaskScheduler> scheduler = nullptr,
+                                       std::function<void()> first = nullptr,
+                                       std::function<void()> then = nullptr) {
+        if (done) { return; }
+        bool expected{false};
+        if (!lengthUpdateInFlight_.compare_exchange_strong(expected, true)) { return; }
+
+        if (scheduler) {
+            lengthUpdateScheduler_ = scheduler;
+            scheduler->runFromOutside(lengthUpdate_, [this, &done, first, then]() -> void {
+                    if (first) { first(); }
+                    updateTranscriptLengths_();
+                    done = true;
+                    if (then) { then(); }
+                });
+        } else {
+            if (first) { first(); }
+            updateTranscriptLengths_();
+            done = true;
+            lengthUpdateInFlight_ = false;
+        }
+    }
 
-                /*
-                // Update the effective length of *every* transcript
-                for( auto& t : transcripts_ ) {
-                    t.updateEffectiveLength(logPMF, logFLDMean, minVal, maxVal);
-                }
-                */
-                // then declare that we are done
-                done = true;
-                sl_.unlock();
-            }
+    /**
+     * Block until any effective length update started in the background
+     * by updateTranscriptLengthsAtomic() has finished.
+     */
+    void waitForTranscriptLengthUpdate() {
+        if (lengthUpdateScheduler_) {
+            lengthUpdateScheduler_->waitFromOutside(lengthUpdate_);
+            lengthUpdateScheduler_.reset();
+            lengthUpdateInFlight_ = false;
         }
     }
 
@@ -229,142 +264,130 @@ class ReadExperiment {
     }
 
     SalmonIndex* getIndex() { return salmonIndex_.get(); }
+    std::shared_ptr<SalmonIndex> sharedIndex() { return salmonIndex_; }
 
     template <typename QuasiIndexT>
     void loadTranscriptsFromQuasi(QuasiIndexT* idx_, const SalmonOpts& sopt) {
 	    size_t numRecords = idx_->txpNames.size();
         auto log = spdlog::get("jointLog");
 
-	    log->info("Index contained {} targets", numRecords);
-	    //transcripts_.resize(numRecords);
+        // Transcripts added to the index after it was built follow those
+        // of the base index.
+        QuasiIndexT* deltaIdx = salmonIndex_->deltaQuasiIndex<QuasiIndexT>();
+        size_t numAdded = (deltaIdx != nullptr) ? deltaIdx->txpNames.size() : 0;
+
+	    log->info("Index contained {} targets", numRecords + numAdded);
+        if (numAdded > 0) {
+            log->info("{} of these were added after the index was built", numAdded);
+        }
+	    transcripts_.resize(numRecords + numAdded);
 	    double alpha = 0.005;
-	    for (auto i : boost::irange(size_t(0), numRecords)) {
-		    uint32_t id = i;
-		    const char* name = idx_->txpNames[i].c_str();
-		    uint32_t len = idx_->txpLens[i];
-		    // copy over the length, then we're done.
-		    transcripts_.emplace_back(id, name, len, alpha);
-		    auto& txp = transcripts_.back();
-		    // The transcript sequence
-		    //auto txpSeq = idx_->seq.substr(idx_->txpOffsets[i], len);
-
-		    // Set the transcript sequence
-		    txp.setSequenceBorrowed(idx_->seq.c_str() + idx_->txpOffsets[i],
-                                    sopt.gcBiasCorrect, sopt.gcSampFactor);
-		    // Length classes taken from
-            // https://github.com/cole-trapnell-lab/cufflinks/blob/master/src/biascorrection.cpp
-		    // ======
-		    // Roberts, Adam, et al.
-		    // "Improving RNA-Seq expression estimates by correcting for fragment bias."
-		    // Genome Biol 12.3 (2011): R22.
-		    // ======
-		    // perhaps, define these in a more data-driven way
-            if (txp.RefLength <= 791) {
-                txp.lengthClassIndex(0);
-            } else if (txp.RefLength <= 1265) {
-                txp.lengthClassIndex(1);
-            } else if (txp.RefLength <= 1707) {
-                txp.lengthClassIndex(2);
-            } else if (txp.RefLength <= 2433) {
-                txp.lengthClassIndex(3);
-            } else {
-                txp.lengthClassIndex(4);
+        // Each transcript is independent of the others, so set them up in
+        // parallel.  The (potentially expensive) GC tables are not built
+        // here; they are computed on first use (see Transcript::gcAt).
+        using BlockedIndexRange = tbb::blocked_range<size_t>;
+        tbb::parallel_for(BlockedIndexRange(size_t(0), numRecords + numAdded),
+            [&](const BlockedIndexRange& range) -> void {
+            for (auto i : boost::irange(range.begin(), range.end())) {
+                uint32_t id = i;
+                QuasiIndexT* idx = (i < numRecords) ? idx_ : deltaIdx;
+                size_t j = (i < numRecords) ? i : i - numRecords;
+                const char* name = idx->txpNames[j].c_str();
+                uint32_t len = idx->txpLens[j];
+                // copy over the length, then we're done.
+                transcripts_[i] = Transcript(id, name, len, alpha);
+                auto& txp = transcripts_[i];
+
+                // Set the transcript sequence
+                txp.setSequenceBorrowed(idx->seq.c_str() + idx->txpOffsets[j],
+                                        sopt.gcBiasCorrect, sopt.gcSampFactor);
+                setLengthClass_(txp);
             }
-      }
+        });
 	    // ====== Done loading the transcripts from file
     }
 
-    void loadTranscriptsFromFMD() {
+    void loadTranscriptsFromFMD(const SalmonOpts& sopt) {
 	    bwaidx_t* idx_ = salmonIndex_->bwaIndex();
 	    size_t numRecords = idx_->bns->n_seqs;
-	    std::vector<Transcript> transcripts_tmp;
         auto log = spdlog::get("jointLog");
-        //transcripts_tmp.reserve(numRecords);
-        //transcripts_.reserve(numRecords);
 
 	    log->info("Index contained {} targets", numRecords);
-	    //transcripts_.resize(numRecords);
-	    for (auto i : boost::irange(size_t(0), numRecords)) {
-		    uint32_t id = i;
-		    char* name = idx_->bns->anns[i].name;
-		    uint32_t len = idx_->bns->anns[i].len;
-		    // copy over the length, then we're done.
-		    transcripts_tmp.emplace_back(id, name, len);
-	    }
-
-	    std::sort(transcripts_tmp.begin(), transcripts_tmp.end(),
-			    [](const Transcript& t1, const Transcript& t2) -> bool {
-			    return t1.id < t2.id;
-			    });
-
+	    transcripts_.resize(numRecords);
 
 	    double alpha = 0.005;
 	    char nucTab[256];
 	    nucTab[0] = 'A'; nucTab[1] = 'C'; nucTab[2] = 'G'; nucTab[3] = 'T';
 	    for (size_t i = 4; i < 256; ++i) { nucTab[i] = 'N'; }
 
-        size_t tnum = 0;
-	    // Load the transcript sequence from file
-	    for (auto& t : transcripts_tmp) {
-		    transcripts_.emplace_back(t.id, t.RefName.c_str(), t.RefLength, alpha);
-		    /* from BWA */
-		    uint8_t* rseq = nullptr;
-		    int64_t tstart, tend, compLen, l_pac = idx_->bns->l_pac;
-		    tstart  = idx_->bns->anns[t.id].offset;
-		    tend = tstart + t.RefLength;
-		    rseq = bns_get_seq(l_pac, idx_->pac, tstart, tend, &compLen);
-		    if (compLen != t.RefLength) {
-			    fmt::print(stderr,
-					    "For transcript {}, stored length ({}) != computed length ({}) --- index may be corrupt. exiting\n",
-					    t.RefName, compLen, t.RefLength);
-			    std::exit(1);
-		    }
-		    std::string seq(t.RefLength, ' ');
-		    if (rseq != 0) {
-			    for (int64_t i = 0; i < compLen; ++i) { seq[i] = nucTab[rseq[i]]; }
-		    }
-
-            auto& txp = transcripts_.back();
-
-            // allocate space for the new copy
-            char* seqCopy = new char[seq.length()+1];
-            std::strcpy(seqCopy, seq.c_str());
-            txp.setSequenceOwned(seqCopy);
-		    txp.setSAMSequenceOwned(salmon::stringtools::encodeSequenceInSAM(seq.c_str(), t.RefLength));
-
-            // Length classes taken from
-            // https://github.com/cole-trapnell-lab/cufflinks/blob/master/src/biascorrection.cpp
-		    // ======
-		    // Roberts, Adam, et al.
-		    // "Improving RNA-Seq expression estimates by correcting for fragment bias."
-		    // Genome Biol 12.3 (2011): R22.
-		    // ======
-		    // perhaps, define these in a more data-driven way
-            if (txp.RefLength <= 791) {
-                txp.lengthClassIndex(0);
-            } else if (txp.RefLength <= 1265) {
-                txp.lengthClassIndex(1);
-            } else if (txp.RefLength <= 1707) {
-                txp.lengthClassIndex(2);
-            } else if (txp.RefLength <= 2433) {
-                txp.lengthClassIndex(3);
-            } else {
-                txp.lengthClassIndex(4);
+	    // Decode the transcript sequences from the packed index in parallel
+        using BlockedIndexRange = tbb::blocked_range<size_t>;
+        tbb::parallel_for(BlockedIndexRange(size_t(0), numRecords),
+            [&](const BlockedIndexRange& range) -> void {
+            for (auto id : boost::irange(range.begin(), range.end())) {
+                char* name = idx_->bns->anns[id].name;
+                uint32_t len = idx_->bns->anns[id].len;
+                transcripts_[id] = Transcript(id, name, len, alpha);
+                auto& txp = transcripts_[id];
+
+                /* from BWA */
+                uint8_t* rseq = nullptr;
+                int64_t tstart, tend, compLen, l_pac = idx_->bns->l_pac;
+                tstart  = idx_->bns->anns[id].offset;
+                tend = tstart + len;
+                rseq = bns_get_seq(l_pac, idx_->pac, tstart, tend, &compLen);
+                if (compLen != len) {
+                    fmt::print(stderr,
+                            "For transcript {}, stored length ({}) != computed length ({}) --- index may be corrupt. exiting\n",
+                            txp.RefName, compLen, len);
+                    std::exit(1);
+                }
+                std::string seq(len, ' ');
+                if (rseq != 0) {
+                    for (int64_t i = 0; i < compLen; ++i) { seq[i] = nucTab[rseq[i]]; }
+                }
+
+                // allocate space for the new copy
+                char* seqCopy = new char[seq.length()+1];
+                std::strcpy(seqCopy, seq.c_str());
+                txp.setSequenceOwned(seqCopy);
+                txp.setSAMSequenceOwned(salmon::stringtools::encodeSequenceInSAM(seq.c_str(), len));
+                setLengthClass_(txp);
+                free(rseq);
+                /* end BWA code */
             }
-		    free(rseq);
-		    /* end BWA code */
-            ++tnum;
-	    }
+        });
 
 	    // Since we have the de-coded reference sequences, we no longer need
 	    // the encoded sequences, so free them.
 	    /** TEST OPT **/
 	    // free(idx_->pac); idx_->pac = nullptr;
 	    /** END TEST OPT **/
-	    transcripts_tmp.clear();
 	    // ====== Done loading the transcripts from file
     }
 
+    static void setLengthClass_(Transcript& txp) {
+	    // Length classes taken from
+        // https://github.com/cole-trapnell-lab/cufflinks/blob/master/src/biascorrection.cpp
+	    // ======
+	    // Roberts, Adam, et al.
+	    // "Improving RNA-Seq expression estimates by correcting for fragment bias."
+	    // Genome Biol 12.3 (2011): R22.
+	    // ======
+	    // perhaps, define these in a more data-driven way
+        if (txp.RefLength <= 791) {
+            txp.lengthClassIndex(0);
+        } else if (txp.RefLength <= 1265) {
+            txp.lengthClassIndex(1);
+        } else if (txp.RefLength <= 1707) {
+            txp.lengthClassIndex(2);
+        } else if (txp.RefLength <= 2433) {
+            txp.lengthClassIndex(3);
+        } else {
+            txp.lengthClassIndex(4);
+        }
+    }
+
 
     template <typename CallbackT>
     bool processReads(const uint32_t& numThreads, const SalmonOpts& sopt, CallbackT& processReadLibrary) {
@@ -374,10 +397,13 @@ class ReadExperiment {
                                *(fragLengthDist_.get()), numAssignedFragments_,
                                numThreads, burnedIn);
         }
+        // burnedIn is about to go out of scope
+        waitForTranscriptLengthUpdate();
         return true;
     }
 
     ~ReadExperiment() {
+        waitForTranscriptLengthUpdate();
         // ---- Get rid of things we no longer need --------
         // bwa_idx_destroy(idx_);
     }
@@ -653,6 +679,35 @@ class ReadExperiment {
     }
   
     private:
+    void updateTranscriptLengths_() {
+        PhaseTelemetry::ScopedTimer timer(telemetry_.get(), TelemetryPhase::BURN_IN_LENGTHS);
+        auto fld = fragLengthDist_.get();
+        // Convert the PMF to non-log scale
+        std::vector<double> logPMF;
+        size_t minVal;
+        size_t maxVal;
+        fld->dumpPMF(logPMF, minVal, maxVal);
+        double sum = salmon::math::logSumExp(logPMF.data(), logPMF.size());
+        for (auto& v : logPMF) {
+            v -= sum;
+        }
+
+        // Create the non-logged distribution.
+        // Here, we multiply by 100 to discourage small
+        // numbers in the correctionFactorsfromCounts call
+        // below.
+        std::vector<double> pmf(maxVal + 1, 0.0);
+        for (size_t i = minVal; i < maxVal; ++i) {
+            pmf[i] = 100.0 * std::exp(logPMF[i - minVal]);
+        }
+
+        using distribution_utils::DistributionSpace;
+        // We compute the factors in linear space (since we've de-logged the pmf)
+        auto correctionFactors = distribution_utils::correctionFactorsFromMass(pmf, DistributionSpace::LINEAR);
+        // Since we'll continue treating effective lengths in log space, populate them as such
+        distribution_utils::computeSmoothedEffectiveLengths(pmf.size(), transcripts_, correctionFactors, DistributionSpace::LOG);
+    }
+
     /**
      * The file from which the alignments will be read.
      * This can be a SAM or BAM file, and can be a regular
@@ -671,7 +726,7 @@ class ReadExperiment {
     /**
      * The index we've built on the set of transcripts.
      */
-    std::unique_ptr<SalmonIndex> salmonIndex_{nullptr};
+    std::shared_ptr<SalmonIndex> salmonIndex_{nullptr};
     //bwaidx_t *idx_{nullptr};
     /**
      * The cluster forest maintains the dynamic relationship
@@ -701,8 +756,14 @@ class ReadExperiment {
     uint64_t upperBoundHits_{0};
     double effectiveMappingRate_{0.0};
     SpinLock sl_;
+    std::atomic<bool> lengthUpdateInFlight_{false};
+    // The pool running the background effective length update (if any)
+    std::shared_ptr<salmon::TaskScheduler> lengthUpdateScheduler_{nullptr};
+    tbb::task_group lengthUpdate_;
     std::unique_ptr<FragmentLengthDistribution> fragLengthDist_;
     EquivalenceClassBuilder eqBuilder_;
+    // Where we record the time spent on the burn-in length update
+    std::shared_ptr<PhaseTelemetry> telemetry_;
 
     /** Positional bias things**/
     std::vector<SimplePosBias> posBiasFW_;
@@ -6,85 +6,178 @@
 #include "jellyfish/mer_dna.hpp"
 #include "UtilityFunctions.hpp"
 #include <Eigen/Dense>
+#include <array>
 #include <cmath>
+#include <vector>
 
 using Mer = jellyfish::mer_dna_ns::mer_base_static<uint64_t, 4>;
 
-class SBModel {
+namespace sbmodel {
+// The total number of (sub-context, position) entries in a model
+// with the given orders; 4^{order + 1} for each position.
+constexpr uint32_t tableSize() { return 0; }
+template <typename... OrderTs>
+constexpr uint32_t tableSize(int32_t order, OrderTs... orders) {
+  return (1u << (2 * (order + 1))) + tableSize(orders...);
+}
+}
+
+/**
+ * A variable-order Markov model of the sequence surrounding the start of a
+ * read (after Roberts et al. (2011)).  The context consists of ContextLeft
+ * bases before the read start, the read start itself and ContextRight bases
+ * after it, and Orders gives the order of the model at each of these
+ * positions (from left to right).
+ *
+ * The shape of the model is fixed at compile time, so the shift and mask
+ * that extract the sub-context of each position from a packed context (2
+ * bits per base, with the first base in the most significant bits) are
+ * constants, and the (log) probabilities of all positions live in a single
+ * flat table; those of position i start at _offsets[i].
+ */
+template <int32_t ContextLeft, int32_t ContextRight, int32_t... Orders>
+class SBModelT {
 public:
-  SBModel();   
-  
-  SBModel(const SBModel&) = default;
-  SBModel(SBModel&&) = default;
-  SBModel& operator=(const SBModel&) = default;
-  SBModel& operator=(SBModel&&) = default;
-
-  bool writeBinary(boost::iostreams::filtering_ostream& out) const; 
-
-  inline int32_t contextBefore(bool rc) { return rc ? _contextRight : _contextLeft; }
-  inline int32_t contextAfter(bool rc) { return rc ? _contextLeft : _contextRight; }
-
-    bool addSequence(const char* seqIn, bool revCmp, double weight = 1.0);
-    bool addSequence(const Mer& mer, double weight); 
-
-    Eigen::MatrixXd& counts();
-    Eigen::MatrixXd& marginals();
-  
-    double evaluateLog(const char* seqIn); 
-    double evaluateLog(const Mer& mer);
- 
-  bool normalize();
+  static constexpr int32_t contextLength = sizeof...(Orders);
+  static constexpr uint32_t tableSize = sbmodel::tableSize(Orders...);
 
-  bool checkTransitionProbabilities();
-  
-  void combineCounts(const SBModel& other);
+  static_assert(ContextLeft + ContextRight + 1 == contextLength,
+                "The left and right context length (+1) must match the number of orders given");
+  static_assert(contextLength <= 32, "The context must fit in a 64-bit word");
 
-  void dumpConditionalProbabilities(std::ostream& os);
+  SBModelT();
+
+  SBModelT(const SBModelT&) = default;
+  SBModelT(SBModelT&&) = default;
+  SBModelT& operator=(const SBModelT&) = default;
+  SBModelT& operator=(SBModelT&&) = default;
+
+  bool writeBinary(boost::iostreams::filtering_ostream& out) const;
 
-  int32_t getContextLength(); 
-
-  template <typename CountVecT>
-  bool train(CountVecT& kmerCounts, const uint32_t K);
-  
-  inline double evaluate(uint32_t kmer, uint32_t K) {
-    std::vector<uint32_t> _order{0, 0, 2,2,2,2};
-    double p{1.0};
-    for (int32_t pos = 0; pos < K - _order.back(); ++pos) {
-      uint32_t offset = 2 * (K - (pos + 1) - _order[pos]);
-      auto idx = _getIndex(kmer, offset, _order[pos]);
-      p *= _probs(idx, pos);
+  inline int32_t contextBefore(bool rc) { return rc ? ContextRight : ContextLeft; }
+  inline int32_t contextAfter(bool rc) { return rc ? ContextLeft : ContextRight; }
+
+  /** The packed representation of the context held in `mer`. */
+  static inline uint64_t pack(const Mer& mer) {
+    return mer.get_bits(0, 2 * contextLength);
+  }
+
+  bool addSequence(const char* seqIn, bool revCmp, double weight = 1.0);
+  inline bool addSequence(const Mer& mer, double weight) {
+    addSequence(pack(mer), weight);
+    return true;
+  }
+  inline void addSequence(uint64_t kmer, double weight) {
+    for (int32_t i = 0; i < contextLength; ++i) {
+      _probs[_offsets[i] + ((kmer >> _shift(i)) & _mask(i))] += weight;
+    }
+  }
+
+  /**
+   * Add the `n` packed contexts in `kmers`, the j-th with weight
+   * `weights[j]`.
+   */
+  void addSequences(const uint64_t* kmers, const double* weights, size_t n) {
+    for (int32_t i = 0; i < contextLength; ++i) {
+      double* probs = _probs.data() + _offsets[i];
+      const uint32_t shift = _shift(i);
+      const uint64_t mask = _mask(i);
+      for (size_t j = 0; j < n; ++j) {
+        probs[(kmers[j] >> shift) & mask] += weights[j];
+      }
+    }
+  }
+
+  /**
+   * Append the (weighted) count of every entry of the table to `out`; this
+   * is only meaningful before the model has been normalized.
+   */
+  void appendMasses(std::vector<double>& out) const {
+    out.insert(out.end(), _probs.begin(), _probs.end());
+  }
+
+  Eigen::MatrixXd& marginals();
+
+  double evaluateLog(const char* seqIn);
+  inline double evaluateLog(const Mer& mer) { return evaluateLog(pack(mer)); }
+  inline double evaluateLog(uint64_t kmer) const {
+    double p = 0;
+    for (int32_t i = 0; i < contextLength; ++i) {
+      p += _probs[_offsets[i] + ((kmer >> _shift(i)) & _mask(i))];
     }
     return p;
   }
 
-private:
-  inline uint32_t _getIndex(uint32_t kmer, uint32_t offset, uint32_t _order) {
-    kmer >>= offset;
-    switch (_order) {
-    case 0:
-      return kmer & 0x3;
-    case 1:
-      return kmer & 0xF;
-    case 2:
-      return kmer & 0x3F;
-    default:
-      return 0;
+  /**
+   * Evaluate the (log) probability of each of the `n` packed contexts in
+   * `kmers`, and place it in `out`.
+   */
+  void evaluateLog(const uint64_t* kmers, size_t n, double* out) const {
+    for (size_t j = 0; j < n; ++j) { out[j] = 0.0; }
+    for (int32_t i = 0; i < contextLength; ++i) {
+      const double* probs = _probs.data() + _offsets[i];
+      const uint32_t shift = _shift(i);
+      const uint64_t mask = _mask(i);
+      for (size_t j = 0; j < n; ++j) {
+        out[j] += probs[(kmers[j] >> shift) & mask];
+      }
     }
-    return 0;
   }
-  bool _trained;
 
-  int32_t _contextLength;
-  int32_t _contextLeft;
-  int32_t _contextRight;
+  bool normalize();
+
+  bool checkTransitionProbabilities();
+
+  void combineCounts(const SBModelT& other);
+
+  void dumpConditionalProbabilities(std::ostream& os);
+
+  int32_t getContextLength();
+
+private:
+  static constexpr int32_t _order[contextLength] = {Orders...};
+  static constexpr uint32_t _widths[contextLength] = {(2 * (Orders + 1))...};
 
-  Eigen::MatrixXd _probs;
+  static constexpr uint32_t _shift(int32_t i) { return 2 * (contextLength - (i + 1)); }
+  static constexpr uint64_t _mask(int32_t i) { return (uint64_t(1) << _widths[i]) - 1; }
+
+  bool _trained;
+
+  std::array<double, tableSize> _probs;
+  std::array<uint32_t, contextLength> _offsets;
   Eigen::MatrixXd _marginals;
 
   Mer _mer;
-  std::vector<int32_t> _order;
-  std::vector<int32_t> _shifts;
-  std::vector<int32_t> _widths;
 };
 
+template <int32_t ContextLeft, int32_t ContextRight, int32_t... Orders>
+constexpr int32_t SBModelT<ContextLeft, ContextRight, Orders...>::_order[];
+template <int32_t ContextLeft, int32_t ContextRight, int32_t... Orders>
+constexpr uint32_t SBModelT<ContextLeft, ContextRight, Orders...>::_widths[];
+
+/**
+ * The model used for sequence-specific bias correction; the order at each
+ * position of the context is
+ *
+ *   0  1  2  2  2  2  2  2  2
+ *  -3 -2 -1  0  1  2  3  4  5
+ *
+ * Some alternatives:
+ *
+ * Roberts et al. model
+ *   {0, 0, 0, 0, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 0, 0};
+ *   -8 -7 -6 -5 -4 -3 -2 -1  0  1  2  3  4  5  6  7  8  9  10 11 12
+ *
+ * Roberts et al. model (eXpress)
+ *   {0, 1, 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3};
+ *  -10 -9 -8 -7 -6 -5 -4 -3 -2 -1  0  1  2  3  4  5  6  7  8  9 10
+ *
+ * Short model
+ *   {0, 1, 2, 2, 2, 2};
+ *   -2 -1  0  1  2  3
+ */
+using SBModel = SBModelT<3, 5, 0, 1, 2, 2, 2, 2, 2, 2, 2>;
+
+extern template class SBModelT<3, 5, 0, 1, 2, 2, 2, 2, 2, 2, 2>;
+
 #endif //__SB_MODEL_HPP__
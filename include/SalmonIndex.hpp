@@ -8,7 +8,9 @@ extern "C" {
 #include "utils.h"
 }
 
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
 
 #include <boost/filesystem.hpp>
 #include <boost/range/irange.hpp>
@@ -24,6 +26,7 @@ extern "C" {
 #include "SalmonConfig.hpp"
 #include "SalmonIndexVersionInfo.hpp"
 #include "KmerIntervalMap.hpp"
+#include "IndexUpdate.hpp"
 
 extern "C" {
 int bwa_index(int argc, char* argv[]);
@@ -68,6 +71,17 @@ class SalmonIndex{
                     loadFMDIndex_(indexDir);
                 } else {
                     loadQuasiIndex_(indexDir);
+
+                    // Transcripts that were added to, or removed from, the
+                    // index after it was built (see `salmon index --addTranscripts`)
+                    bfs::path deltaDir = indexDir / "delta";
+                    if (bfs::exists(deltaDir / "versionInfo.json")) {
+                        loadDeltaIndex_(deltaDir);
+                    }
+                    bfs::path maskFile = indexDir / "masked.txt";
+                    if (bfs::exists(maskFile)) {
+                        loadMaskedTranscripts_(maskFile);
+                    }
                 }
 
                 loaded_ = true;
@@ -159,6 +173,40 @@ class SalmonIndex{
             RapMapSAIndex<int32_t, PerfectHash<int32_t>>* quasiIndexPerfectHash32() { return quasiIndexPerfectHash32_.get(); }
             RapMapSAIndex<int64_t, PerfectHash<int64_t>>* quasiIndexPerfectHash64() { return quasiIndexPerfectHash64_.get(); }
 
+            /**
+             * The quasi-index of type QuasiIndexT, or nullptr if the loaded
+             * index is of a different type.
+             */
+            template <typename QuasiIndexT> QuasiIndexT* quasiIndexAs();
+
+            /**
+             * The (small) index of the transcripts that were added after this
+             * index was built.  Their ids follow those of the transcripts
+             * in the base index, i.e. the transcript with id `i` in the delta
+             * index has id `deltaTranscriptOffset() + i` overall.  Returns
+             * nullptr if there is no such index.
+             */
+            template <typename QuasiIndexT> QuasiIndexT* deltaQuasiIndex() {
+                return delta_ ? delta_->quasiIndexAs<QuasiIndexT>() : nullptr;
+            }
+            bool hasDeltaIndex() { return delta_ != nullptr; }
+            /**
+             * The names of the transcripts of the base quasi-index, by id; and
+             * of the added ones, by their id in the delta index.
+             */
+            const std::vector<std::string>& transcriptNames() { return quasiTxpNames_(); }
+            std::vector<std::string> addedTranscriptNames() {
+                return delta_ ? delta_->quasiTxpNames_() : std::vector<std::string>();
+            }
+            uint32_t deltaTranscriptOffset() { return quasiTxpNames_().size(); }
+
+            /**
+             * True if the transcript with id `id` was removed from the index
+             * after it was built; no fragments should be assigned to it.
+             */
+            bool hasMaskedTranscripts() { return !masked_.empty(); }
+            bool isMasked(uint32_t id) { return id < masked_.size() and masked_[id]; }
+
             bool hasAuxKmerIndex() { return versionInfo_.hasAuxKmerIndex(); }
             KmerIntervalMap& auxIndex() { return auxIdx_; }
 
@@ -343,6 +391,56 @@ class SalmonIndex{
           }
 
 
+          bool loadDeltaIndex_(const boost::filesystem::path& deltaDir) {
+              logger_->info("Loading the index of added transcripts");
+              delta_.reset(new SalmonIndex(logger_, SalmonIndexType::QUASI));
+              delta_->load(deltaDir);
+              // The delta index is searched with the same code as the base
+              // index, so they must be of the same type.
+              if (delta_->is64BitQuasi() != largeQuasi_ or
+                  delta_->isPerfectHashQuasi() != perfectHashQuasi_) {
+                  fmt::print(stderr, "The index of added transcripts [{}] is not of the same "
+                                     "type as the index it extends; please re-build the index\n",
+                             deltaDir.string());
+                  std::exit(1);
+              }
+              logger_->info("done");
+              return true;
+          }
+
+          bool loadMaskedTranscripts_(const boost::filesystem::path& maskFile) {
+              std::vector<std::string> maskedNames;
+              std::ifstream maskStream(maskFile.string());
+              std::string name;
+              while (maskStream >> name) { maskedNames.push_back(name); }
+
+              // Only transcripts of the base index are masked (removed
+              // transcripts that had been added are dropped from the delta)
+              size_t numAdded = delta_ ? delta_->quasiTxpNames_().size() : 0;
+              std::vector<std::string> unknown;
+              masked_ = salmon::index_update::maskedTranscripts(quasiTxpNames_(), numAdded,
+                                                                maskedNames, unknown);
+              for (auto& n : unknown) {
+                  logger_->warn("The removed transcript {} is not in the index", n);
+              }
+              size_t numMasked = std::count(masked_.begin(), masked_.end(), true);
+              if (numMasked == 0) {
+                  masked_.clear();
+              }
+              logger_->info("{} transcripts have been removed from the index", numMasked);
+              return true;
+          }
+
+          std::vector<std::string>& quasiTxpNames_() {
+              if (largeQuasi_) {
+                  return perfectHashQuasi_ ? quasiIndexPerfectHash64_->txpNames
+                                           : quasiIndex64_->txpNames;
+              } else {
+                  return perfectHashQuasi_ ? quasiIndexPerfectHash32_->txpNames
+                                           : quasiIndex32_->txpNames;
+              }
+          }
+
           bool loaded_;
           SalmonIndexVersionInfo versionInfo_;
           // Can't think of a generally better way to do this now
@@ -356,9 +454,21 @@ class SalmonIndex{
           std::unique_ptr<RapMapSAIndex<int32_t, PerfectHash<int32_t>>> quasiIndexPerfectHash32_{nullptr};
           std::unique_ptr<RapMapSAIndex<int64_t, PerfectHash<int64_t>>> quasiIndexPerfectHash64_{nullptr};
 
+          std::unique_ptr<SalmonIndex> delta_{nullptr};
+          std::vector<bool> masked_;
+
           bwaidx_t *idx_{nullptr};
           KmerIntervalMap auxIdx_;
           std::shared_ptr<spdlog::logger> logger_;
 };
 
+template <>
+inline RapMapSAIndex<int32_t, DenseHash<int32_t>>* SalmonIndex::quasiIndexAs() { return quasiIndex32(); }
+template <>
+inline RapMapSAIndex<int64_t, DenseHash<int64_t>>* SalmonIndex::quasiIndexAs() { return quasiIndex64(); }
+template <>
+inline RapMapSAIndex<int32_t, PerfectHash<int32_t>>* SalmonIndex::quasiIndexAs() { return quasiIndexPerfectHash32(); }
+template <>
+inline RapMapSAIndex<int64_t, PerfectHash<int64_t>>* SalmonIndex::quasiIndexAs() { return quasiIndexPerfectHash64(); }
+
 #endif //__SALMON_INDEX_HPP
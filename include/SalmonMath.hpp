@@ -29,8 +29,15 @@
 #define BOOST_UNLIKELY(x) (x)
 #endif
 
+#include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fastapprox.h"
 
 namespace salmon {
 
@@ -42,34 +49,170 @@ namespace salmon {
         constexpr double EPSILON = 0.375e-10;
         const double LOG_EPSILON = log(EPSILON);
 
-        inline double log(double v) { return (v > 0) ? std::log(v) : LOG_0; }
-        inline double exp(double v) { return std::exp(v); }
+        /**
+         * The accuracy with which log-space arithmetic (log, exp, logAdd
+         * and logSub below) is performed.  EXACT uses the standard library.
+         * FAST uses a table-driven logAdd (absolute error < 5e-6) and the
+         * approximations of fastapprox.h for everything else (absolute error
+         * in log space, or relative error in linear space, < 2e-4).
+         */
+        enum class Accuracy : uint8_t { EXACT = 0, FAST = 1 };
+
+        // NOTE: This is process-wide, and should be set (once) before
+        // any worker threads are started.
+        inline Accuracy& accuracySetting_() {
+            static Accuracy acc{Accuracy::EXACT};
+            return acc;
+        }
+        inline void setAccuracy(Accuracy acc) { accuracySetting_() = acc; }
+        inline Accuracy accuracy() { return accuracySetting_(); }
+        inline bool useFastMath() { return BOOST_UNLIKELY(accuracySetting_() == Accuracy::FAST); }
+
         inline bool isLog0(double v) { return v == LOG_0; }
         // Taken from https://github.com/adarob/eXpress/blob/master/src/main.h
         inline bool approxEqual(double a, double b, double eps=EPSILON) {
             return std::abs(a-b) <= eps;
         }
 
-        // Taken from https://github.com/adarob/eXpress/blob/master/src/main.h
-        inline double logAdd(double x, double y) {
-            if (std::abs(x) == LOG_0) { return y; }
-            if (std::abs(y) == LOG_0) { return x; }
-            if (y > x) { std::swap(x,y); }
-            double sum = x + std::log(1 + std::exp(y-x));
-            return sum;
+        namespace exact {
+            inline double log(double v) { return (v > 0) ? std::log(v) : LOG_0; }
+            inline double exp(double v) { return std::exp(v); }
+
+            // Taken from https://github.com/adarob/eXpress/blob/master/src/main.h
+            inline double logAdd(double x, double y) {
+                if (std::abs(x) == LOG_0) { return y; }
+                if (std::abs(y) == LOG_0) { return x; }
+                if (y > x) { std::swap(x,y); }
+                double sum = x + std::log(1 + std::exp(y-x));
+                return sum;
+            }
+
+            // Taken from https://github.com/adarob/eXpress/blob/master/src/main.h
+            inline double logSub(double x, double y) {
+                if (std::abs(y) == LOG_0) { return x; }
+                if (x <= y) {
+                    assert(std::fabs(x-y) < 1e-5);
+                    return LOG_0;
+                }
+                double diff = x + std::log(1-std::exp(y-x));
+                return diff;
+            }
         }
 
-        // Taken from https://github.com/adarob/eXpress/blob/master/src/main.h
-        inline double logSub(double x, double y) {
-            if (std::abs(y) == LOG_0) { return x; }
-            if (x <= y) {
-                assert(std::fabs(x-y) < 1e-5);
-                return LOG_0;
+        namespace fast {
+            // Beyond this difference, exp(y - x) no longer changes x + log(1 + exp(y - x))
+            constexpr double LOG_ADD_CUTOFF = -40.0;
+            constexpr double LOG_ADD_TABLE_STEP = 0.01;
+            constexpr size_t LOG_ADD_TABLE_SIZE = 4002;
+
+            // Arguments outside of the range of a float fall back to the exact versions
+            inline double log(double v) {
+                return (v >= FLT_MIN and v <= FLT_MAX) ? ::fastlog(static_cast<float>(v)) : exact::log(v);
+            }
+            inline double exp(double v) {
+                return (v > -87.0 and v < 88.0) ? ::fastexp(static_cast<float>(v)) : std::exp(v);
+            }
+
+            // log(1 + exp(-i * LOG_ADD_TABLE_STEP)) for every i
+            inline const double* logAddTable_() {
+                static const std::vector<double> table = []() -> std::vector<double> {
+                    std::vector<double> t(LOG_ADD_TABLE_SIZE);
+                    for (size_t i = 0; i < LOG_ADD_TABLE_SIZE; ++i) {
+                        t[i] = std::log1p(std::exp(-static_cast<double>(i) * LOG_ADD_TABLE_STEP));
+                    }
+                    return t;
+                }();
+                return table.data();
+            }
+
+            // Here, log(1 + exp(y - x)) is linearly interpolated from a
+            // table; the absolute error is below 5e-6.
+            inline double logAdd(double x, double y) {
+                if (std::abs(x) == LOG_0) { return y; }
+                if (std::abs(y) == LOG_0) { return x; }
+                if (y > x) { std::swap(x,y); }
+                double d = y - x;
+                if (d < LOG_ADD_CUTOFF) { return x; }
+                const double* table = logAddTable_();
+                double pos = -d * (1.0 / LOG_ADD_TABLE_STEP);
+                size_t i = static_cast<size_t>(pos);
+                double frac = pos - i;
+                return x + table[i] + frac * (table[i+1] - table[i]);
+            }
+
+            inline double logSub(double x, double y) {
+                if (std::abs(y) == LOG_0) { return x; }
+                if (x <= y) {
+                    assert(std::fabs(x-y) < 1e-5);
+                    return LOG_0;
+                }
+                double d = y - x;
+                if (d < LOG_ADD_CUTOFF) { return x; }
+                // log(1 - exp(d)) is very sensitive to errors in exp(d) as d -> 0
+                if (d > -0.5) { return exact::logSub(x, y); }
+                return x + ::fastlog(1.0f - ::fastexp(static_cast<float>(d)));
             }
-            double diff = x + std::log(1-std::exp(y-x));
-            return diff;
         }
 
+        inline double log(double v) { return useFastMath() ? fast::log(v) : exact::log(v); }
+        inline double exp(double v) { return useFastMath() ? fast::exp(v) : exact::exp(v); }
+        inline double logAdd(double x, double y) { return useFastMath() ? fast::logAdd(x, y) : exact::logAdd(x, y); }
+        inline double logSub(double x, double y) { return useFastMath() ? fast::logSub(x, y) : exact::logSub(x, y); }
+
+        /**
+         * Batched kernels.  These operate over arrays, and in FAST mode
+         * process 4 values at a time with SSE2 (where available).
+         */
+
+        // v[i] <- exp(v[i]) for i in [0, n)
+        inline void expInPlace(double* v, size_t n) {
+            size_t i{0};
+#ifdef __SSE2__
+            if (useFastMath()) {
+                for (; i + 4 <= n; i += 4) {
+                    if (std::min({v[i], v[i+1], v[i+2], v[i+3]}) <= -87.0 or
+                        std::max({v[i], v[i+1], v[i+2], v[i+3]}) >= 88.0) {
+                        for (size_t j = i; j < i + 4; ++j) { v[j] = fast::exp(v[j]); }
+                        continue;
+                    }
+                    v4sf x = _mm_setr_ps(v[i], v[i+1], v[i+2], v[i+3]);
+                    v4sfindexer r = { vfastexp(x) };
+                    v[i] = r.array[0]; v[i+1] = r.array[1];
+                    v[i+2] = r.array[2]; v[i+3] = r.array[3];
+                }
+            }
+#endif // __SSE2__
+            for (; i < n; ++i) { v[i] = exp(v[i]); }
+        }
+
+        // log(sum_i exp(v[i])) for i in [0, n); LOG_0 if n is 0
+        inline double logSumExp(const double* v, size_t n) {
+            double maxVal{-HUGE_VAL};
+            for (size_t i = 0; i < n; ++i) {
+                if (v[i] != LOG_0 and v[i] > maxVal) { maxVal = v[i]; }
+            }
+            if (maxVal == -HUGE_VAL) { return LOG_0; }
+            double sum{0.0};
+            size_t i{0};
+#ifdef __SSE2__
+            if (useFastMath()) {
+                for (; i + 4 <= n; i += 4) {
+                    double d[4];
+                    for (size_t j = 0; j < 4; ++j) {
+                        // LOG_0 entries contribute nothing
+                        d[j] = (v[i+j] == LOG_0) ? -126.0 : std::max(v[i+j] - maxVal, -126.0);
+                    }
+                    v4sf x = _mm_setr_ps(d[0], d[1], d[2], d[3]);
+                    v4sfindexer r = { vfastexp(x) };
+                    sum += r.array[0] + r.array[1] + r.array[2] + r.array[3];
+                }
+            }
+#endif // __SSE2__
+            for (; i < n; ++i) {
+                if (v[i] != LOG_0) { sum += exp(v[i] - maxVal); }
+            }
+            return maxVal + log(sum);
+        }
 
     }
 
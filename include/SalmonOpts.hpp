@@ -6,10 +6,17 @@
 // Logger includes
 #include "spdlog/spdlog.h"
 
+#include "AsyncOutputWriter.hpp"
+#include "AuxModelTracker.hpp"
+#include "PhaseTelemetry.hpp"
+
 #include <fstream>
 #include <ostream>
 #include <memory> // for shared_ptr
 
+class BiasBackground;
+class EarlyStopMonitor;
+namespace salmon { class TaskScheduler; namespace numa { class Topology; } }
 
 /**
   * A structure to hold some common options used
@@ -43,6 +50,8 @@ struct SalmonOpts {
 
     bool dumpEq; 	     // Dump the equivalence classes and counts to file
 
+    bool binaryOutput{false}; // Also write outputs in the binary columnar format (see ColumnarFile.hpp)
+
     bool splitSpanningSeeds; // Attempt to split seeds that span multiple transcripts.
 
     bool noFragLengthDist ; // Don't give a fragment assignment a likelihood based on an emperically
@@ -52,6 +61,8 @@ struct SalmonOpts {
                                       // account when computing the probability that a
                                      // fragment was generated from a transcript.
 
+    bool fastMath{false}; // Use fast (approximate) log-space arithmetic (see SalmonMath.hpp)
+
     bool noBiasLengthThreshold; // Don't require that the recomputed effective length for a target
                                 // be above a threshold before applying it.
     bool useBiasLengthThreshold; // Don't require that the recomputed effective length for a target
@@ -107,12 +118,15 @@ struct SalmonOpts {
                             // evaluating gc-bias for effective length correction.
 
     bool strictIntersect; // Use strict rather than fuzzy intersection in quasi-mapping
+
     bool useMassBanking; // DEPRECATED
 
     bool sensitive; // Perform splitting of long SMEMs into MEMs
 
     bool extraSeedPass; // Perform extra pass trying to find seeds to cover the read
 
+    uint32_t smemInterleave{0}; // Interleave the SMEM searches of this many reads (0 = one read at a time)
+
     bool disableMappingCache; // Don't write mapping results to temporary mapping cache file
 
     boost::filesystem::path outputDirectory; // Quant output directory
@@ -131,10 +145,12 @@ struct SalmonOpts {
     std::string qmFileName;
     std::ofstream qmFile;
     std::unique_ptr<std::ostream> qmStream{nullptr};
-    std::shared_ptr<spdlog::logger> qmLog{nullptr};
+    std::shared_ptr<spdlog::logger> qmLog{nullptr}; // used only for the SAM header
+    std::unique_ptr<AsyncOutputWriter> qmWriter{nullptr}; // used for the mapping records
 
 
   std::unique_ptr<std::ofstream> unmappedFile{nullptr};
+  std::unique_ptr<AsyncOutputWriter> unmappedWriter{nullptr};
     bool writeUnmappedNames; // write the names of unmapped reads
     bool sampleOutput; // Sample alignments according to posterior estimates of transcript abundance.
     bool sampleUnaligned; // Pass along un-aligned reads in the sampling.
@@ -164,6 +180,34 @@ struct SalmonOpts {
     std::shared_ptr<spdlog::logger> jointLog{nullptr};
     std::shared_ptr<spdlog::logger> fileLog{nullptr};
 
+    // Per-phase timing and memory use (written to meta_info.json)
+    std::shared_ptr<PhaseTelemetry> telemetry{std::make_shared<PhaseTelemetry>()};
+    uint32_t telemetryInterval{0}; // If > 0, write a telemetry snapshot this often (in seconds)
+
+    // Which of the auxiliary models are still being (fully) updated
+    std::shared_ptr<AuxModelTracker> auxModels{std::make_shared<AuxModelTracker>()};
+    double auxModelTolerance{0.005}; // If > 0, stop updating models that change less than this
+
+    // The seed of all of the random number streams of a run
+    uint64_t rngSeed{0};
+
+    // Related to streaming input
+    uint32_t streamSnapshotInterval{0}; // If > 0, write interim estimates this often (in seconds)
+    uint64_t maxEqClasses{0}; // If > 0, keep at most this many equivalence classes
+    uint64_t maxEqClassMemory{0}; // If > 0, keep the equivalence classes under this many MiB
+    uint64_t minEqClassCount{0}; // If > 1, merge or drop classes seen fewer times before the EM
+    double earlyStopTolerance{0.0}; // If > 0, stop reading once the estimates change less than this
+    std::shared_ptr<EarlyStopMonitor> earlyStop{nullptr};
+
+    std::string numaPolicy{"none"}; // none, local (pin workers to nodes) or interleave (and spread the index)
+    std::shared_ptr<salmon::numa::Topology> numa{nullptr}; // Set if workers should be pinned
+
+    // The pool shared by all of the parallel phases (created once per run)
+    std::shared_ptr<salmon::TaskScheduler> scheduler{nullptr};
+
+    bool exactBiasBackground{false}; // Compute the bias background only from the offline estimates
+    std::shared_ptr<BiasBackground> biasBackground{nullptr}; // Computed during mapping, if set
+
     // Related to caching and threading
     uint32_t mappingCacheMemoryLimit;
     uint32_t numThreads;
@@ -0,0 +1,130 @@
+#ifndef __SALMON_RANDOM_HPP__
+#define __SALMON_RANDOM_HPP__
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace salmon {
+namespace rng {
+
+/**
+ * The stochastic phases of a run; each phase draws from its own family of
+ * streams, so that (e.g.) changing the number of bootstraps doesn't change
+ * the draws made while mapping the reads.
+ */
+enum class Phase : uint8_t {
+    ONLINE = 1,       // the online phase (one stream per worker thread)
+    SAMPLING = 2,     // sampling alignments (--sampleOut)
+    BOOTSTRAP = 3,    // one stream per bootstrap replicate
+    GIBBS = 4,        // one stream per Gibbs chain
+    FLD_SAMPLES = 5,  // samples from the fragment length distribution
+    REFERENCE = 6     // replacing ambiguous reference nucleotides
+};
+
+/**
+ * The Philox4x32-10 counter-based generator of Salmon, Moraes, Dror & Shaw,
+ * "Parallel random numbers: as easy as 1, 2, 3" (SC '11).
+ *
+ * Each output block is a keyed bijection of a 128-bit counter, so a stream
+ * is just a (key, counter prefix) pair: constructing one costs nothing,
+ * streams with different prefixes never overlap, and the values a stream
+ * produces don't depend on which thread draws them or when.  The key is
+ * the run's seed, and the upper half of the counter names the phase and
+ * the stream within it (e.g. the bootstrap number).
+ *
+ * This satisfies the requirements of a UniformRandomBitGenerator, so it
+ * can be used with the <random> distributions.
+ */
+class Philox4x32 {
+public:
+    using result_type = uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    explicit Philox4x32(uint64_t seed = 0, uint64_t streamID = 0) :
+        key_{{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}},
+        ctr_{{0, 0, static_cast<uint32_t>(streamID), static_cast<uint32_t>(streamID >> 32)}},
+        next_(4) {}
+
+    result_type operator()() {
+        if (next_ >= 4) { refill_(); }
+        uint64_t r = (static_cast<uint64_t>(out_[next_]) << 32) | out_[next_ + 1];
+        next_ += 2;
+        return r;
+    }
+
+    /** A uniform double in [0, 1), with 53 random bits. */
+    double uniform01() {
+        return static_cast<double>(operator()() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /** Skip the next `n` outputs. */
+    void discard(uint64_t n) {
+        while (n > 0 and next_ < 4) { next_ += 2; --n; }
+        uint64_t blocks = n / 2;
+        uint64_t lo = (static_cast<uint64_t>(ctr_[1]) << 32) | ctr_[0];
+        lo += blocks;
+        ctr_[0] = static_cast<uint32_t>(lo);
+        ctr_[1] = static_cast<uint32_t>(lo >> 32);
+        if (n % 2 == 1) { operator()(); }
+    }
+
+    /**
+     * The raw block function: apply the 10 Philox rounds to `ctr` under
+     * `key`.
+     */
+    static std::array<uint32_t, 4> block(std::array<uint32_t, 4> ctr,
+                                         std::array<uint32_t, 2> key) {
+        for (int r = 0; r < 10; ++r) {
+            if (r > 0) {
+                key[0] += 0x9E3779B9;
+                key[1] += 0xBB67AE85;
+            }
+            uint64_t p0 = static_cast<uint64_t>(0xD2511F53) * ctr[0];
+            uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57) * ctr[2];
+            ctr = {{static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0],
+                    static_cast<uint32_t>(p1),
+                    static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1],
+                    static_cast<uint32_t>(p0)}};
+        }
+        return ctr;
+    }
+
+private:
+    void refill_() {
+        out_ = block(ctr_, key_);
+        if (++ctr_[0] == 0) { ++ctr_[1]; }
+        next_ = 0;
+    }
+
+    std::array<uint32_t, 2> key_;
+    std::array<uint32_t, 4> ctr_;
+    std::array<uint32_t, 4> out_;
+    uint32_t next_;
+};
+
+using RNG = Philox4x32;
+
+/**
+ * The `index`-th stream of phase `phase` for a run with seed `seed`.  The
+ * index gets the low 56 bits of the counter prefix and the phase the top 8.
+ */
+inline RNG stream(uint64_t seed, Phase phase, uint64_t index) {
+    uint64_t streamID = (static_cast<uint64_t>(phase) << 56) |
+                        (index & ((uint64_t(1) << 56) - 1));
+    return RNG(seed, streamID);
+}
+
+/** A seed for runs in which the user didn't ask for one. */
+inline uint64_t randomSeed() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+}
+}
+
+#endif // __SALMON_RANDOM_HPP__
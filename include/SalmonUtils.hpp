@@ -34,6 +34,7 @@ extern "C" {
 class ReadExperiment;
 class LibraryFormat;
 class FragmentLengthDistribution;
+struct BiasParams;
 
 namespace salmon{
 namespace utils {
@@ -121,6 +122,15 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
                                                       Eigen::VectorXd& effLensIn,
                                                       AbundanceVecT& alphas, bool finalRound=false);
 
+/**
+ * Compute the expected bias background (into sopt.biasBackground, if it is
+ * set) from the online abundance estimates and burn-in effective lengths,
+ * so that updateEffectiveLengths() need only bring it up to date.  This is
+ * meant to run concurrently with the mapping of the rest of the reads.
+ */
+template <typename ReadExpT>
+void precomputeBiasBackground(const SalmonOpts& sopt, ReadExpT& readExp);
+
 
 /*
  * Use atomic compare-and-swap to update val to
@@ -165,6 +175,18 @@ inline void incLoop(tbb::atomic<double>& val, double inc) {
 
 bool processQuantOptions(SalmonOpts& sopt, boost::program_options::variables_map& vm, int32_t numBiasSamples);
 
+/**
+ * Called by a worker thread after it has processed `numNewFragments` more
+ * fragments; every so often, this snapshots the auxiliary models the thread
+ * is still updating (its own bias models and the shared fragment length
+ * distribution, until burn-in) so that sopt.auxModels can decide which of
+ * them have settled.
+ */
+void trackAuxModels(const SalmonOpts& sopt, BiasParams& biasParams,
+                    FragmentLengthDistribution& fragLengthDist,
+                    uint64_t numNewFragments, uint64_t numAssignedFragments,
+                    bool burnedIn);
+
 
 
 void aggregateEstimatesToGeneLevel(TranscriptGeneMap& tgm, boost::filesystem::path& inputPath);
@@ -0,0 +1,34 @@
+#ifndef __SAMPLE_SHEET_HPP__
+#define __SAMPLE_SHEET_HPP__
+
+#include <string>
+#include <vector>
+
+namespace salmon {
+
+/**
+ * A single entry of a batch-mode sample sheet.
+ */
+struct SampleSheetEntry {
+  std::string name;
+  std::string libType;
+  std::vector<std::string> unmated;
+  std::vector<std::string> mates1;
+  std::vector<std::string> mates2;
+};
+
+// Split a comma-separated list of read files
+std::vector<std::string> splitFileList(const std::string& files);
+
+/**
+ * Parse the sample sheet @fname into @samples.  The name of each sample is
+ * the name of its output directory, so it must be distinct, and must be a
+ * single (relative) path component.  Returns false, after reporting the
+ * offending line, if the sample sheet is malformed.
+ */
+bool parseSampleSheet(const std::string& fname,
+                      std::vector<SampleSheetEntry>& samples);
+
+}
+
+#endif // __SAMPLE_SHEET_HPP__
@@ -54,6 +54,7 @@ extern "C" {
 #include "SalmonUtils.hpp"
 #include "SalmonConfig.hpp"
 #include "SalmonOpts.hpp"
+#include "SalmonRandom.hpp"
 #include "OutputUnmappedFilter.hpp"
 
 namespace salmon {
@@ -84,14 +85,13 @@ namespace salmon {
                     const SalmonOpts& salmonOpts,
                     bool& burnedIn,
                     std::atomic<size_t>& processedReads,
-                    OutputQueue<FragT>& outputQueue) {
+                    OutputQueue<FragT>& outputQueue,
+                    uint32_t threadIdx) {
 
-                // Seed with a real random value, if available
-                std::random_device rd;
                 auto log = spdlog::get("jointLog");
 
-                // Create a random uniform distribution
-                std::default_random_engine eng(rd());
+                // This thread's stream of random numbers
+                auto eng = salmon::rng::stream(salmonOpts.rngSeed, salmon::rng::Phase::SAMPLING, threadIdx);
                 std::uniform_real_distribution<> uni(0.0, 1.0 + std::numeric_limits<double>::min());
 
                 using salmon::math::LOG_0;
@@ -359,7 +359,8 @@ namespace salmon {
                             std::ref(salmonOpts),
                             std::ref(burnedIn),
                             std::ref(processedReads),
-                            std::ref(outQueue));
+                            std::ref(outQueue),
+                            i);
                 }
 
                 std::thread outputThread(
@@ -16,6 +16,11 @@ public:
   // and add @mass to the appropriate bin
   void addMass(int32_t pos, int32_t length, double mass);
 
+  // The number of bins, and the bin for @pos on a transcript of
+  // length @length
+  int32_t numBins() const { return numBins_; }
+  int32_t binOf(int32_t pos, int32_t length) const;
+
   // Project, via linear interpolation, the weights contained in "bins"
   // into the vector @out.
   void projectWeights(std::vector<double>& out);
@@ -24,6 +29,9 @@ public:
   // with this distribution
   void combine(const SimplePosBias& other);
 
+  // Append the (non-logged) mass of each bin to @out
+  void appendMasses(std::vector<double>& out) const;
+
   // We're finished updating this distribution, so
   // compute the cdf etc.
   void finalize();
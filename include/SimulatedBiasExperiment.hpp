@@ -0,0 +1,179 @@
+#ifndef __SIMULATED_BIAS_EXPERIMENT_HPP__
+#define __SIMULATED_BIAS_EXPERIMENT_HPP__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FragmentLengthDistribution.hpp"
+#include "GCFragModel.hpp"
+#include "SBModel.hpp"
+#include "SalmonOpts.hpp"
+#include "SalmonUtils.hpp"
+#include "SimplePosBias.hpp"
+#include "Transcript.hpp"
+
+namespace salmon {
+namespace detail {
+/**
+ * Not part of the API; used only by the unit tests and salmon_bench.
+ *
+ * A stand-in for a ReadExperiment with just what the bias correction
+ * (utils::precomputeBiasBackground and utils::updateEffectiveLengths)
+ * needs, so that it can be run without an index or reads: random
+ * transcripts of varying GC content, and observed bias models filled in
+ * from fragments drawn from them with a preference for GC-balanced
+ * fragments that start towards the 5' end.  The abundances of the
+ * transcripts are those that the fragments were drawn with; they can be
+ * changed (with setAbundances()) to play the part of the online estimates.
+ */
+class SimulatedBiasExperiment {
+public:
+    SimulatedBiasExperiment(const SalmonOpts& sopt, size_t numTranscripts,
+                            size_t numFragments, uint32_t seed) :
+        posBiasFW_(5),
+        posBiasRC_(5),
+        expectedGC_(sopt.numConditionalGCBins, sopt.numFragGCBins,
+                    distribution_utils::DistributionSpace::LOG),
+        observedGC_(sopt.numConditionalGCBins, sopt.numFragGCBins,
+                    distribution_utils::DistributionSpace::LOG) {
+        using salmon::utils::Direction;
+        double meanFragLen = static_cast<double>(sopt.fragLenDistPriorMean);
+        fragLengthDist_.reset(new FragmentLengthDistribution(
+            1.0, sopt.fragLenDistMax, sopt.fragLenDistPriorMean,
+            sopt.fragLenDistPriorSD, 4, 0.5, 1));
+
+        std::mt19937 gen(seed);
+        std::lognormal_distribution<> lenDist(7.0, 0.5);
+        std::uniform_real_distribution<> gcDist(0.35, 0.65);
+        std::uniform_real_distribution<> uni(0.0, 1.0);
+        std::lognormal_distribution<> abundanceDist(0.0, 1.5);
+
+        transcripts_.reserve(numTranscripts);
+        std::vector<double> alphas(numTranscripts);
+        std::vector<double> samplingWeights(numTranscripts);
+        for (size_t i = 0; i < numTranscripts; ++i) {
+            uint32_t len = std::max(300u, static_cast<uint32_t>(lenDist(gen)));
+            std::string name = "txp" + std::to_string(i);
+            transcripts_.emplace_back(i, name.c_str(), len, 0.005);
+            auto& txp = transcripts_.back();
+
+            double gc = gcDist(gen);
+            char* seq = new char[len + 1];
+            for (uint32_t j = 0; j < len; ++j) {
+                bool strong = uni(gen) < gc;
+                seq[j] = strong ? "GC"[gen() % 2] : "AT"[gen() % 2];
+            }
+            seq[len] = '\0';
+            txp.setSequenceOwned(seq, true, sopt.gcSampFactor);
+            // The length classes of ReadExperiment::setLengthClass_
+            uint32_t lc = (len <= 791) ? 0 : (len <= 1265) ? 1 :
+                          (len <= 1707) ? 2 : (len <= 2433) ? 3 : 4;
+            txp.lengthClassIndex(lc);
+            txp.EffectiveLength = std::max(1.0, len - meanFragLen);
+            txp.setCachedLogEffectiveLength(std::log(txp.EffectiveLength));
+            txp.setActive();
+
+            alphas[i] = abundanceDist(gen);
+            samplingWeights[i] = alphas[i] * txp.EffectiveLength;
+        }
+
+        // Draw the fragments
+        std::discrete_distribution<size_t> txpDist(samplingWeights.begin(),
+                                                   samplingWeights.end());
+        std::normal_distribution<> fragLenDist(meanFragLen, sopt.fragLenDistPriorSD);
+        auto& seqFW = readBiasModelObserved(Direction::FORWARD);
+        auto& seqRC = readBiasModelObserved(Direction::REVERSE_COMPLEMENT);
+        Mer mer;
+        size_t numDrawn{0};
+        while (numDrawn < numFragments) {
+            auto& txp = transcripts_[txpDist(gen)];
+            int32_t len = static_cast<int32_t>(txp.RefLength);
+            int32_t fl = std::lrint(fragLenDist(gen));
+            if (fl < 50 or fl >= len) { continue; }
+            int32_t start = std::uniform_int_distribution<int32_t>(0, len - fl)(gen);
+            int32_t end = start + fl - 1;
+
+            double gcDev = (txp.gcFrac(start, end) - 50.0) / 20.0;
+            double pAccept = std::exp(-gcDev * gcDev) *
+                             (1.0 - 0.5 * start / static_cast<double>(len));
+            if (uni(gen) >= pAccept) { continue; }
+            ++numDrawn;
+
+            fragLengthDist_->addVal(fl, salmon::math::LOG_1);
+            observedGC_.inc(txp.gcDesc(start, end), salmon::math::LOG_1);
+            auto lc = txp.lengthClassIndex();
+            posBiasFW_[lc].addMass(start, len, salmon::math::LOG_1);
+            posBiasRC_[lc].addMass(end, len, salmon::math::LOG_1);
+            if (start >= seqFW.contextBefore(false) and
+                start + seqFW.contextAfter(false) < len) {
+                mer.from_chars(txp.Sequence() + start - seqFW.contextBefore(false));
+                seqFW.addSequence(mer, 1.0);
+            }
+            if (end >= seqRC.contextBefore(true) and
+                end + seqRC.contextAfter(true) < len) {
+                mer.from_chars(txp.Sequence() + end - seqRC.contextBefore(true));
+                mer.reverse_complement();
+                seqRC.addSequence(mer, 1.0);
+            }
+        }
+        observedGC_.normalize();
+        for (size_t i = 0; i < posBiasFW_.size(); ++i) {
+            posBiasFW_[i].finalize();
+            posBiasRC_[i].finalize();
+        }
+        numAssignedFragments_ = numFragments;
+        setAbundances(alphas);
+    }
+
+    /**
+     * Make the (relative) abundances of the transcripts `alphas`, as the
+     * online estimates would be.
+     */
+    void setAbundances(const std::vector<double>& alphas) {
+        for (size_t i = 0; i < transcripts_.size(); ++i) {
+            transcripts_[i].setMass((alphas[i] > 0.0) ? std::log(alphas[i])
+                                                      : salmon::math::LOG_0);
+        }
+    }
+
+    std::vector<Transcript>& transcripts() { return transcripts_; }
+    uint64_t numAssignedFragments() { return numAssignedFragments_; }
+    FragmentLengthDistribution* fragmentLengthDistribution() const {
+        return fragLengthDist_.get();
+    }
+    double gcFracFwd() const { return 0.5; }
+    double gcFracRC() const { return 0.5; }
+    GCFragModel& expectedGCBias() { return expectedGC_; }
+    GCFragModel& observedGC() { return observedGC_; }
+    std::vector<SimplePosBias>& posBias(salmon::utils::Direction dir) {
+        return (dir == salmon::utils::Direction::FORWARD) ? posBiasFW_ : posBiasRC_;
+    }
+    SBModel& readBiasModelObserved(salmon::utils::Direction dir) {
+        return (dir == salmon::utils::Direction::FORWARD) ? readBiasModelObserved_[0]
+                                                          : readBiasModelObserved_[1];
+    }
+    void setReadBiasModelExpected(SBModel&& model, salmon::utils::Direction dir) {
+        size_t idx = (dir == salmon::utils::Direction::FORWARD) ? 0 : 1;
+        readBiasModelExpected_[idx] = std::move(model);
+    }
+
+private:
+    std::vector<Transcript> transcripts_;
+    uint64_t numAssignedFragments_{0};
+    std::unique_ptr<FragmentLengthDistribution> fragLengthDist_{nullptr};
+    std::vector<SimplePosBias> posBiasFW_;
+    std::vector<SimplePosBias> posBiasRC_;
+    GCFragModel expectedGC_;
+    GCFragModel observedGC_;
+    SBModel readBiasModelObserved_[2];
+    SBModel readBiasModelExpected_[2];
+};
+}
+}
+
+#endif // __SIMULATED_BIAS_EXPERIMENT_HPP__
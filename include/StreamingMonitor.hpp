@@ -0,0 +1,191 @@
+#ifndef __STREAMING_MONITOR_HPP__
+#define __STREAMING_MONITOR_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "spdlog/fmt/fmt.h"
+#include "spdlog/spdlog.h"
+
+#include "EquivalenceClassBuilder.hpp"
+#include "SalmonMath.hpp"
+#include "SalmonOpts.hpp"
+#include "Transcript.hpp"
+
+/**
+ * Watches the online phase of quantification while the reads are being
+ * processed.  This is what makes it reasonable to quantify reads that are
+ * streamed in (e.g. from a pipe) and whose end may be a long way off:
+ *
+ *  - Every `streamSnapshotInterval` seconds, the current online estimates
+ *    (i.e. the forgetting-mass weighted masses of the transcripts) are
+ *    written to <output>/interim/quant.sf.  The file is written to a
+ *    temporary and then renamed, so a reader never sees a partial file.
+ *
+ *  - If `maxEqClasses` (or `maxEqClassMemory`) is > 0, then whenever there
+ *    are more than this many equivalence classes (or they take more than
+ *    this many MiB), the least-observed are merged into near-identical
+ *    classes, or dropped, so that the memory required for the offline
+ *    phase stays bounded.
+ */
+class StreamingMonitor {
+public:
+    StreamingMonitor(std::vector<Transcript>& transcripts,
+                     EquivalenceClassBuilder& eqBuilder,
+                     const SalmonOpts& sopt,
+                     std::atomic<uint64_t>& numAssignedFragments) :
+        transcripts_(transcripts), eqBuilder_(eqBuilder), sopt_(sopt),
+        numAssignedFragments_(numAssignedFragments) {}
+
+    StreamingMonitor(const StreamingMonitor&) = delete;
+    StreamingMonitor& operator=(const StreamingMonitor&) = delete;
+
+    ~StreamingMonitor() { stop(); }
+
+    bool enabled() const {
+        return sopt_.streamSnapshotInterval > 0 or sopt_.maxEqClasses > 0 or
+            sopt_.maxEqClassMemory > 0;
+    }
+
+    void start() {
+        if (thread_.joinable() or !enabled()) { return; }
+        // If no snapshots are requested, we still check the number of
+        // equivalence classes every 10 seconds
+        uint32_t intervalSecs = (sopt_.streamSnapshotInterval > 0) ?
+            sopt_.streamSnapshotInterval : 10;
+        if (sopt_.streamSnapshotInterval > 0) {
+            boost::filesystem::create_directories(interimDir_());
+        }
+        stop_ = false;
+        thread_ = std::thread([this, intervalSecs]() -> void {
+            std::unique_lock<std::mutex> l(mutex_);
+            while (!cv_.wait_for(l, std::chrono::seconds(intervalSecs),
+                                 [this]() { return stop_; })) {
+                tick_();
+            }
+        });
+    }
+
+    void stop() {
+        if (!thread_.joinable()) { return; }
+        {
+            std::lock_guard<std::mutex> l(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+        if (sopt_.streamSnapshotInterval > 0) {
+            sopt_.fileLog->info("Wrote {} interim snapshots of the online estimates",
+                                numSnapshots_);
+        }
+    }
+
+private:
+    boost::filesystem::path interimDir_() const {
+        return sopt_.outputDirectory / "interim";
+    }
+
+    void tick_() {
+        if (sopt_.maxEqClasses > 0) {
+            // Compact down to 3/4 of the limit, so that we don't have to
+            // do this again on the very next tick.
+            size_t numRemoved = eqBuilder_.compact(sopt_.maxEqClasses,
+                                                   (sopt_.maxEqClasses / 4) * 3);
+            if (numRemoved > 0) {
+                sopt_.fileLog->info("Merged or dropped {} rarely-observed equivalence "
+                                    "classes (limit = {})", numRemoved, sopt_.maxEqClasses);
+            }
+        }
+        if (sopt_.maxEqClassMemory > 0) {
+            size_t numRemoved = eqBuilder_.compactToMemory(sopt_.maxEqClassMemory << 20);
+            if (numRemoved > 0) {
+                sopt_.fileLog->info("Merged or dropped {} rarely-observed equivalence "
+                                    "classes (limit = {} MiB)", numRemoved,
+                                    sopt_.maxEqClassMemory);
+            }
+        }
+        if (sopt_.streamSnapshotInterval > 0) {
+            writeSnapshot_();
+        }
+    }
+
+    void writeSnapshot_() {
+        namespace bfs = boost::filesystem;
+        using salmon::math::LOG_0;
+
+        uint64_t numAssigned = numAssignedFragments_;
+        if (numAssigned == 0) { return; }
+
+        // The masses are updated concurrently with this; that's fine, since
+        // we only need a consistent-enough view for an interim estimate.
+        size_t numTranscripts = transcripts_.size();
+        std::vector<double> logMasses(numTranscripts);
+        double logTotalMass{LOG_0};
+        for (size_t i = 0; i < numTranscripts; ++i) {
+            logMasses[i] = transcripts_[i].mass(false);
+            logTotalMass = salmon::math::logAdd(logTotalMass, logMasses[i]);
+        }
+        if (logTotalMass == LOG_0) { return; }
+
+        std::vector<double> counts(numTranscripts);
+        std::vector<double> effLengths(numTranscripts);
+        double tfracDenom{0.0};
+        for (size_t i = 0; i < numTranscripts; ++i) {
+            double frac = std::exp(logMasses[i] - logTotalMass);
+            counts[i] = frac * numAssigned;
+            effLengths[i] = std::exp(transcripts_[i].getCachedLogEffectiveLength());
+            tfracDenom += frac / effLengths[i];
+        }
+
+        bfs::path fname = interimDir_() / "quant.sf";
+        bfs::path tmpName = interimDir_() / "quant.sf.tmp";
+        {
+            std::unique_ptr<std::FILE, int (*)(std::FILE *)> output(
+                std::fopen(tmpName.c_str(), "w"), std::fclose);
+            if (!output) {
+                sopt_.jointLog->warn("Could not open {} to write an interim snapshot",
+                                     tmpName.string());
+                return;
+            }
+            fmt::print(output.get(), "Name\tLength\tEffectiveLength\tTPM\tNumReads\n");
+            double million = 1000000.0;
+            for (size_t i = 0; i < numTranscripts; ++i) {
+                auto& t = transcripts_[i];
+                double tpm = (counts[i] / numAssigned / effLengths[i]) / tfracDenom * million;
+                fmt::print(output.get(), "{}\t{}\t{}\t{}\t{}\n",
+                           t.RefName, t.RefLength, effLengths[i], tpm, counts[i]);
+            }
+        }
+        boost::system::error_code ec;
+        bfs::rename(tmpName, fname, ec);
+        if (ec) {
+            sopt_.jointLog->warn("Could not write interim snapshot {}: {}",
+                                 fname.string(), ec.message());
+            return;
+        }
+        ++numSnapshots_;
+    }
+
+    std::vector<Transcript>& transcripts_;
+    EquivalenceClassBuilder& eqBuilder_;
+    const SalmonOpts& sopt_;
+    std::atomic<uint64_t>& numAssignedFragments_;
+    uint64_t numSnapshots_{0};
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_{false};
+};
+
+#endif // __STREAMING_MONITOR_HPP__
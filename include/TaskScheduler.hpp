@@ -0,0 +1,79 @@
+#ifndef __TASK_SCHEDULER_HPP__
+#define __TASK_SCHEDULER_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+#include "tbb/task_arena.h"
+#include "tbb/task_group.h"
+#include "tbb/task_scheduler_init.h"
+
+namespace salmon {
+
+/**
+ * The single pool of worker threads used by every parallel phase of a run
+ * (loading the transcripts, the EM, bootstrapping and Gibbs sampling).
+ *
+ * It is created once, on the main thread, with the run's thread budget,
+ * and lives until the run is over; the phases just submit work to it
+ * (through tbb::parallel_for and friends, or runInBackground), rather than
+ * each starting (and tearing down) a scheduler of its own.  Idle workers
+ * sleep in the pool, and any work submitted by one phase can be picked up
+ * by the threads that another phase leaves idle, so phases that don't
+ * depend on each other (e.g. writing the final outputs and drawing the
+ * bootstrap samples) overlap.
+ *
+ * The read parsing and mapping threads are not part of the pool; they block
+ * on each other's queues, which the pool's workers must never do.  They can
+ * still hand work to the pool with runFromOutside() (e.g. the update of the
+ * effective lengths once burn-in is reached).
+ */
+class TaskScheduler {
+public:
+    explicit TaskScheduler(uint32_t numThreads) :
+        numThreads_(std::max(numThreads, uint32_t(1))),
+        init_(static_cast<int>(numThreads_)),
+        arena_(static_cast<int>(numThreads_)) {}
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    ~TaskScheduler() { background_.wait(); }
+
+    uint32_t numThreads() const { return numThreads_; }
+
+    /**
+     * Run `job` on the pool while the caller goes on with other work.  Any
+     * exception that it throws is re-thrown by waitForBackground().
+     */
+    void runInBackground(std::function<void()> job) { background_.run(std::move(job)); }
+
+    /** Wait for every job passed to runInBackground() to finish. */
+    void waitForBackground() { background_.wait(); }
+
+    /**
+     * Run `job` on the pool, in `group`, from a thread that is not one of
+     * the pool's (such as a mapping thread), and return without waiting for
+     * it.  The job must be waited for with waitFromOutside(group).
+     */
+    void runFromOutside(tbb::task_group& group, std::function<void()> job) {
+        arena_.execute([&group, &job]() -> void { group.run(std::move(job)); });
+    }
+
+    /** Wait for (and help with) the jobs passed to runFromOutside() in `group`. */
+    void waitFromOutside(tbb::task_group& group) {
+        arena_.execute([&group]() -> void { group.wait(); });
+    }
+
+private:
+    uint32_t numThreads_;
+    tbb::task_scheduler_init init_;
+    tbb::task_group background_;
+    // The arena through which threads outside of the pool submit work
+    tbb::task_arena arena_;
+};
+
+}
+
+#endif // __TASK_SCHEDULER_HPP__
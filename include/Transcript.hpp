@@ -5,6 +5,7 @@
 #include <cmath>
 #include <limits>
 #include <memory>
+#include <thread>
 #include "GCFragModel.hpp"
 #include "SalmonStringUtils.hpp"
 #include "SalmonUtils.hpp"
@@ -17,7 +18,7 @@ class Transcript {
 public:
 
     Transcript() :
-        RefName(nullptr), RefLength(std::numeric_limits<uint32_t>::max()),
+        RefName(""), RefLength(std::numeric_limits<uint32_t>::max()),
         EffectiveLength(-1.0), id(std::numeric_limits<uint32_t>::max()),
         logPerBasePrior_(salmon::math::LOG_0),
         priorMass_(salmon::math::LOG_0),
@@ -61,6 +62,8 @@ public:
         gcStep_ = other.gcStep_;
         gcFracLen_ = other.gcFracLen_;
         lastRegularSample_ = other.lastRegularSample_;
+        gcSampFactor_ = other.gcSampFactor_;
+        gcState_.store(other.gcState_.load());
 
         uniqueCount_.store(other.uniqueCount_);
         totalCount_.store(other.totalCount_.load());
@@ -89,6 +92,8 @@ public:
         gcStep_ = other.gcStep_;
         gcFracLen_ = other.gcFracLen_;
         lastRegularSample_ = other.lastRegularSample_;
+        gcSampFactor_ = other.gcSampFactor_;
+        gcState_.store(other.gcState_.load());
 
         uniqueCount_.store(other.uniqueCount_);
         totalCount_.store(other.totalCount_.load());
@@ -300,6 +305,7 @@ public:
     }
 
     inline GCDesc gcDesc(int32_t s, int32_t e) const {
+        ensureGCContent_();
         int outsideContext{3};
         int insideContext{2};
         
@@ -343,12 +349,14 @@ public:
 
     }
     inline double gcAt(int32_t s) const {
+        ensureGCContent_();
         return (s < 0) ? 0.0 : ((s >= RefLength) ? gcCount_(RefLength) : gcCount_(s));
     }
 
     // Return the fractional GC content along this transcript
     // in the interval [s,e] (note; this interval is closed on both sides).
     inline int32_t gcFrac(int32_t s, int32_t e) const {
+        ensureGCContent_();
         if (gcStep_ == 1) {
             auto cs = GCCount_[s];
             auto ce = GCCount_[e];
@@ -366,7 +374,7 @@ public:
                 seq,                 // store seq
                 [](const char* p) {} // do nothing deleter
                 );
-        if (needGC) { computeGCContent_(gcSampFactor); }
+        if (needGC) { requestGCContent_(gcSampFactor); }
     }
 
     // Will delete seq on destruction
@@ -375,7 +383,7 @@ public:
                 seq,                 // store seq
                 [](const char* p) { delete [] p; } // do nothing deleter
                 );
-        if (needGC) { computeGCContent_(gcSampFactor); }
+        if (needGC) { requestGCContent_(gcSampFactor); }
     }
 
     // Will *not* delete seq on destruction
@@ -384,7 +392,7 @@ public:
                 seq,                 // store seq
                 [](uint8_t* p) {} // do nothing deleter
                 );
-        if (needGC) { computeGCContent_(gcSampFactor); }
+        if (needGC) { requestGCContent_(gcSampFactor); }
     }
 
     // Will delete seq on destruction
@@ -393,7 +401,7 @@ public:
                 seq,                 // store seq
                 [](uint8_t* p) { delete [] p; } // do nothing deleter
                 );
-        if (needGC) { computeGCContent_(gcSampFactor); }
+        if (needGC) { requestGCContent_(gcSampFactor); }
     }
 
     const char* Sequence() const {
@@ -416,6 +424,34 @@ public:
     double sharedCounts{0.0};
 
 private:
+    enum GCState : uint8_t { GC_NONE = 0, GC_COMPUTING = 1, GC_READY = 2 };
+
+    // The GC count array is not built until it is first needed, so
+    // that only transcripts to which fragments are actually assigned
+    // pay the cost of computing (and storing) it.
+    void requestGCContent_(uint32_t gcSampFactor) {
+        gcSampFactor_ = gcSampFactor;
+        GCCount_.clear();
+        gcState_.store(GC_NONE);
+    }
+
+    // Build the GC count array if it hasn't been built yet.  This may be
+    // called concurrently; exactly one caller does the work while any
+    // others wait for it to finish.
+    inline void ensureGCContent_() const {
+        if (gcState_.load(std::memory_order_acquire) == GC_READY) { return; }
+        uint8_t expected = GC_NONE;
+        if (gcState_.compare_exchange_strong(expected, GC_COMPUTING,
+                                             std::memory_order_acq_rel)) {
+            computeGCContent_(gcSampFactor_);
+            gcState_.store(GC_READY, std::memory_order_release);
+        } else {
+            while (gcState_.load(std::memory_order_acquire) != GC_READY) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
     // NOTE: Is it worth it to check if we have GC here?
     // we should never access these without bias correction.
     inline double gcCount_(int32_t p) {
@@ -495,7 +531,7 @@ private:
 	*/
     }
 
-    void computeGCContentSampled_(uint32_t step) {
+    void computeGCContentSampled_(uint32_t step) const {
         gcStep_ = step;
         const char* seq = Sequence_.get();
         size_t nsamp = std::ceil(static_cast<double>(RefLength) / step);
@@ -522,10 +558,11 @@ private:
         lastRegularSample_ = std::ceil(gcFracLen_);
     }
 
-    void computeGCContent_(uint32_t gcSampFactor) {
+    void computeGCContent_(uint32_t gcSampFactor) const {
         const char* seq = Sequence_.get();
         GCCount_.clear();
         if (gcSampFactor == 1) {
+            gcStep_ = 1;
             GCCount_.resize(RefLength, 0);
             size_t totGC{0};
             for (size_t i = 0; i < RefLength; ++i) {
@@ -564,10 +601,14 @@ private:
     std::atomic<bool> hasAnchorFragment_{false};
     bool active_;
 
-    uint32_t gcStep_{1};
-    double gcFracLen_{0.0};
-    uint32_t lastRegularSample_{0};
-    std::vector<uint32_t> GCCount_;
+    // The GC count array (and its sampling parameters) are a lazily
+    // computed cache; see ensureGCContent_().
+    mutable uint32_t gcStep_{1};
+    mutable double gcFracLen_{0.0};
+    mutable uint32_t lastRegularSample_{0};
+    mutable std::vector<uint32_t> GCCount_;
+    uint32_t gcSampFactor_{1};
+    mutable std::atomic<uint8_t> gcState_{GC_NONE};
 };
 
 #endif //TRANSCRIPT
@@ -4,9 +4,7 @@
 #include <iostream>
 #include <atomic>
 #include <vector>
-#include <list>
 
-#include <boost/pending/disjoint_sets.hpp>
 #include <boost/dynamic_bitset.hpp>
 
 #include "SalmonMath.hpp"
@@ -16,25 +14,18 @@ class ClusterForest;
 class TranscriptCluster {
     friend class ClusterForest;
 public:
-    TranscriptCluster() : members_(std::list<size_t>()), count_(0), logMass_(salmon::math::LOG_0), active_(true) {}
-    TranscriptCluster(size_t initialMember) : members_(std::list<size_t>(1,initialMember)), count_(0),
-                                              logMass_(salmon::math::LOG_0), active_(true) {
+    TranscriptCluster() : count_(0), logMass_(salmon::math::LOG_0) {}
+    TranscriptCluster(size_t initialMember) : members_(std::vector<size_t>(1,initialMember)), count_(0),
+                                              logMass_(salmon::math::LOG_0) {
     }
 
     //void incrementCount(size_t num) { count_ += num; }
     void incrementCount(double num) { count_ += num; }
     void addMass(double logNewMass) { logMass_ = salmon::math::logAdd(logMass_, logNewMass); }
-    void merge(TranscriptCluster& other) {
-        members_.splice(members_.begin(), other.members_);
-        logMass_ = salmon::math::logAdd(logMass_, other.logMass_);
-        count_ += other.count_;
-    }
 
-    std::list<size_t>& members() { return members_; }
+    std::vector<size_t>& members() { return members_; }
     //size_t numHits() { return count_.load(); }
     double numHits() { return count_; }
-    bool isActive() { return active_; }
-    void deactivate() { active_ = false; }
     double logMass() { return logMass_; }
 
     // Adapted from https://github.com/adarob/eXpress/blob/master/src/targets.cpp
@@ -99,11 +90,16 @@ public:
     }
 
 private:
-    std::list<size_t> members_;
+    void reset() {
+        members_.clear();
+        count_ = 0;
+        logMass_ = salmon::math::LOG_0;
+    }
+
+    std::vector<size_t> members_;
     //std::atomic<size_t> count_;
     double count_;
     double logMass_;
-    bool active_;
 };
 
 #endif // __TRANSCRIPT_CLUSTER_HPP__
@@ -531,6 +531,21 @@ public:
         return (st == ok);
     }
 
+    //! erase_fn runs \p fn on the value associated with \p key, and then
+    //! removes \p key and its value from the table if \p fn returned true.
+    //! Both happen while the key's buckets are locked, so no other operation
+    //! on \p key can come in between (e.g. \p fn can take a copy of the value
+    //! that is sure to be its last). If \p key is not there, it returns
+    //! false, otherwise it returns true.
+    template <typename Fn>
+    bool erase_fn(const key_type& key, Fn fn) {
+        size_t hv = hashed_key(key);
+        auto b = snapshot_and_lock_two(hv);
+        const partial_t partial = partial_key(hv);
+        return (try_erase_bucket_fn(partial, key, fn, buckets_[b.i[0]]) ||
+                try_erase_bucket_fn(partial, key, fn, buckets_[b.i[1]]));
+    }
+
     //! update changes the value associated with \p key to \p val. If \p key is
     //! not there, it returns false, otherwise it returns true.
     template <typename V>
@@ -1372,6 +1387,31 @@ private:
         return false;
     }
 
+    // try_erase_bucket_fn will search the bucket for the given key, run the
+    // given function on its value if it finds it, and set the slot of the key
+    // to empty if the function returns true.
+    template <typename Fn>
+    bool try_erase_bucket_fn(const partial_t partial, const key_type &key,
+                             Fn& fn, Bucket& b) {
+        for (size_t i = 0; i < slot_per_bucket; ++i) {
+            if (!b.occupied(i)) {
+                continue;
+            }
+            if (!is_simple && b.partial(i) != partial) {
+                continue;
+            }
+            if (key_eq()(b.key(i), key)) {
+                if (fn(b.val(i))) {
+                    b.eraseKV(i);
+                    num_deletes_[get_counterid()].num.fetch_add(
+                        1, std::memory_order_relaxed);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
     // try_update_bucket will search the bucket for the given key and change its
     // associated value if it finds it.
     template <typename V>
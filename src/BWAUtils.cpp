@@ -1,5 +1,7 @@
 #include "BWAUtils.hpp"
 
+extern unsigned char nst_nt4_table[256];
+
 namespace bwautils {
 static void bwt_reverse_intvs(bwtintv_v *p)
 {
@@ -140,7 +142,193 @@ static void bwt_reverse_intvs(bwtintv_v *p)
     {
         return bwt_smem1a_with_kmer(bwt, len, q, x, min_intv, 0, initial_interval, mem, tmpvec);
     }
-}
 
+    // Prefetch the occurrence block that bwt_occ4() / bwt_2occ4() will
+    // read for position k.
+    static inline void prefetch_occ(const bwt_t *bwt, bwtint_t k)
+    {
+        if (k == (bwtint_t)(-1)) return;
+        k -= (k >= bwt->primary);
+        __builtin_prefetch(bwt_occ_intv(bwt, k));
+    }
+
+    // Prefetch everything that bwt_extend(bwt, ik, ok, is_back) will read.
+    static inline void prefetch_extend(const bwt_t *bwt, const bwtintv_t *ik, int is_back)
+    {
+        bwtint_t k = ik->x[!is_back] - 1;
+        prefetch_occ(bwt, k);
+        prefetch_occ(bwt, k + ik->x[2]);
+    }
+
+    SMEMBatch::SMEMBatch(const bwt_t* bwt, uint32_t numInFlight) :
+        bwt_(bwt), numInFlight_(numInFlight > 0 ? numInFlight : 1) {}
+
+    SMEMBatch::~SMEMBatch() {
+        for (auto& c : cursors_) {
+            free(c.ivs[0].a); free(c.ivs[1].a);
+            free(c.mem1.a); free(c.mems.a);
+        }
+    }
+
+    void SMEMBatch::clear() { numQueries_ = 0; }
+
+    size_t SMEMBatch::add(const std::string& seq) {
+        if (numQueries_ == cursors_.size()) {
+            cursors_.emplace_back();
+            auto& c = cursors_.back();
+            kv_init(c.ivs[0]); kv_init(c.ivs[1]);
+            kv_init(c.mem1); kv_init(c.mems);
+        }
+        auto& c = cursors_[numQueries_];
+        c.seq.assign(seq);
+        for (auto& b : c.seq) { b = nst_nt4_table[static_cast<uint8_t>(b)]; }
+        c.phase = Phase::START;
+        c.x = 0;
+        c.mems.n = 0;
+        return numQueries_++;
+    }
+
+    void SMEMBatch::search(int minIntv, int minSeedLen, const Seeder& seeder) {
+        if (minIntv < 1) minIntv = 1; // the interval size should be at least 1
+        // The searches in flight are stepped round-robin; when one finishes,
+        // the next query takes its place.
+        active_.clear();
+        size_t next{0};
+        while (next < numQueries_ and active_.size() < numInFlight_) {
+            active_.push_back(next++);
+        }
+        while (!active_.empty()) {
+            for (size_t s = 0; s < active_.size();) {
+                auto& c = cursors_[active_[s]];
+                if (step_(c, minIntv, minSeedLen, seeder)) {
+                    prefetch_(c);
+                    ++s;
+                } else if (next < numQueries_) {
+                    active_[s] = next++;
+                } else {
+                    active_[s] = active_.back();
+                    active_.pop_back();
+                }
+            }
+        }
+    }
+
+    // One step of bwt_smem1a_with_kmer() (with max_intv = 0), as driven by
+    // the first pass of mem_collect_intv(); returns false once the query
+    // has no more SMEMs to find.
+    bool SMEMBatch::step_(Cursor& c, int minIntv, int minSeedLen, const Seeder& seeder) {
+        const uint8_t* q = reinterpret_cast<const uint8_t*>(c.seq.data());
+        int len = static_cast<int>(c.seq.size());
+        bwtintv_v* prev = &c.ivs[c.prev];
+        bwtintv_v* curr = &c.ivs[1 - c.prev];
+        bwtintv_t ok[4];
 
+        switch (c.phase) {
+        case Phase::START: {
+            // Find the next position at which a search should start
+            while (c.x < len) {
+                if (q[c.x] > 3) { ++c.x; continue; }
+                int k{1};
+                if (seeder) {
+                    if (!seeder(q, len, c.x, c.ik)) { ++c.x; continue; }
+                    k = c.ik.info;
+                } else {
+                    bwt_set_intv(bwt_, q[c.x], c.ik); // the initial interval of a single base
+                }
+                c.ik.info = c.x + k;
+                c.i = c.x + k;
+                curr->n = 0;
+                c.mem1.n = 0;
+                c.phase = Phase::FORWARD;
+                return true;
+            }
+            c.phase = Phase::DONE;
+            return false;
+        }
+        case Phase::FORWARD: {
+            bool extended{false};
+            if (c.i < len) {
+                if (q[c.i] < 4) { // an A/C/G/T base
+                    int b = 3 - q[c.i]; // complement of q[i]
+                    bwt_extend(bwt_, &c.ik, ok, 0);
+                    if (ok[b].x[2] != c.ik.x[2]) { // change of the interval size
+                        kv_push(bwtintv_t, *curr, c.ik);
+                    }
+                    // otherwise, the interval size is too small to be extended further
+                    if (ok[b].x[2] == c.ik.x[2] or ok[b].x[2] >= static_cast<bwtint_t>(minIntv)) {
+                        c.ik = ok[b]; c.ik.info = c.i + 1;
+                        ++c.i;
+                        extended = true;
+                    }
+                } else { // an ambiguous base
+                    kv_push(bwtintv_t, *curr, c.ik);
+                }
+            } else { // we reached the end
+                kv_push(bwtintv_t, *curr, c.ik);
+            }
+            if (extended) { return true; }
+
+            bwt_reverse_intvs(curr); // s.t. smaller intervals (i.e. longer matches) visited first
+            c.ret = curr->a[0].info; // where the next search will start
+            c.prev = 1 - c.prev;
+            c.ivs[1 - c.prev].n = 0;
+            c.i = c.x - 1;
+            c.j = 0;
+            c.phase = Phase::BACKWARD;
+            return true;
+        }
+        case Phase::BACKWARD: {
+            // backward search for MEMs; c==-1 if i<0 or q[i] is an ambiguous base
+            int b = c.i < 0? -1 : q[c.i] < 4? q[c.i] : -1;
+            bwtintv_t *p = &prev->a[c.j];
+            if (b >= 0) bwt_extend(bwt_, p, ok, 1);
+            if (b < 0 || ok[b].x[2] < static_cast<bwtint_t>(minIntv)) { // keep the hit if reaching the beginning or an ambiguous base or the intv is small enough
+                if (curr->n == 0) { // test curr->n>0 to make sure there are no longer matches
+                    if (c.mem1.n == 0 || c.i + 1 < c.mem1.a[c.mem1.n-1].info>>32) { // skip contained matches
+                        bwtintv_t ik = *p; ik.info |= (uint64_t)(c.i + 1)<<32;
+                        kv_push(bwtintv_t, c.mem1, ik);
+                    }
+                } // otherwise the match is contained in another longer match
+            } else if (curr->n == 0 || ok[b].x[2] != curr->a[curr->n-1].x[2]) {
+                ok[b].info = p->info;
+                kv_push(bwtintv_t, *curr, ok[b]);
+            }
+            if (++c.j < prev->n) { return true; }
+
+            if (curr->n > 0) { // move on to the previous position
+                c.prev = 1 - c.prev;
+                c.ivs[1 - c.prev].n = 0;
+                c.j = 0;
+                --c.i;
+                return true;
+            }
 
+            // This search is done; keep its long enough SMEMs and start the next
+            bwt_reverse_intvs(&c.mem1); // s.t. sorted by the start coordinate
+            for (size_t m = 0; m < c.mem1.n; ++m) {
+                bwtintv_t *s = &c.mem1.a[m];
+                int slen = (uint32_t)s->info - (s->info>>32); // seed length
+                if (slen >= minSeedLen) kv_push(bwtintv_t, c.mems, *s);
+            }
+            c.x = c.ret;
+            c.phase = Phase::START;
+            return true;
+        }
+        case Phase::DONE:
+            break;
+        }
+        return false;
+    }
+
+    void SMEMBatch::prefetch_(const Cursor& c) const {
+        const uint8_t* q = reinterpret_cast<const uint8_t*>(c.seq.data());
+        int len = static_cast<int>(c.seq.size());
+        if (c.phase == Phase::FORWARD) {
+            if (c.i < len and q[c.i] < 4) { prefetch_extend(bwt_, &c.ik, 0); }
+        } else if (c.phase == Phase::BACKWARD) {
+            if (c.i >= 0 and q[c.i] < 4 and c.j < c.ivs[c.prev].n) {
+                prefetch_extend(bwt_, &c.ivs[c.prev].a[c.j], 1);
+            }
+        }
+    }
+}
@@ -12,11 +12,16 @@
 #include <functional>
 #include <memory>
 #include <cassert>
+#include <unordered_set>
 
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#if defined(SALMON_USE_GOMP)
+#include <omp.h>
+#endif
+
 
 #include "cereal/types/vector.hpp"
 #include "cereal/archives/binary.hpp"
@@ -43,6 +48,7 @@
 #include "Transcript.hpp"
 #include "SalmonUtils.hpp"
 #include "SalmonIndex.hpp"
+#include "IndexUpdate.hpp"
 #include "GenomicFeature.hpp"
 #include "spdlog/fmt/ostr.h"
 #include "spdlog/fmt/fmt.h"
@@ -63,6 +69,175 @@ bool isPowerOfTwo(uint32_t n) {
   return (n > 0 and (n & (n-1)) == 0);
 }
 
+/**
+ * Read the records of the fasta file `fname` into `records`, as pairs of
+ * the name that the quasi-index gives each record, and the record itself.
+ */
+bool readFastaRecords(const std::string& fname, bool gencodeRef,
+                      std::vector<std::pair<std::string, std::string>>& records) {
+    std::ifstream in(fname);
+    if (!in.good()) { return false; }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() and line.front() == '>') {
+            std::string name = line.substr(1, line.find_first_of(" \t", 1) - 1);
+            if (gencodeRef) { name = name.substr(0, name.find('|')); }
+            records.emplace_back(name, "");
+        }
+        if (!records.empty()) {
+            records.back().second += line;
+            records.back().second += '\n';
+        }
+    }
+    return true;
+}
+
+/**
+ * Add transcripts to, or remove them from, the existing (quasi) index in
+ * `indexDirectory` without re-building it.  The added transcripts are
+ * indexed on their own, in <index>/delta, and this (small) index is searched
+ * alongside the original one during quantification.  The names of the
+ * removed transcripts of the original index are recorded in
+ * <index>/masked.txt; they remain in the index, but no fragments are
+ * assigned to them.  Removed transcripts that had been added are simply
+ * dropped from the delta.  A transcript that is already in the index can
+ * only be added (again) if it is also removed.
+ */
+bool updateSalmonIndex(const boost::filesystem::path& indexDirectory,
+                       const std::string& addTranscriptFile,
+                       const std::string& removeTranscriptFile,
+                       uint32_t numThreads, bool gencodeRef,
+                       std::shared_ptr<spdlog::logger>& jointLog) {
+    namespace bfs = boost::filesystem;
+    using FastaRecords = std::vector<std::pair<std::string, std::string>>;
+
+    SalmonIndexVersionInfo versionInfo;
+    bfs::path versionPath = indexDirectory / "versionInfo.json";
+    versionInfo.load(versionPath);
+    if (versionInfo.indexType() != SalmonIndexType::QUASI) {
+        jointLog->error("Transcripts can only be added to, or removed from, a quasi index; "
+                        "please re-build the index [{}]", indexDirectory.string());
+        return false;
+    }
+
+    IndexHeader h;
+    std::ifstream headerStream((indexDirectory / "header.json").string());
+    {
+        cereal::JSONInputArchive ar(headerStream);
+        ar(h);
+    }
+    headerStream.close();
+
+    // Everything is checked before anything is changed
+    std::vector<std::string> removeNames;
+    if (!removeTranscriptFile.empty()) {
+        std::ifstream removeStream(removeTranscriptFile);
+        if (!removeStream.good()) {
+            jointLog->error("Could not open the list of transcripts to remove [{}]",
+                            removeTranscriptFile);
+            return false;
+        }
+        std::string name;
+        while (removeStream >> name) { removeNames.push_back(name); }
+    }
+
+    FastaRecords addRecords;
+    if (!addTranscriptFile.empty()) {
+        if (!readFastaRecords(addTranscriptFile, gencodeRef, addRecords)) {
+            jointLog->error("Could not open the transcripts to add [{}]", addTranscriptFile);
+            return false;
+        }
+        // The added transcripts are searched with the same code as the
+        // original index, so the two must be of the same type; the index of
+        // the added transcripts will (almost certainly) be a 32-bit one.
+        if (h.bigSA()) {
+            jointLog->error("Transcripts cannot be added to a 64-bit index; "
+                            "please re-build the index [{}]", indexDirectory.string());
+            return false;
+        }
+    }
+
+    bfs::path maskPath = indexDirectory / "masked.txt";
+    bfs::path deltaDirectory = indexDirectory / "delta";
+    bfs::path addedPath = deltaDirectory / "added.fa";
+
+    salmon::index_update::IndexTranscripts current;
+    {
+        // The names of the transcripts in the original index
+        SalmonIndex baseIndex(jointLog, SalmonIndexType::QUASI);
+        baseIndex.load(indexDirectory);
+        current.base = baseIndex.transcriptNames();
+    }
+    {
+        std::ifstream maskStream(maskPath.string());
+        std::string name;
+        while (maskStream >> name) { current.maskedBase.push_back(name); }
+    }
+    FastaRecords addedRecords;
+    if (bfs::exists(addedPath)) {
+        readFastaRecords(addedPath.string(), gencodeRef, addedRecords);
+    }
+    for (auto& r : addedRecords) { current.added.push_back(r.first); }
+
+    std::vector<std::string> addNames;
+    for (auto& r : addRecords) { addNames.push_back(r.first); }
+    auto plan = salmon::index_update::planUpdate(current, removeNames, addNames);
+    if (!plan.error.empty()) {
+        jointLog->error("Can not update the index [{}]: {}", indexDirectory.string(), plan.error);
+        return false;
+    }
+    for (auto& name : plan.notFound) {
+        jointLog->warn("The transcript {} is not in the index (or was already removed)", name);
+    }
+
+    if (!plan.maskBase.empty()) {
+        std::ofstream maskStream(maskPath.string(), std::ios::app);
+        for (auto& name : plan.maskBase) { maskStream << name << '\n'; }
+    }
+    jointLog->info("marked {} transcripts as removed from the index", plan.maskBase.size());
+
+    if (plan.dropAdded.empty() and addRecords.empty()) {
+        return true;
+    }
+
+    // The index of added transcripts is re-built from all of the
+    // transcripts added so far (and not removed since); it is small, so
+    // this is cheap.
+    std::unordered_set<std::string> drop(plan.dropAdded.begin(), plan.dropAdded.end());
+    FastaRecords keep;
+    for (auto& r : addedRecords) {
+        if (drop.count(r.first) == 0) { keep.push_back(r); }
+    }
+    keep.insert(keep.end(), addRecords.begin(), addRecords.end());
+    jointLog->info("dropped {} previously added transcripts; added {} transcripts",
+                   plan.dropAdded.size(), addRecords.size());
+
+    bfs::remove_all(deltaDirectory);
+    if (keep.empty()) {
+        return true;
+    }
+    bfs::create_directories(deltaDirectory);
+    {
+        std::ofstream addedStream(addedPath.string());
+        for (auto& r : keep) { addedStream << r.second; }
+    }
+
+    std::vector<std::string> argVec{"dummy", "-k", std::to_string(versionInfo.auxKmerLength()),
+                                    "-t", addedPath.string(), "-i", deltaDirectory.string(),
+                                    "-x", std::to_string(numThreads)};
+    if (h.perfectHash()) {
+        argVec.push_back("--perfectHash");
+    }
+    if (gencodeRef) {
+        argVec.push_back("-s");
+        argVec.push_back("\"|\"");
+    }
+
+    jointLog->info("building the index of added transcripts");
+    SalmonIndex deltaIndex(jointLog, SalmonIndexType::QUASI);
+    return deltaIndex.build(deltaDirectory, argVec, versionInfo.auxKmerLength());
+}
+
 int salmonIndex(int argc, char* argv[]) {
 
     using std::string;
@@ -74,16 +249,18 @@ int salmonIndex(int argc, char* argv[]) {
     string indexTypeStr = "fmd";
     uint32_t saSampInterval = 1;
     uint32_t auxKmerLen = 0;
-    uint32_t numThreads;
+    uint32_t numThreads{std::max(1u, std::thread::hardware_concurrency())};
     bool useQuasi{false};
     bool perfectHash{false};
     bool gencodeRef{false};
+    string addTranscriptFile;
+    string removeTranscriptFile;
 
     po::options_description generic("Command Line Options");
     generic.add_options()
     ("version,v", "print version string")
     ("help,h", "produce help message")
-    ("transcripts,t", po::value<string>()->required(), "Transcript fasta file.")
+    ("transcripts,t", po::value<string>(), "Transcript fasta file.")
     ("kmerLen,k", po::value<uint32_t>(&auxKmerLen)->default_value(31)->required(),
                     "The size of k-mers that should be used for the quasi index.")
     ("index,i", po::value<string>()->required(), "Salmon index.")
@@ -91,11 +268,21 @@ int salmonIndex(int argc, char* argv[]) {
          "This flag will expect the input transcript fasta to be in GENCODE format, and will split "
          "the transcript name at the first \'|\' character.  These reduced names will be used in the "
          "output and when looking for these transcripts in a gene to transcript GTF.")
-    ("threads,p", po::value<uint32_t>(&numThreads)->default_value(2)->required(),
-                            "Number of threads to use (only used for computing bias features)")
+    ("threads,p", po::value<uint32_t>(&numThreads)->default_value(numThreads),
+                            "Number of threads to use for building the index (suffix array construction and, "
+                            "with --perfectHash, building the k-mer hash)")
     ("perfectHash", po::bool_switch(&perfectHash)->default_value(false), 
                              "[quasi index only] Build the index using a perfect hash rather than a dense hash.  This "
-                             "will require less memory (especially during quantification), but will take longer to construct")
+                             "will require less memory (both at peak during construction and during quantification), "
+                             "but will take longer to construct")
+    ("addTranscripts", po::value<string>(&addTranscriptFile),
+                             "[quasi index only] Add the transcripts in this fasta file to the existing index "
+                             "given by --index, without re-building it.  The added transcripts are indexed "
+                             "separately and searched alongside the existing index.")
+    ("removeTranscripts", po::value<string>(&removeTranscriptFile),
+                             "[quasi index only] Remove the transcripts named in this file (one per line) from "
+                             "the existing index given by --index, without re-building it.  No fragments will "
+                             "be assigned to the removed transcripts.")
     ("type", po::value<string>(&indexTypeStr)->default_value("quasi")->required(), "The type of index to build; options are \"fmd\" and \"quasi\" "
     							   			   "\"quasi\" is recommended, and \"fmd\" may be removed in the future")
     ("sasamp,s", po::value<uint32_t>(&saSampInterval)->default_value(1)->required(),
@@ -140,8 +327,36 @@ Creates a salmon index.
           throw(std::logic_error(errWriter.str()));
         }
 
-        string transcriptFile = vm["transcripts"].as<string>();
         bfs::path indexDirectory(vm["index"].as<string>());
+        bool updateIndex = !(addTranscriptFile.empty() and removeTranscriptFile.empty());
+        if (updateIndex) {
+            if (!bfs::exists(indexDirectory)) {
+                fmt::MemoryWriter errWriter;
+                errWriter << "Error: The index " << indexDirectory.string() << " to be "
+                             "updated does not exist.";
+                throw(std::logic_error(errWriter.str()));
+            }
+            if (numThreads == 0) { numThreads = 1; }
+#if defined(SALMON_USE_GOMP)
+            omp_set_num_threads(numThreads);
+#endif
+            bfs::path logPath = indexDirectory / "update.log";
+            auto fileSink = std::make_shared<spdlog::sinks::simple_file_sink_mt>(logPath.string(), false);
+            auto consoleSink = std::make_shared<spdlog::sinks::stderr_sink_mt>();
+            auto jointLog = spdlog::create("jLog", {fileSink, consoleSink});
+            if (!updateSalmonIndex(indexDirectory, addTranscriptFile, removeTranscriptFile,
+                                   numThreads, gencodeRef, jointLog)) {
+                return 1;
+            }
+            jointLog->info("done updating index");
+            return 0;
+        }
+
+        if (!vm.count("transcripts")) {
+            throw(std::logic_error("Error: the option '--transcripts' is required "
+                                   "(unless updating an index)."));
+        }
+        string transcriptFile = vm["transcripts"].as<string>();
 
 
         if (!bfs::exists(indexDirectory)) {
@@ -219,7 +434,14 @@ Creates a salmon index.
 	        auxKmerLen = 0;
         }
 
-        jointLog->info("building index");
+        if (numThreads == 0) { numThreads = 1; }
+#if defined(SALMON_USE_GOMP)
+        // The suffix array is constructed by libdivsufsort, which is
+        // parallelized with OpenMP; without this it would use every core
+        // on the machine, regardless of --threads.
+        omp_set_num_threads(numThreads);
+#endif
+        jointLog->info("building index using {} threads", numThreads);
 	    sidx->build(indexDirectory, *(argVec.get()), auxKmerLen);
         jointLog->info("done building index");
         // If we want to build the auxiliary k-mer index, do it here.
@@ -1,4 +1,7 @@
 #include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -7,7 +10,7 @@
 #include "tbb/parallel_for_each.h"
 #include "tbb/parallel_reduce.h"
 #include "tbb/partitioner.h"
-#include "tbb/task_scheduler_init.h"
+#include "tbb/task_group.h"
 
 //#include "fastapprox.h"
 #include <boost/math/special_functions/digamma.hpp>
@@ -22,6 +25,7 @@
 #include "BootstrapWriter.hpp"
 #include "CollapsedEMOptimizer.hpp"
 #include "MultinomialSampler.hpp"
+#include "SalmonRandom.hpp"
 #include "ReadExperiment.hpp"
 #include "ReadPair.hpp"
 #include "SalmonMath.hpp"
@@ -419,6 +423,9 @@ size_t markDegenerateClasses(
 
 CollapsedEMOptimizer::CollapsedEMOptimizer() {}
 
+namespace salmon {
+namespace detail {
+
 bool doBootstrap(
     std::vector<std::vector<uint32_t>>& txpGroups,
     std::vector<std::vector<double>>& txpGroupCombinedWeights,
@@ -427,7 +434,7 @@ bool doBootstrap(
     uint64_t numMappedFrags, double uniformTxpWeight,
     std::atomic<uint32_t>& bsNum, SalmonOpts& sopt,
     std::vector<double>& priorAlphas,
-    std::function<bool(const std::vector<double>&)>& writeBootstrap,
+    std::function<void(uint32_t, const std::vector<double>&)>& writeBootstrap,
     double relDiffTolerance, uint32_t maxIter) {
 
   uint32_t minIter = 50;
@@ -446,10 +453,12 @@ bool doBootstrap(
 
   auto& jointLog = sopt.jointLog;
 
-  std::random_device rd;
-  MultinomialSampler msamp(rd);
-
-  while (bsNum++ < numBootstraps) {
+  uint32_t bsID;
+  while ((bsID = bsNum++) < numBootstraps) {
+    PhaseTelemetry::ScopedTimer bsTimer(sopt.telemetry.get(), TelemetryPhase::BOOTSTRAP);
+    // Each replicate has its own stream, so that it doesn't matter which
+    // thread computes it
+    MultinomialSampler msamp(salmon::rng::stream(sopt.rngSeed, salmon::rng::Phase::BOOTSTRAP, bsID));
     // Do a new bootstrap
     msamp(sampCounts.begin(), totalNumFrags, numClasses, sampleWeights.begin());
 
@@ -540,11 +549,14 @@ bool doBootstrap(
             "have run salmon correctly and report this to GitHub.");
       }
     }
-    writeBootstrap(alphas);
+    writeBootstrap(bsID, alphas);
   }
   return true;
 }
 
+}
+}
+
 template <typename ExpT>
 bool CollapsedEMOptimizer::gatherBootstraps(
     ExpT& readExp, SalmonOpts& sopt,
@@ -663,19 +675,38 @@ bool CollapsedEMOptimizer::gatherBootstraps(
     numWorkerThreads = std::min(sopt.numThreads - 1, numBootstraps - 1);
   }
 
+  // The replicates may finish out of order; hold each one until all of
+  // those before it have been written, so that the output doesn't depend
+  // on how the threads were scheduled.
+  std::mutex writeMutex;
+  uint32_t nextToWrite{0};
+  std::map<uint32_t, std::vector<double>> finished;
+  std::function<void(uint32_t, const std::vector<double>&)> writeInOrder =
+      [&](uint32_t bsID, const std::vector<double>& alphas) -> void {
+    std::lock_guard<std::mutex> l(writeMutex);
+    finished.emplace(bsID, alphas);
+    auto it = finished.begin();
+    while (it != finished.end() and it->first == nextToWrite) {
+      writeBootstrap(it->second);
+      it = finished.erase(it);
+      ++nextToWrite;
+    }
+  };
+
+  // Each worker is a task on the run's shared pool (so that any threads it
+  // leaves over go to whatever else is running, e.g. writing the outputs);
+  // the workers draw replicates until none are left.
   std::atomic<uint32_t> bsCounter{0};
-  std::vector<std::thread> workerThreads;
+  tbb::task_group workers;
   for (size_t tn = 0; tn < numWorkerThreads; ++tn) {
-    workerThreads.emplace_back(
-        doBootstrap, std::ref(txpGroups), std::ref(txpGroupCombinedWeights),
-        std::ref(transcripts), std::ref(effLens), std::ref(samplingWeights),
-        totalCount, numMappedFrags, scale, std::ref(bsCounter), std::ref(sopt),
-	std::ref(priorAlphas), std::ref(writeBootstrap), relDiffTolerance, maxIter);
-  }
-
-  for (auto& t : workerThreads) {
-    t.join();
+    workers.run([&]() -> void {
+      salmon::detail::doBootstrap(
+          txpGroups, txpGroupCombinedWeights, transcripts, effLens,
+          samplingWeights, totalCount, numMappedFrags, scale, bsCounter,
+          sopt, priorAlphas, writeInOrder, relDiffTolerance, maxIter);
+    });
   }
+  workers.wait();
   return true;
 }
 
@@ -720,7 +751,6 @@ template <typename ExpT>
 bool CollapsedEMOptimizer::optimize(ExpT& readExp, SalmonOpts& sopt,
                                     double relDiffTolerance, uint32_t maxIter) {
 
-  tbb::task_scheduler_init tbbScheduler(sopt.numThreads);
   std::vector<Transcript>& transcripts = readExp.transcripts();
 
   uint32_t minIter = 50;
@@ -910,8 +940,12 @@ bool CollapsedEMOptimizer::optimize(ExpT& readExp, SalmonOpts& sopt,
     if (needBias and (itNum > targetIt or converged)) {
 
       jointLog->info("iteration {}, adjusting effective lengths to account for biases", itNum);
-      effLens = salmon::utils::updateEffectiveLengths(sopt, readExp, effLens,
-                                                      alphas, true);
+      {
+        PhaseTelemetry::ScopedTimer biasTimer(sopt.telemetry.get(),
+                                              TelemetryPhase::BIAS_BACKGROUND);
+        effLens = salmon::utils::updateEffectiveLengths(sopt, readExp, effLens,
+                                                        alphas, true);
+      }
       //(itNum == recomputeIt.front()));
 
       // Check for strangeness with the lengths.
@@ -935,6 +969,7 @@ bool CollapsedEMOptimizer::optimize(ExpT& readExp, SalmonOpts& sopt,
       needBias = false;
     }
 
+    auto iterStart = PhaseTelemetry::Clock::now();
     if (useVBEM) {
       VBEMUpdate_(eqVec, transcripts, priorAlphas, totalLen, alphas, alphasPrime,
                   expTheta);
@@ -956,6 +991,9 @@ bool CollapsedEMOptimizer::optimize(ExpT& readExp, SalmonOpts& sopt,
       alphasPrime[i] = 0.0;
     }
 
+    sopt.telemetry->add(TelemetryPhase::EM_ITERATION,
+                        PhaseTelemetry::nanosSince(iterStart));
+
     if (itNum % 100 == 0) {
       jointLog->info("iteration = {} | max rel diff. = {}", itNum, maxRelDiff);
     }
@@ -3,7 +3,6 @@
 #include <atomic>
 #include <random>
 
-#include "tbb/task_scheduler_init.h"
 #include "tbb/parallel_for.h"
 #include "tbb/parallel_for_each.h"
 #include "tbb/parallel_reduce.h"
@@ -29,6 +28,7 @@
 #include "UnpairedRead.hpp"
 #include "ReadExperiment.hpp"
 #include "MultinomialSampler.hpp"
+#include "SalmonRandom.hpp"
 #include "BootstrapWriter.hpp"
 
 using BlockedIndexRange =  tbb::blocked_range<size_t>;
@@ -38,6 +38,9 @@ using BlockedIndexRange =  tbb::blocked_range<size_t>;
 constexpr double minEQClassWeight = std::numeric_limits<double>::denorm_min();
 constexpr double minWeight = std::numeric_limits<double>::denorm_min();
 
+namespace salmon {
+namespace detail {
+
 void initCountMap_(
         std::vector<std::pair<const TranscriptGroup, TGValue>>& eqVec,
         std::vector<Transcript>& transcriptsIn,
@@ -109,9 +112,7 @@ void sampleRound_(
         std::vector<int>& txpCount,
         MultinomialSampler& msamp) {
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.25, 0.75);
+    auto& gen = msamp.rng();
     size_t offset{0};
     // Choose a fraction of this class to re-sample
 
@@ -120,7 +121,7 @@ void sampleRound_(
 
     for (auto& eqClass : eqVec) {
         uint64_t classCount = eqClass.second.count;
-        double sampleFrac = dis(gen);
+        double sampleFrac = 0.25 + 0.5 * gen.uniform01();
 
         // for each transcript in this class
         const TranscriptGroup& tgroup = eqClass.first;
@@ -193,6 +194,9 @@ void sampleRound_(
 
 }
 
+}
+}
+
 CollapsedGibbsSampler::CollapsedGibbsSampler() {}
 
 class DistStats {
@@ -211,7 +215,6 @@ bool CollapsedGibbsSampler::sample(ExpT& readExp,
 
     namespace bfs = boost::filesystem;
     auto& jointLog = sopt.jointLog;
-    tbb::task_scheduler_init tbbScheduler(sopt.numThreads);
     std::vector<Transcript>& transcripts = readExp.transcripts();
 
     // Fill in the effective length vector
@@ -235,14 +238,17 @@ bool CollapsedGibbsSampler::sample(ExpT& readExp,
         effLens(i) = txp.EffectiveLength;
     }
 
-    tbb::parallel_for(BlockedIndexRange(size_t(0), size_t(numSamples)),
+    // The samples are split into a fixed set of chains (the ranges of a
+    // simple_partitioner), each drawing from its own stream of random numbers,
+    // so that the samples depend only on the seed and the number of threads,
+    // and not on how the chains happen to be scheduled.
+    size_t chainLength = std::max(size_t(1), (numSamples + sopt.numThreads - 1) / sopt.numThreads);
+    tbb::parallel_for(BlockedIndexRange(size_t(0), size_t(numSamples), chainLength),
                 [&eqVec, &transcripts, priorAlpha, &effLens,
-                 &allSamples, &writeBootstrap, useScaledCounts,
+                 &allSamples, useScaledCounts, &sopt,
                  &jointLog, numMappedFragments]( const BlockedIndexRange& range) -> void {
 
-
-                std::random_device rd;
-                MultinomialSampler ms(rd);
+                MultinomialSampler ms(salmon::rng::stream(sopt.rngSeed, salmon::rng::Phase::GIBBS, range.begin()));
 
                 size_t countMapSize{0};
                 for (size_t i = 0; i < eqVec.size(); ++i) {
@@ -253,37 +259,33 @@ bool CollapsedGibbsSampler::sample(ExpT& readExp,
 
                 size_t numTranscripts{transcripts.size()};
 
-                // will hold estimated counts
-                std::vector<int> alphas(numTranscripts, 0.0);
+                // the current state of this chain
+                std::vector<int> txpCounts(numTranscripts, 0);
                 std::vector<uint64_t> countMap(countMapSize, 0);
                 std::vector<double> probMap(countMapSize, 0.0);
 
-                initCountMap_(eqVec, transcripts, priorAlpha, ms, countMap, probMap, effLens, allSamples[range.begin()]);
+                salmon::detail::initCountMap_(eqVec, transcripts, priorAlpha, ms, countMap, probMap, effLens, txpCounts);
 
                 // For each sample this thread should generate
-                bool isFirstSample{true};
                 bool numInternalRounds = 10;
                 for (auto sampleID : boost::irange(range.begin(), range.end())) {
                     if (sampleID % 100 == 0) {
                         std::cerr << "gibbs sampling " << sampleID << "\n";
                     }
 
-                    if (!isFirstSample) {
-                        // the counts start at what they were last round.
-                        allSamples[sampleID] = allSamples[sampleID-1];
-                    }
-
                     // Thin the chain by a factor of (numInternalRounds)
                     for (size_t i = 0; i < numInternalRounds; ++i){
-                        sampleRound_(eqVec, countMap, probMap, effLens, priorAlpha,
-                                allSamples[sampleID], ms);
+                        salmon::detail::sampleRound_(eqVec, countMap, probMap, effLens,
+                                                     priorAlpha, txpCounts, ms);
                     }
 
+                    // will hold estimated counts
+                    auto& alphas = allSamples[sampleID];
                     // If we're scaling the counts, do it here.
                     if (useScaledCounts) {
                         double numMappedFrags = static_cast<double>(numMappedFragments);
                         double alphaSum = 0.0;
-                        for (auto c : allSamples[sampleID]) { alphaSum += static_cast<double>(c); }
+                        for (auto c : txpCounts) { alphaSum += static_cast<double>(c); }
                         if (alphaSum > ::minWeight) {
                             double scaleFrac = 1.0 / alphaSum;
                             // scaleFrac converts alpha to nucleotide fraction,
@@ -293,7 +295,7 @@ bool CollapsedGibbsSampler::sample(ExpT& readExp,
                                 alphas[tn] = static_cast<int>(
                                         std::round(
                                             numMappedFrags *
-                                            (static_cast<double>(allSamples[sampleID][tn]) * scaleFrac)));
+                                            (static_cast<double>(txpCounts[tn]) * scaleFrac)));
                             }
                         } else { // This shouldn't happen!
                             jointLog->error("Gibbs sampler had insufficient number of fragments!"
@@ -301,16 +303,15 @@ bool CollapsedGibbsSampler::sample(ExpT& readExp,
                                     "have run salmon correctly and report this to GitHub.");
                         }
                     } else { // otherwise, just copy over from the sampled counts
-                        for (size_t tn = 0; tn < numTranscripts; ++tn) {
-                            alphas[tn] = static_cast<int>(allSamples[sampleID][tn]);
-                        }
+                        alphas = txpCounts;
                     }
-
-                    writeBootstrap(alphas);
-                    //bootstrapWriter->writeBootstrap(alphas);
-                    isFirstSample = false;
                 }
-    });
+    }, tbb::simple_partitioner());
+
+    // Write the samples in order
+    for (auto& alphas : allSamples) {
+        writeBootstrap(alphas);
+    }
     return true;
 }
 
@@ -0,0 +1,273 @@
+#include "ColumnarFile.hpp"
+
+#include <algorithm>
+
+#include <zlib.h>
+
+namespace salmon {
+namespace columnar {
+
+namespace {
+constexpr char kMagic[8] = {'S', 'A', 'L', 'M', 'C', 'O', 'L', '1'};
+
+bool hostIsLittleEndian() {
+    uint16_t probe{1};
+    char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+template <typename T> void writePOD(std::ostream& out, T v) {
+    convertLittleEndian(reinterpret_cast<char*>(&v), sizeof(T), sizeof(T));
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T> void readPOD(std::istream& in, T& v) {
+    in.read(reinterpret_cast<char*>(&v), sizeof(T));
+    convertLittleEndian(reinterpret_cast<char*>(&v), sizeof(T), sizeof(T));
+}
+}
+
+size_t valueWidth(ColumnType type) {
+    switch (type) {
+    case ColumnType::UINT32:
+    case ColumnType::INT32:
+        return 4;
+    case ColumnType::UINT64:
+    case ColumnType::FLOAT64:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+void convertLittleEndian(char* data, size_t len, size_t width) {
+    static const bool isLittleEndian = hostIsLittleEndian();
+    if (isLittleEndian or width < 2) { return; }
+    for (size_t i = 0; i + width <= len; i += width) {
+        std::reverse(data + i, data + i + width);
+    }
+}
+
+ColumnarWriter::ColumnarWriter(const std::string& path, int compressionLevel)
+    : out_(path, std::ios::out | std::ios::binary),
+      compressionLevel_(compressionLevel) {
+    if (!out_.good()) {
+        throw std::runtime_error("could not open " + path + " for writing");
+    }
+    out_.write(kMagic, sizeof(kMagic));
+}
+
+ColumnarWriter::~ColumnarWriter() {
+    if (!closed_) { close(); }
+}
+
+void ColumnarWriter::addColumn(const std::string& name,
+                               const std::vector<std::string>& values) {
+    // The string table; offsets (relative to the start of the
+    // characters) followed by the characters themselves.
+    std::vector<uint64_t> offsets(values.size() + 1, 0);
+    for (size_t i = 0; i < values.size(); ++i) {
+        offsets[i + 1] = offsets[i] + values[i].size();
+    }
+    std::vector<char> buf(offsets.size() * sizeof(uint64_t) + offsets.back());
+    std::memcpy(buf.data(), offsets.data(), offsets.size() * sizeof(uint64_t));
+    char* chars = buf.data() + offsets.size() * sizeof(uint64_t);
+    for (size_t i = 0; i < values.size(); ++i) {
+        std::memcpy(chars + offsets[i], values[i].data(), values[i].size());
+    }
+    convertLittleEndian(buf.data(), offsets.size() * sizeof(uint64_t), sizeof(uint64_t));
+    addColumn_(name, ColumnType::STRING, values.size(), buf.data(), buf.size(), 1);
+}
+
+void ColumnarWriter::addColumn_(const std::string& name, ColumnType type,
+                                uint64_t numRows, const char* data, size_t len,
+                                size_t width) {
+    if (closed_) {
+        throw std::logic_error("cannot add column " + name + " to a closed columnar file");
+    }
+
+    std::vector<char> swapped;
+    if (!hostIsLittleEndian() and width > 1) {
+        swapped.assign(data, data + len);
+        convertLittleEndian(swapped.data(), len, width);
+        data = swapped.data();
+    }
+
+    ColumnInfo info{name, type, false, numRows, static_cast<uint64_t>(out_.tellp()), len, len};
+
+    // Compress the column; if that doesn't actually save space, store
+    // it as-is.
+    if (compressionLevel_ > 0 and len > 0) {
+        uLongf destLen = compressBound(len);
+        std::vector<char> dest(destLen);
+        int ret = compress2(reinterpret_cast<Bytef*>(dest.data()), &destLen,
+                            reinterpret_cast<const Bytef*>(data), len,
+                            compressionLevel_);
+        if (ret == Z_OK and destLen < len) {
+            info.compressed = true;
+            info.storedSize = destLen;
+            out_.write(dest.data(), destLen);
+        }
+    }
+    if (!info.compressed) {
+        out_.write(data, len);
+    }
+    columns_.push_back(info);
+}
+
+void ColumnarWriter::close() {
+    if (closed_) { return; }
+    uint64_t footerOffset = out_.tellp();
+    uint32_t numColumns = columns_.size();
+    writePOD(out_, numColumns);
+    for (auto& c : columns_) {
+        uint32_t nameLen = c.name.size();
+        writePOD(out_, nameLen);
+        out_.write(c.name.data(), nameLen);
+        uint8_t type = static_cast<uint8_t>(c.type);
+        uint8_t compressed = c.compressed ? 1 : 0;
+        writePOD(out_, type);
+        writePOD(out_, compressed);
+        writePOD(out_, c.numRows);
+        writePOD(out_, c.offset);
+        writePOD(out_, c.storedSize);
+        writePOD(out_, c.rawSize);
+    }
+    writePOD(out_, footerOffset);
+    out_.write(kMagic, sizeof(kMagic));
+    out_.close();
+    closed_ = true;
+}
+
+ColumnarReader::ColumnarReader(const std::string& path)
+    : in_(path, std::ios::in | std::ios::binary), path_(path) {
+    if (!in_.good()) {
+        throw std::runtime_error("could not open " + path + " for reading");
+    }
+
+    char magic[sizeof(kMagic)];
+    in_.read(magic, sizeof(magic));
+    if (!in_.good() or std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error(path + " is not a salmon columnar file");
+    }
+
+    // The trailer; footer offset and magic
+    in_.seekg(-static_cast<std::streamoff>(sizeof(uint64_t) + sizeof(kMagic)), std::ios::end);
+    uint64_t footerOffset{0};
+    readPOD(in_, footerOffset);
+    in_.read(magic, sizeof(magic));
+    if (!in_.good() or std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error(path + " is truncated (missing footer)");
+    }
+
+    in_.seekg(footerOffset);
+    uint32_t numColumns{0};
+    readPOD(in_, numColumns);
+    for (uint32_t i = 0; i < numColumns; ++i) {
+        ColumnInfo c;
+        uint32_t nameLen{0};
+        readPOD(in_, nameLen);
+        c.name.resize(nameLen);
+        in_.read(&c.name[0], nameLen);
+        uint8_t type{0};
+        uint8_t compressed{0};
+        readPOD(in_, type);
+        readPOD(in_, compressed);
+        c.type = static_cast<ColumnType>(type);
+        c.compressed = (compressed != 0);
+        readPOD(in_, c.numRows);
+        readPOD(in_, c.offset);
+        readPOD(in_, c.storedSize);
+        readPOD(in_, c.rawSize);
+        if (!in_.good()) {
+            throw std::runtime_error(path + " has a corrupt footer");
+        }
+        columnIndex_[c.name] = columns_.size();
+        columns_.push_back(c);
+    }
+}
+
+bool ColumnarReader::hasColumn(const std::string& name) const {
+    return columnIndex_.find(name) != columnIndex_.end();
+}
+
+const ColumnInfo& ColumnarReader::columnInfo(const std::string& name) const {
+    auto it = columnIndex_.find(name);
+    if (it == columnIndex_.end()) {
+        throw std::invalid_argument("no column named " + name + " in " + path_);
+    }
+    return columns_[it->second];
+}
+
+const std::vector<char>& ColumnarReader::rawColumn_(const std::string& name,
+                                                     ColumnType type) {
+    const auto& info = columnInfo(name);
+    if (info.type != type) {
+        throw std::invalid_argument("column " + name + " was requested with the wrong type");
+    }
+
+    auto it = cache_.find(name);
+    if (it != cache_.end()) { return it->second; }
+
+    std::vector<char> stored(info.storedSize);
+    in_.clear();
+    in_.seekg(info.offset);
+    if (info.storedSize > 0) {
+        in_.read(stored.data(), info.storedSize);
+    }
+    if (!in_.good()) {
+        throw std::runtime_error("could not read column " + name + " from " + path_);
+    }
+
+    if (info.compressed) {
+        std::vector<char> raw(info.rawSize);
+        uLongf destLen = info.rawSize;
+        int ret = uncompress(reinterpret_cast<Bytef*>(raw.data()), &destLen,
+                             reinterpret_cast<const Bytef*>(stored.data()),
+                             info.storedSize);
+        if (ret != Z_OK or destLen != info.rawSize) {
+            throw std::runtime_error("could not decompress column " + name + " from " + path_);
+        }
+        stored.swap(raw);
+    }
+
+    // Back to host order; for a string column, just its offsets
+    if (type == ColumnType::STRING) {
+        size_t offsetsLen = (info.numRows + 1) * sizeof(uint64_t);
+        if (offsetsLen > stored.size()) {
+            throw std::runtime_error("column " + name + " in " + path_ + " is truncated");
+        }
+        convertLittleEndian(stored.data(), offsetsLen, sizeof(uint64_t));
+    } else {
+        convertLittleEndian(stored.data(), stored.size(), valueWidth(type));
+    }
+    return cache_.emplace(name, std::move(stored)).first->second;
+}
+
+std::vector<std::string> ColumnarReader::stringColumn(const std::string& name) {
+    const auto& raw = rawColumn_(name, ColumnType::STRING);
+    uint64_t numRows = columnInfo(name).numRows;
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(raw.data());
+    const char* chars = raw.data() + (numRows + 1) * sizeof(uint64_t);
+    std::vector<std::string> values;
+    values.reserve(numRows);
+    for (uint64_t i = 0; i < numRows; ++i) {
+        values.emplace_back(chars + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    return values;
+}
+
+std::string ColumnarReader::stringValue(const std::string& name, size_t row) {
+    const auto& raw = rawColumn_(name, ColumnType::STRING);
+    uint64_t numRows = columnInfo(name).numRows;
+    if (row >= numRows) {
+        throw std::out_of_range("row " + std::to_string(row) + " is out of range for column " + name);
+    }
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(raw.data());
+    const char* chars = raw.data() + (numRows + 1) * sizeof(uint64_t);
+    return std::string(chars + offsets[row], offsets[row + 1] - offsets[row]);
+}
+
+}
+}
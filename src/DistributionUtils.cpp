@@ -1,9 +1,15 @@
 #include "DistributionUtils.hpp"
 #include "FragmentLengthDistribution.hpp"
+#include "SalmonRandom.hpp"
 #include "Transcript.hpp"
 
 #include <random>
 
+#include <boost/range/irange.hpp>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 namespace distribution_utils {
 
 std::vector<double> correctionFactorsFromMass(std::vector<double>& mass,
@@ -11,18 +17,21 @@ std::vector<double> correctionFactorsFromMass(std::vector<double>& mass,
   auto maxLen = mass.size();
 
   std::vector<double> correctionFactors(maxLen, 0.0);
-  std::vector<double> vals(maxLen, 0.0);
-  std::vector<double> multiplicities(maxLen, 0);
+  if (maxLen == 0) {
+    return correctionFactors;
+  }
 
-  multiplicities[0] = mass[0];
+  // Running prefix sums of (length * mass) and of mass; there is no
+  // need to materialize either one.
+  double vals{0.0};
+  double multiplicity{mass[0]};
 
-  double v{0.0};
   for (size_t i = 1; i < maxLen; ++i) {
-    v = mass[i];
-    vals[i] = static_cast<double>(v * i) + vals[i - 1];
-    multiplicities[i] = v + multiplicities[i - 1];
-    if (multiplicities[i] > 0) {
-      correctionFactors[i] = vals[i] / multiplicities[i];
+    double v = mass[i];
+    vals += v * static_cast<double>(i);
+    multiplicity += v;
+    if (multiplicity > 0) {
+      correctionFactors[i] = vals / multiplicity;
     }
   }
   return correctionFactors;
@@ -32,39 +41,58 @@ void computeSmoothedEffectiveLengths(size_t maxLength,
                                      std::vector<Transcript>& transcripts,
                                      std::vector<double>& correctionFactors,
                                      DistributionSpace outputSpace) {
+  using BlockedIndexRange = tbb::blocked_range<size_t>;
+  // The amount of work per transcript is tiny, so use blocks large enough
+  // to amortize the scheduling overhead.
+  constexpr size_t grainSize = 4096;
 
   auto maxLen = maxLength;
+  // The correction factor for every length >= maxLen is the same
+  double maxCorrection = correctionFactors[maxLen - 1];
 
-  for (auto& txp : transcripts) {
-    auto origLen = static_cast<double>(txp.RefLength);
-    double correctionFactor = (origLen >= maxLen)
-                                  ? correctionFactors[maxLen - 1]
-                                  : correctionFactors[origLen];
-
-    double effLen = origLen - correctionFactor + 1.0;
-    if (effLen < 1.0) {
-      effLen = origLen;
-    }
+  tbb::parallel_for(
+      BlockedIndexRange(size_t(0), transcripts.size(), grainSize),
+      [&](const BlockedIndexRange& range) -> void {
+        // First, compute the effective lengths of this block in a
+        // contiguous buffer (this loop has no dependencies or calls
+        // and is amenable to vectorization).
+        std::vector<double> effLens(range.size());
+        size_t j{0};
+        for (auto i : boost::irange(range.begin(), range.end())) {
+          effLens[j++] = static_cast<double>(transcripts[i].RefLength);
+        }
+        for (auto& effLen : effLens) {
+          double origLen = effLen;
+          double correctionFactor =
+              (origLen >= maxLen)
+                  ? maxCorrection
+                  : correctionFactors[static_cast<size_t>(origLen)];
+          effLen = origLen - correctionFactor + 1.0;
+          effLen = (effLen < 1.0) ? origLen : effLen;
+        }
 
-    if (outputSpace == DistributionSpace::LOG) {
-      txp.setCachedLogEffectiveLength(std::log(effLen));
-    } else {
-      txp.EffectiveLength = effLen;
-    }
-  }
+        // Then, store them back into the transcripts.
+        j = 0;
+        if (outputSpace == DistributionSpace::LOG) {
+          for (auto i : boost::irange(range.begin(), range.end())) {
+            transcripts[i].setCachedLogEffectiveLength(std::log(effLens[j++]));
+          }
+        } else {
+          for (auto i : boost::irange(range.begin(), range.end())) {
+            transcripts[i].EffectiveLength = effLens[j++];
+          }
+        }
+      });
 }
 
 std::vector<int32_t> samplesFromLogPMF(FragmentLengthDistribution* fld,
-                                       int32_t numSamples) {
+                                       int32_t numSamples, uint64_t seed) {
   std::vector<double> logPMF;
   size_t minVal;
   size_t maxVal;
   double logFLDMean = fld->mean();
   fld->dumpPMF(logPMF, minVal, maxVal);
-  double sum = salmon::math::LOG_0;
-  for (auto v : logPMF) {
-    sum = salmon::math::logAdd(sum, v);
-  }
+  double sum = salmon::math::logSumExp(logPMF.data(), logPMF.size());
   for (auto& v : logPMF) {
     v -= sum;
   }
@@ -76,8 +104,7 @@ std::vector<int32_t> samplesFromLogPMF(FragmentLengthDistribution* fld,
   }
 
   // generate samples
-  std::random_device rd;
-  std::mt19937 gen(rd());
+  auto gen = salmon::rng::stream(seed, salmon::rng::Phase::FLD_SAMPLES, 0);
   std::discrete_distribution<int32_t> dist(pmf.begin(), pmf.end());
 
   std::vector<int32_t> samples(pmf.size());
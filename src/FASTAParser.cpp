@@ -9,6 +9,7 @@
 #include "jellyfish/whole_sequence_parser.hpp"
 
 #include "FASTAParser.hpp"
+#include "SalmonRandom.hpp"
 #include "Transcript.hpp"
 #include "SalmonStringUtils.hpp"
 #include "SalmonOpts.hpp"
@@ -35,8 +36,7 @@ void FASTAParser::populateTargets(std::vector<Transcript>& refs, SalmonOpts& sop
 
     constexpr char bases[] = {'A', 'C', 'G', 'T'};
     // Create a random uniform distribution
-    std::random_device rd;
-    std::default_random_engine eng(rd());
+    auto eng = salmon::rng::stream(sopt.rngSeed, salmon::rng::Phase::REFERENCE, 0);
     std::uniform_int_distribution<> dis(0, 3);
     uint64_t numNucleotidesReplaced{0};
 
@@ -100,6 +100,7 @@ inline void copyRecord(kseq_t* seq, ReadSeq* s) {
 template <typename T>
 void parseReads(
     std::vector<std::string>& inputStreams, std::atomic<uint32_t>& numParsing,
+    std::atomic<bool>& stop, std::atomic<uint64_t>& bytesConsumed,
     moodycamel::ConsumerToken* cCont, moodycamel::ProducerToken* pRead,
     moodycamel::ConcurrentQueue<uint32_t>& workQueue,
     moodycamel::ConcurrentQueue<std::unique_ptr<ReadChunk<T>>>&
@@ -108,12 +109,14 @@ void parseReads(
   kseq_t* seq;
   T* s;
   uint32_t fn{0};
-  while (workQueue.try_dequeue(fn)) {
+  while (!stop and workQueue.try_dequeue(fn)) {
     auto file = inputStreams[fn];
     std::unique_ptr<ReadChunk<T>> local;
     while (!seqContainerQueue_.try_dequeue(*cCont, local)) {
+      if (stop) { break; }
       std::cerr << "couldn't dequeue read chunk\n";
     }
+    if (!local) { break; }
     size_t numObtained{local->size()};
     // open the file and init the parser
     auto fp = gzopen(file.c_str(), "r");
@@ -124,7 +127,7 @@ void parseReads(
     seq = kseq_init(fp);
     int ksv = kseq_read(seq);
 
-    while (ksv >= 0) {
+    while (ksv >= 0 and !stop) {
       s = &((*local)[numWaiting++]);
 
       copyRecord(seq, s);
@@ -132,12 +135,16 @@ void parseReads(
       // If we've filled the local vector, then dump to the concurrent queue
       if (numWaiting == numObtained) {
         while (!readQueue_.try_enqueue(std::move(local))) {
+          if (stop) { break; }
         }
         numWaiting = 0;
         numObtained = 0;
-        // And get more empty reads
+        // And get more empty reads (the consumers may not give any
+        // back once we've been asked to stop)
         while (!seqContainerQueue_.try_dequeue(*cCont, local)) {
+          if (stop) { break; }
         }
+        if (stop) { break; }
         numObtained = local->size();
       }
       ksv = kseq_read(seq);
@@ -145,13 +152,15 @@ void parseReads(
 
     // If we hit the end of the file and have any reads in our local buffer
     // then dump them here.
-    if (numWaiting > 0) {
+    if (numWaiting > 0 and !stop) {
       local->have(numWaiting);
       while (!readQueue_.try_enqueue(*pRead, std::move(local))) {
       }
       numWaiting = 0;
     }
     // destroy the parser and close the file
+    auto offset = gzoffset(fp);
+    if (offset > 0) { bytesConsumed += offset; }
     kseq_destroy(seq);
     gzclose(fp);
   }
@@ -163,6 +172,7 @@ template <typename T>
 void parseReadPair(
     std::vector<std::string>& inputStreams,
     std::vector<std::string>& inputStreams2, std::atomic<uint32_t>& numParsing,
+    std::atomic<bool>& stop, std::atomic<uint64_t>& bytesConsumed,
     moodycamel::ConsumerToken* cCont, moodycamel::ProducerToken* pRead,
     moodycamel::ConcurrentQueue<uint32_t>& workQueue,
     moodycamel::ConcurrentQueue<std::unique_ptr<ReadChunk<T>>>&
@@ -174,15 +184,17 @@ void parseReadPair(
   T* s;
 
   uint32_t fn{0};
-  while (workQueue.try_dequeue(fn)) {
+  while (!stop and workQueue.try_dequeue(fn)) {
     // for (size_t fn = 0; fn < inputStreams.size(); ++fn) {
     auto& file = inputStreams[fn];
     auto& file2 = inputStreams2[fn];
 
     std::unique_ptr<ReadChunk<T>> local;
     while (!seqContainerQueue_.try_dequeue(*cCont, local)) {
+      if (stop) { break; }
       std::cerr << "couldn't dequeue read chunk\n";
     }
+    if (!local) { break; }
     size_t numObtained{local->size()};
     // open the file and init the parser
     auto fp = gzopen(file.c_str(), "r");
@@ -196,7 +208,7 @@ void parseReadPair(
 
     int ksv = kseq_read(seq);
     int ksv2 = kseq_read(seq2);
-    while (ksv >= 0 and ksv2 >= 0) {
+    while (ksv >= 0 and ksv2 >= 0 and !stop) {
 
       s = &((*local)[numWaiting++]);
       copyRecord(seq, &s->first);
@@ -205,12 +217,16 @@ void parseReadPair(
       // If we've filled the local vector, then dump to the concurrent queue
       if (numWaiting == numObtained) {
         while (!readQueue_.try_enqueue(std::move(local))) {
+          if (stop) { break; }
         }
         numWaiting = 0;
         numObtained = 0;
-        // And get more empty reads
+        // And get more empty reads (the consumers may not give any
+        // back once we've been asked to stop)
         while (!seqContainerQueue_.try_dequeue(*cCont, local)) {
+          if (stop) { break; }
         }
+        if (stop) { break; }
         numObtained = local->size();
       }
       ksv = kseq_read(seq);
@@ -219,13 +235,17 @@ void parseReadPair(
 
     // If we hit the end of the file and have any reads in our local buffer
     // then dump them here.
-    if (numWaiting > 0) {
+    if (numWaiting > 0 and !stop) {
       local->have(numWaiting);
       while (!readQueue_.try_enqueue(*pRead, std::move(local))) {
       }
       numWaiting = 0;
     }
     // destroy the parser and close the file
+    auto offset = gzoffset(fp);
+    auto offset2 = gzoffset(fp2);
+    if (offset > 0) { bytesConsumed += offset; }
+    if (offset2 > 0) { bytesConsumed += offset2; }
     kseq_destroy(seq);
     gzclose(fp);
     kseq_destroy(seq2);
@@ -241,6 +261,7 @@ template <> bool FastxParser<ReadSeq>::start() {
       ++numParsing_;
       parsingThreads_.emplace_back(new std::thread([this, i]() {
         parseReads(this->inputStreams_, this->numParsing_,
+                   this->stopRequested_, this->bytesConsumed_,
                    this->consumeContainers_[i].get(),
                    this->produceReads_[i].get(), this->workQueue_,
                    this->seqContainerQueue_, this->readQueue_);
@@ -272,7 +293,8 @@ template <> bool FastxParser<ReadPair>::start() {
       ++numParsing_;
       parsingThreads_.emplace_back(new std::thread([this, i]() {
         parseReadPair(this->inputStreams_, this->inputStreams2_,
-                      this->numParsing_, this->consumeContainers_[i].get(),
+                      this->numParsing_, this->stopRequested_,
+                      this->bytesConsumed_, this->consumeContainers_[i].get(),
                       this->produceReads_[i].get(), this->workQueue_,
                       this->seqContainerQueue_, this->readQueue_);
       }));
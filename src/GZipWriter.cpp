@@ -3,7 +3,10 @@
 
 #include "cereal/archives/json.hpp"
 
+#include "BiasBackground.hpp"
+#include "ColumnarFile.hpp"
 #include "DistributionUtils.hpp"
+#include "EarlyStopMonitor.hpp"
 #include "GZipWriter.hpp"
 #include "SalmonOpts.hpp"
 #include "ReadExperiment.hpp"
@@ -19,6 +22,9 @@ GZipWriter::~GZipWriter() {
   if (bsStream_) {
     bsStream_->reset();
   }
+  if (bsColumns_) {
+    bsColumns_->close();
+  }
 }
 
 /**
@@ -94,6 +100,31 @@ bool GZipWriter::writeEquivCounts(
   }
 
   equivFile.close();
+
+  if (opts.binaryOutput) {
+    // In the binary file, the classes are stored in CSR form; the
+    // members of class i are classTxps[classOffsets[i] .. classOffsets[i+1]).
+    std::vector<std::string> names;
+    names.reserve(transcripts.size());
+    for (auto& t : transcripts) { names.emplace_back(t.RefName); }
+
+    std::vector<uint64_t> classOffsets(eqVec.size() + 1, 0);
+    std::vector<uint64_t> classCounts(eqVec.size(), 0);
+    std::vector<uint32_t> classTxps;
+    for (size_t i = 0; i < eqVec.size(); ++i) {
+      const std::vector<uint32_t>& txps = eqVec[i].first.txps;
+      classTxps.insert(classTxps.end(), txps.begin(), txps.end());
+      classOffsets[i + 1] = classTxps.size();
+      classCounts[i] = eqVec[i].second.count;
+    }
+
+    salmon::columnar::ColumnarWriter eqOut((auxDir / "eq_classes.bin").string());
+    eqOut.addColumn("names", names);
+    eqOut.addColumn("classOffsets", classOffsets);
+    eqOut.addColumn("classTxps", classTxps);
+    eqOut.addColumn("classCounts", classCounts);
+    eqOut.close();
+  }
   return true;
 }
 
@@ -158,12 +189,22 @@ bool GZipWriter::writeMeta(
           nameOut.reset();
       }
 
+      if (opts.binaryOutput) {
+          std::vector<std::string> names;
+          auto& transcripts = experiment.transcripts();
+          names.reserve(transcripts.size());
+          for (auto& t : transcripts) { names.emplace_back(t.RefName); }
+          bsColumns_.reset(new salmon::columnar::ColumnarWriter((bsPath_ / "bootstraps.bin").string()));
+          bsColumns_->addColumn("names", names);
+      }
+
   }
 
   bfs::path fldPath = auxDir / "fld.gz";
   int32_t numFLDSamples{10000};
   auto fldSamples = distribution_utils::samplesFromLogPMF(
-                        experiment.fragmentLengthDistribution(), numFLDSamples);
+                        experiment.fragmentLengthDistribution(), numFLDSamples,
+                        opts.rngSeed);
   writeVectorToFile(fldPath, fldSamples);
 
   bfs::path normBiasPath = auxDir / "expected_bias.gz";
@@ -259,6 +300,24 @@ bool GZipWriter::writeMeta(
   writeVectorToFile(obsGCPath, observedGC);
   */
 
+  return writeMetaInfo(opts, experiment, tstring);
+}
+
+template <typename ExpT>
+bool GZipWriter::writeMetaInfo(
+    const SalmonOpts& opts,
+    const ExpT& experiment,
+    const std::string& tstring // the start time of the run
+    ) {
+
+  namespace bfs = boost::filesystem;
+
+  bfs::path auxDir = path_ / opts.auxDir;
+  auto numBootstraps = opts.numBootstraps;
+  auto numSamples = (numBootstraps > 0) ? numBootstraps : opts.numGibbsSamples;
+  int32_t numFLDSamples{10000};
+  const auto& bcounts = experiment.readBias(salmon::utils::Direction::FORWARD).counts;
+
   bfs::path info = auxDir / "meta_info.json";
 
   {
@@ -281,7 +340,7 @@ bool GZipWriter::writeMeta(
       oa(cereal::make_nvp("num_libraries", libStrings.size()));
       oa(cereal::make_nvp("library_types", libStrings));
 
-      oa(cereal::make_nvp("frag_dist_length", fldSamples.size()));
+      oa(cereal::make_nvp("frag_dist_length", numFLDSamples));
       oa(cereal::make_nvp("seq_bias_correct", opts.biasCorrect));
       oa(cereal::make_nvp("gc_bias_correct", opts.gcBiasCorrect));
       oa(cereal::make_nvp("num_bias_bins", bcounts.size()));
@@ -291,11 +350,36 @@ bool GZipWriter::writeMeta(
 
       oa(cereal::make_nvp("num_targets", transcripts.size()));
       oa(cereal::make_nvp("num_bootstraps", numSamples));
+      oa(cereal::make_nvp("seed", opts.rngSeed));
       oa(cereal::make_nvp("num_processed", experiment.numObservedFragments()));
       oa(cereal::make_nvp("num_mapped", experiment.numMappedFragments()));
       oa(cereal::make_nvp("percent_mapped", experiment.effectiveMappingRate() * 100.0));
       oa(cereal::make_nvp("call", std::string("quant")));
       oa(cereal::make_nvp("start_time", tstring));
+      // How much merging or dropping rare equivalence classes (to bound
+      // memory) changed the input to the offline phase
+      auto& eqBuilder = experiment.equivalenceClassBuilder();
+      oa(cereal::make_nvp("num_eq_classes_merged", eqBuilder.numMergedClasses()));
+      oa(cereal::make_nvp("num_fragments_in_merged_eq_classes", eqBuilder.numMergedFragments()));
+      oa(cereal::make_nvp("eq_class_reassigned_mass", eqBuilder.reassignedMass()));
+      oa(cereal::make_nvp("num_eq_classes_dropped", eqBuilder.numDroppedClasses()));
+      oa(cereal::make_nvp("num_fragments_in_dropped_eq_classes", eqBuilder.numDroppedFragments()));
+      // How far the bias background computed during mapping (if it was
+      // used) is from the one computed from the final estimates
+      if (opts.biasBackground and opts.biasBackground->used) {
+        oa(cereal::make_nvp("bias_background_max_weight_deviation",
+                            opts.biasBackground->maxWeightDeviation));
+        oa(cereal::make_nvp("bias_background_fld_distance",
+                            opts.biasBackground->fldDeviation));
+      }
+      // Whether (and when) we stopped reading the input early
+      if (opts.earlyStop) {
+        oa(cereal::make_nvp("early_stop", *opts.earlyStop));
+      }
+      // Which auxiliary models settled, and when
+      oa(cereal::make_nvp("aux_model_updates", *opts.auxModels));
+      // Where the time (and memory) went, by phase
+      oa(cereal::make_nvp("telemetry", *opts.telemetry));
   }
   return true;
 }
@@ -333,6 +417,18 @@ bool GZipWriter::writeAbundances(
       tfracDenom += (transcript.projectedCounts / numMappedFrags) / refLength;
   }
 
+  bool binary = sopt.binaryOutput;
+  std::vector<std::string> names;
+  std::vector<uint32_t> lengths;
+  std::vector<double> effLengths, tpms, counts;
+  if (binary) {
+      names.reserve(transcripts_.size());
+      lengths.reserve(transcripts_.size());
+      effLengths.reserve(transcripts_.size());
+      tpms.reserve(transcripts_.size());
+      counts.reserve(transcripts_.size());
+  }
+
   double million = 1000000.0;
   // Now posterior has the transcript fraction
   for (auto& transcript : transcripts_) {
@@ -344,6 +440,23 @@ bool GZipWriter::writeAbundances(
       fmt::print(output.get(), "{}\t{}\t{}\t{}\t{}\n",
               transcript.RefName, transcript.RefLength, effLength,
               tpm, count);
+      if (binary) {
+          names.emplace_back(transcript.RefName);
+          lengths.push_back(transcript.RefLength);
+          effLengths.push_back(effLength);
+          tpms.push_back(tpm);
+          counts.push_back(count);
+      }
+  }
+
+  if (binary) {
+      salmon::columnar::ColumnarWriter binOut((path_ / "quant.bin").string());
+      binOut.addColumn("Name", names);
+      binOut.addColumn("Length", lengths);
+      binOut.addColumn("EffectiveLength", effLengths);
+      binOut.addColumn("TPM", tpms);
+      binOut.addColumn("NumReads", counts);
+      binOut.close();
   }
   return true;
 }
@@ -369,6 +482,9 @@ bool GZipWriter::writeBootstrap(const std::vector<T>& abund) {
         size_t elSize = sizeof(typename std::vector<T>::value_type);
         ofile.write(reinterpret_cast<char*>(const_cast<T*>(abund.data())),
                     elSize * num);
+        if (bsColumns_) {
+            bsColumns_->addColumn("bootstrap." + std::to_string(numBootstrapsWritten_.load()), abund);
+        }
         logger_->info("wrote {} bootstraps", numBootstrapsWritten_.load()+1);
         ++numBootstrapsWritten_;
         return true;
@@ -399,6 +515,24 @@ template
 bool GZipWriter::writeAbundances<AlignmentLibrary<ReadPair>>(const SalmonOpts& sopt,
                                                  AlignmentLibrary<ReadPair>& readExp);
 
+template
+bool GZipWriter::writeMetaInfo<ReadExperiment>(
+    const SalmonOpts& opts,
+    const ReadExperiment& experiment,
+    const std::string& tstring);
+
+template
+bool GZipWriter::writeMetaInfo<AlignmentLibrary<UnpairedRead>>(
+    const SalmonOpts& opts,
+    const AlignmentLibrary<UnpairedRead>& experiment,
+    const std::string& tstring);
+
+template
+bool GZipWriter::writeMetaInfo<AlignmentLibrary<ReadPair>>(
+    const SalmonOpts& opts,
+    const AlignmentLibrary<ReadPair>& experiment,
+    const std::string& tstring);
+
 template
 bool GZipWriter::writeMeta<ReadExperiment>(
     const SalmonOpts& opts,
@@ -0,0 +1,64 @@
+#include "IndexUpdate.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace salmon {
+namespace index_update {
+
+UpdatePlan planUpdate(const IndexTranscripts& current,
+                      const std::vector<std::string>& remove,
+                      const std::vector<std::string>& add) {
+    UpdatePlan plan;
+
+    std::unordered_set<std::string> base(current.base.begin(), current.base.end());
+    std::unordered_set<std::string> masked(current.maskedBase.begin(), current.maskedBase.end());
+    std::unordered_set<std::string> added(current.added.begin(), current.added.end());
+
+    for (auto& name : remove) {
+        if (added.erase(name) > 0) {
+            plan.dropAdded.push_back(name);
+        } else if (base.count(name) > 0 and masked.insert(name).second) {
+            plan.maskBase.push_back(name);
+        } else {
+            plan.notFound.push_back(name);
+        }
+    }
+
+    std::unordered_set<std::string> adding;
+    for (auto& name : add) {
+        if (!adding.insert(name).second) {
+            plan.error = "the transcript " + name + " is added more than once";
+            return plan;
+        }
+        bool liveInBase = base.count(name) > 0 and masked.count(name) == 0;
+        if (liveInBase or added.count(name) > 0) {
+            plan.error = "the transcript " + name + " is already in the index; "
+                         "remove it (with --removeTranscripts) to replace it";
+            return plan;
+        }
+    }
+    return plan;
+}
+
+std::vector<bool> maskedTranscripts(const std::vector<std::string>& base,
+                                    size_t numAdded,
+                                    const std::vector<std::string>& maskedBase,
+                                    std::vector<std::string>& unknown) {
+    std::unordered_map<std::string, size_t> ids;
+    for (size_t i = 0; i < base.size(); ++i) { ids[base[i]] = i; }
+
+    std::vector<bool> masked(base.size() + numAdded, false);
+    for (auto& name : maskedBase) {
+        auto it = ids.find(name);
+        if (it == ids.end()) {
+            unknown.push_back(name);
+        } else {
+            masked[it->second] = true;
+        }
+    }
+    return masked;
+}
+
+}
+}
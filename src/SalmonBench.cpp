@@ -0,0 +1,563 @@
+/**
+>HEADER
+    Copyright (c) 2013 Rob Patro robp@cs.cmu.edu
+
+    This file is part of Salmon.
+
+    Salmon is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Salmon is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Salmon.  If not, see <http://www.gnu.org/licenses/>.
+<HEADER
+**/
+
+/**
+ * salmon_bench : microbenchmarks for the hot paths of quantification.
+ *
+ * Each benchmark is run over synthetic data drawn from a fixed seed (so
+ * that runs are reproducible), at every thread count in {1, 2, 4, ...}
+ * up to --threads.  Results are written as one JSON object per line:
+ *
+ *   {"benchmark": ..., "threads": ..., "items": ..., "seconds": ..., "items_per_second": ...}
+ *
+ * The FASTQ parser can also be driven by real reads (--reads); e.g. the
+ * reads in sample_data.tgz.
+ *
+ * processMiniBatch itself isn't benchmarked, as it needs a loaded index
+ * and a ReadExperiment; the per-fragment work it does is covered by the
+ * ClusterForest, FragmentLengthDistribution, EquivalenceClassBuilder and
+ * logAdd benchmarks.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "tbb/task_scheduler_init.h"
+
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/null_sink.h"
+
+#include "BiasBackground.hpp"
+#include "ClusterForest.hpp"
+#include "CollapsedEMOptimizer.hpp"
+#include "CollapsedGibbsSampler.hpp"
+#include "DistributionUtils.hpp"
+#include "EquivalenceClassBuilder.hpp"
+#include "FastxParser.hpp"
+#include "FragmentLengthDistribution.hpp"
+#include "MultinomialSampler.hpp"
+#include "SalmonMath.hpp"
+#include "SalmonOpts.hpp"
+#include "SalmonRandom.hpp"
+#include "SalmonUtils.hpp"
+#include "SimulatedBiasExperiment.hpp"
+#include "Transcript.hpp"
+#include "TranscriptGroup.hpp"
+
+namespace {
+
+struct BenchOpts {
+  uint32_t maxThreads{1};
+  uint32_t seed{42};
+  uint32_t numTxps{50000};
+  uint32_t numClasses{100000};
+  uint32_t numReads{1000000};
+  uint32_t numBootstraps{8};
+  uint32_t numBiasTxps{500};
+  std::string readFile;
+};
+
+/**
+ * A synthetic set of transcripts and equivalence classes with a
+ * realistic shape; most classes are small, and class labels are drawn
+ * from "genes" of neighboring transcripts.
+ */
+struct SyntheticExperiment {
+  std::vector<Transcript> transcripts;
+  std::vector<std::string> names;
+  std::vector<std::vector<uint32_t>> classLabels;
+  std::vector<std::vector<double>> classWeights;
+  std::vector<uint64_t> classCounts;
+
+  SyntheticExperiment(const BenchOpts& bopts) {
+    std::mt19937 gen(bopts.seed);
+    std::lognormal_distribution<> lenDist(7.3, 0.7);
+    std::geometric_distribution<> sizeDist(0.45);
+    std::geometric_distribution<> countDist(0.02);
+    std::uniform_int_distribution<uint32_t> txpDist(0, bopts.numTxps - 1);
+    std::uniform_real_distribution<> weightDist(0.1, 1.0);
+
+    names.reserve(bopts.numTxps);
+    transcripts.reserve(bopts.numTxps);
+    for (uint32_t i = 0; i < bopts.numTxps; ++i) {
+      names.push_back("txp" + std::to_string(i));
+      uint32_t len = std::max(200u, static_cast<uint32_t>(lenDist(gen)));
+      transcripts.emplace_back(i, names.back().c_str(), len, 0.005);
+      transcripts.back().EffectiveLength = std::max(1.0, len - 200.0);
+      transcripts.back().setActive();
+    }
+
+    classLabels.resize(bopts.numClasses);
+    classWeights.resize(bopts.numClasses);
+    classCounts.resize(bopts.numClasses);
+    for (uint32_t c = 0; c < bopts.numClasses; ++c) {
+      size_t k = std::min(20, 1 + sizeDist(gen));
+      uint32_t first = txpDist(gen);
+      auto& labels = classLabels[c];
+      for (size_t j = 0; j < k; ++j) {
+        labels.push_back(std::min(bopts.numTxps - 1, first + static_cast<uint32_t>(j)));
+      }
+      std::sort(labels.begin(), labels.end());
+      labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+      auto& weights = classWeights[c];
+      double wsum{0.0};
+      for (size_t j = 0; j < labels.size(); ++j) {
+        weights.push_back(weightDist(gen));
+        wsum += weights.back();
+      }
+      for (auto& w : weights) { w /= wsum; }
+      classCounts[c] = 1 + countDist(gen);
+    }
+  }
+};
+
+class Reporter {
+public:
+  Reporter(std::ostream& out) : out_(out) {}
+  void report(const std::string& name, uint32_t threads, uint64_t items, double seconds) {
+    out_ << "{\"benchmark\": \"" << name << "\", \"threads\": " << threads
+         << ", \"items\": " << items << ", \"seconds\": " << seconds
+         << ", \"items_per_second\": " << ((seconds > 0.0) ? items / seconds : 0.0)
+         << "}" << std::endl;
+  }
+
+private:
+  std::ostream& out_;
+};
+
+template <typename FnT> double timeIt(FnT&& fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Run fn(threadIndex) on each of numThreads threads, and return the elapsed time
+template <typename FnT> double timeOnThreads(uint32_t numThreads, FnT&& fn) {
+  return timeIt([&]() -> void {
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&fn, t]() -> void { fn(t); });
+    }
+    for (auto& t : threads) { t.join(); }
+  });
+}
+
+void benchFragmentLengthDistribution(const BenchOpts& bopts, uint32_t numThreads, Reporter& rep) {
+  FragmentLengthDistribution fld(1.0, 1000, 200, 80, 4, 0.5, 1);
+  uint64_t perThread = bopts.numReads / numThreads;
+  double secs = timeOnThreads(numThreads, [&](uint32_t t) -> void {
+    std::mt19937 gen(bopts.seed + t);
+    std::normal_distribution<> lenDist(250.0, 50.0);
+    for (uint64_t i = 0; i < perThread; ++i) {
+      size_t len = std::max(1.0, std::min(999.0, lenDist(gen)));
+      fld.addVal(len, salmon::math::LOG_1);
+    }
+  });
+  rep.report("FragmentLengthDistribution::addVal", numThreads, perThread * numThreads, secs);
+}
+
+void benchLogAdd(const BenchOpts& bopts, uint32_t numThreads, Reporter& rep) {
+  std::vector<double> vals(1 << 16);
+  std::mt19937 gen(bopts.seed);
+  std::uniform_real_distribution<> dis(-40.0, 0.0);
+  for (auto& v : vals) { v = dis(gen); }
+  uint64_t perThread = bopts.numReads * 10 / numThreads;
+
+  for (auto acc : {salmon::math::Accuracy::EXACT, salmon::math::Accuracy::FAST}) {
+    salmon::math::setAccuracy(acc);
+    std::atomic<double> sink{0.0};
+    double secs = timeOnThreads(numThreads, [&](uint32_t t) -> void {
+      double sum = salmon::math::LOG_0;
+      for (uint64_t i = 0; i < perThread; ++i) {
+        sum = salmon::math::logAdd(vals[(i + t) & (vals.size() - 1)], sum - 1.0);
+      }
+      sink = sum;
+    });
+    std::string name = (acc == salmon::math::Accuracy::EXACT) ? "salmon::math::logAdd(exact)"
+                                                            : "salmon::math::logAdd(fast)";
+    rep.report(name, numThreads, perThread * numThreads, secs);
+  }
+  salmon::math::setAccuracy(salmon::math::Accuracy::EXACT);
+}
+
+void benchEquivalenceClassBuilder(const BenchOpts& bopts, const SyntheticExperiment& exp,
+                                  uint32_t numThreads, Reporter& rep) {
+  auto logger = spdlog::get("benchLog");
+  EquivalenceClassBuilder eqBuilder(logger);
+  eqBuilder.start();
+  uint64_t perThread = bopts.numReads / numThreads;
+  double secs = timeOnThreads(numThreads, [&](uint32_t t) -> void {
+    std::mt19937 gen(bopts.seed + t);
+    std::uniform_int_distribution<size_t> classDist(0, exp.classLabels.size() - 1);
+    std::vector<double> posWeights;
+    for (uint64_t i = 0; i < perThread; ++i) {
+      size_t c = classDist(gen);
+      std::vector<double> weights(exp.classWeights[c]);
+      TranscriptGroup tg(exp.classLabels[c]);
+      eqBuilder.addGroup(std::move(tg), weights, posWeights);
+    }
+  });
+  rep.report("EquivalenceClassBuilder::addGroup", numThreads, perThread * numThreads, secs);
+}
+
+void benchEffectiveLengths(const BenchOpts& bopts, SyntheticExperiment& exp,
+                           uint32_t numThreads, Reporter& rep) {
+  tbb::task_scheduler_init tbbScheduler(numThreads);
+  std::vector<double> pmf(1001, 0.0);
+  for (size_t i = 1; i < pmf.size(); ++i) {
+    double z = (static_cast<double>(i) - 250.0) / 50.0;
+    pmf[i] = 100.0 * std::exp(-0.5 * z * z);
+  }
+  using distribution_utils::DistributionSpace;
+  size_t reps{20};
+  double secs = timeIt([&]() -> void {
+    for (size_t r = 0; r < reps; ++r) {
+      auto correctionFactors = distribution_utils::correctionFactorsFromMass(pmf, DistributionSpace::LINEAR);
+      distribution_utils::computeSmoothedEffectiveLengths(pmf.size(), exp.transcripts,
+                                                          correctionFactors, DistributionSpace::LOG);
+    }
+  });
+  rep.report("computeSmoothedEffectiveLengths", numThreads, reps * exp.transcripts.size(), secs);
+}
+
+// The hits of a synthetic fragment, as ClusterForest::mergeClusters() sees them
+struct BenchHit {
+  uint32_t tid;
+  uint32_t transcriptID() const { return tid; }
+};
+
+void benchClusterForest(const BenchOpts& bopts, SyntheticExperiment& exp,
+                        uint32_t numThreads, Reporter& rep) {
+  ClusterForest forest(exp.transcripts.size(), exp.transcripts);
+  uint64_t perThread = bopts.numReads / numThreads;
+  double secs = timeIt([&]() -> void {
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t]() -> void {
+        std::mt19937 gen(bopts.seed + t);
+        std::uniform_int_distribution<size_t> classDist(0, exp.classLabels.size() - 1);
+        std::vector<BenchHit> hits;
+        for (uint64_t i = 0; i < perThread; ++i) {
+          auto& labels = exp.classLabels[classDist(gen)];
+          hits.clear();
+          for (auto l : labels) { hits.push_back({l}); }
+          forest.mergeClusters<BenchHit>(hits.begin(), hits.end());
+          forest.updateCluster(hits.front().tid, 1, salmon::math::LOG_1, true);
+        }
+      });
+    }
+    for (auto& t : threads) { t.join(); }
+    forest.getClusters();
+  });
+  rep.report("ClusterForest", numThreads, perThread * numThreads, secs);
+}
+
+/**
+ * The final, bias-corrected, effective lengths of a simulated experiment;
+ * either computed afresh (as with --exactBiasBackground) or by bringing a
+ * background computed from online estimates up to date.
+ */
+void benchUpdateEffectiveLengths(const BenchOpts& bopts, bool useBackground,
+                                 uint32_t numThreads, Reporter& rep) {
+  tbb::task_scheduler_init tbbScheduler(numThreads);
+  SalmonOpts sopt;
+  sopt.jointLog = spdlog::get("benchLog");
+  sopt.biasCorrect = true;
+  sopt.gcBiasCorrect = true;
+  sopt.posBiasCorrect = true;
+  sopt.gcSampFactor = 1;
+  sopt.pdfSampFactor = 1;
+  sopt.noBiasLengthThreshold = false;
+  sopt.fragLenDistMax = 1000;
+  sopt.fragLenDistPriorMean = 250;
+  sopt.fragLenDistPriorSD = 25;
+
+  salmon::detail::SimulatedBiasExperiment experiment(sopt, bopts.numBiasTxps,
+                                                     bopts.numReads / 10, bopts.seed);
+  auto& transcripts = experiment.transcripts();
+  size_t numTxps = transcripts.size();
+  Eigen::VectorXd effLens(numTxps);
+  std::vector<double> alphas(numTxps);
+  std::vector<double> online(numTxps);
+  std::mt19937 gen(bopts.seed);
+  std::uniform_real_distribution<> drift(0.8, 1.25);
+  for (size_t i = 0; i < numTxps; ++i) {
+    effLens(i) = transcripts[i].EffectiveLength;
+    alphas[i] = std::exp(transcripts[i].mass(false));
+    online[i] = alphas[i] * drift(gen);
+  }
+
+  size_t reps{3};
+  double secs{0.0};
+  for (size_t r = 0; r < reps; ++r) {
+    // (bringing the background up to date changes it, so each repetition
+    // starts from a fresh one; computing it isn't timed, as it overlaps
+    // with mapping)
+    if (useBackground) {
+      experiment.setAbundances(online);
+      sopt.biasBackground = std::make_shared<BiasBackground>(sopt.numConditionalGCBins,
+                                                             sopt.numFragGCBins);
+      salmon::utils::precomputeBiasBackground(sopt, experiment);
+      experiment.setAbundances(alphas);
+    }
+    secs += timeIt([&]() -> void {
+      salmon::utils::updateEffectiveLengths(sopt, experiment, effLens, alphas);
+    });
+  }
+  rep.report(useBackground ? "updateEffectiveLengths(background)"
+                           : "updateEffectiveLengths(exact)",
+             numThreads, reps * numTxps, secs);
+}
+
+void benchBootstrap(const BenchOpts& bopts, SyntheticExperiment& exp, bool useVBEM,
+                    uint32_t numThreads, Reporter& rep) {
+  SalmonOpts sopt;
+  sopt.useQuasi = true;
+  sopt.useVBOpt = useVBEM;
+  sopt.perTranscriptPrior = false;
+  sopt.numBootstraps = bopts.numBootstraps * numThreads;
+  sopt.rngSeed = bopts.seed;
+  sopt.jointLog = spdlog::get("benchLog");
+
+  size_t numTxps = exp.transcripts.size();
+  Eigen::VectorXd effLens(numTxps);
+  for (size_t i = 0; i < numTxps; ++i) { effLens(i) = exp.transcripts[i].EffectiveLength; }
+
+  // The combined weights, as computed by the optimizer
+  std::vector<std::vector<double>> combinedWeights(exp.classWeights);
+  for (size_t c = 0; c < combinedWeights.size(); ++c) {
+    for (size_t j = 0; j < combinedWeights[c].size(); ++j) {
+      combinedWeights[c][j] /= effLens(exp.classLabels[c][j]);
+    }
+  }
+
+  uint64_t totalNumFrags{0};
+  for (auto c : exp.classCounts) { totalNumFrags += c; }
+  std::vector<double> sampleWeights(exp.classCounts.size());
+  for (size_t c = 0; c < sampleWeights.size(); ++c) {
+    sampleWeights[c] = static_cast<double>(exp.classCounts[c]) / totalNumFrags;
+  }
+  std::vector<double> priorAlphas(numTxps, 1e-3);
+  std::function<void(uint32_t, const std::vector<double>&)> writeBootstrap =
+      [](uint32_t, const std::vector<double>&) -> void {};
+
+  std::atomic<uint32_t> bsNum{0};
+  double secs = timeOnThreads(numThreads, [&](uint32_t) -> void {
+    // Work on copies of the data that doBootstrap may modify
+    auto labels = exp.classLabels;
+    auto weights = combinedWeights;
+    std::vector<Transcript>& txps = exp.transcripts;
+    salmon::detail::doBootstrap(labels, weights, txps, effLens, sampleWeights,
+                                totalNumFrags, totalNumFrags, 1.0 / numTxps,
+                                bsNum, sopt, priorAlphas, writeBootstrap,
+                                0.01, 1000);
+  });
+  rep.report(useVBEM ? "doBootstrap(VBEMUpdate_)" : "doBootstrap(EMUpdate_)",
+             numThreads, sopt.numBootstraps, secs);
+}
+
+void benchGibbsRound(const BenchOpts& bopts, SyntheticExperiment& exp,
+                     uint32_t numThreads, Reporter& rep) {
+  std::vector<std::pair<const TranscriptGroup, TGValue>> eqVec;
+  eqVec.reserve(exp.classLabels.size());
+  std::vector<double> posWeights;
+  size_t countMapSize{0};
+  for (size_t c = 0; c < exp.classLabels.size(); ++c) {
+    std::vector<double> weights(exp.classWeights[c]);
+    eqVec.emplace_back(TranscriptGroup(exp.classLabels[c]),
+                       TGValue(weights, posWeights, exp.classCounts[c]));
+    eqVec.back().second.combinedWeights = exp.classWeights[c];
+    countMapSize += exp.classLabels[c].size();
+  }
+  size_t numTxps = exp.transcripts.size();
+  Eigen::VectorXd effLens(numTxps);
+  for (size_t i = 0; i < numTxps; ++i) {
+    effLens(i) = exp.transcripts[i].EffectiveLength;
+    exp.transcripts[i].setMass(1.0);
+  }
+  double priorAlpha = 1e-8;
+  size_t roundsPerThread{10};
+
+  double secs = timeOnThreads(numThreads, [&](uint32_t t) -> void {
+    MultinomialSampler ms(salmon::rng::stream(bopts.seed, salmon::rng::Phase::GIBBS, t));
+    std::vector<uint64_t> countMap(countMapSize, 0);
+    std::vector<double> probMap(countMapSize, 0.0);
+    std::vector<int> txpCounts(numTxps, 0);
+    salmon::detail::initCountMap_(eqVec, exp.transcripts, priorAlpha, ms, countMap, probMap, effLens, txpCounts);
+    for (size_t r = 0; r < roundsPerThread; ++r) {
+      salmon::detail::sampleRound_(eqVec, countMap, probMap, effLens, priorAlpha, txpCounts, ms);
+    }
+  });
+  rep.report("sampleRound_", numThreads, roundsPerThread * numThreads, secs);
+}
+
+// Write a FASTQ file of random reads
+void writeSyntheticReads(const std::string& fname, const BenchOpts& bopts) {
+  std::mt19937 gen(bopts.seed);
+  std::uniform_int_distribution<> nucDist(0, 3);
+  const char nucs[] = {'A', 'C', 'G', 'T'};
+  std::ofstream out(fname);
+  std::string seq(100, 'A');
+  std::string qual(100, 'I');
+  for (uint32_t i = 0; i < bopts.numReads; ++i) {
+    for (auto& c : seq) { c = nucs[nucDist(gen)]; }
+    out << "@read" << i << '\n' << seq << "\n+\n" << qual << '\n';
+  }
+}
+
+void benchFastxParser(const std::string& readFile, uint32_t numThreads, Reporter& rep) {
+  using single_parser = fastx_parser::FastxParser<fastx_parser::ReadSeq>;
+  std::vector<std::string> files{readFile};
+  std::atomic<uint64_t> numReads{0};
+  std::atomic<uint64_t> numBases{0};
+  double secs = timeIt([&]() -> void {
+    single_parser parser(files, numThreads, 1);
+    parser.start();
+    std::vector<std::thread> consumers;
+    for (uint32_t t = 0; t < numThreads; ++t) {
+      consumers.emplace_back([&]() -> void {
+        uint64_t localReads{0};
+        uint64_t localBases{0};
+        auto rg = parser.getReadGroup();
+        while (parser.refill(rg)) {
+          for (auto& r : rg) {
+            ++localReads;
+            localBases += r.seq.length();
+          }
+        }
+        numReads += localReads;
+        numBases += localBases;
+      });
+    }
+    for (auto& t : consumers) { t.join(); }
+  });
+  rep.report("FastxParser", numThreads, numReads, secs);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  using std::string;
+  namespace po = boost::program_options;
+  namespace bfs = boost::filesystem;
+
+  BenchOpts bopts;
+  bopts.maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  string outFile;
+  string only;
+
+  po::options_description opts("salmon_bench options");
+  opts.add_options()
+    ("help,h", "produce help message")
+    ("threads,p", po::value<uint32_t>(&bopts.maxThreads), "The maximum number of threads to "
+     "use; every benchmark is run with 1, 2, 4, ... threads, up to this number.")
+    ("seed", po::value<uint32_t>(&bopts.seed)->default_value(42), "The seed for the "
+     "synthetic data generators.")
+    ("numTranscripts", po::value<uint32_t>(&bopts.numTxps)->default_value(50000),
+     "The number of synthetic transcripts.")
+    ("numClasses", po::value<uint32_t>(&bopts.numClasses)->default_value(100000),
+     "The number of synthetic equivalence classes.")
+    ("numReads", po::value<uint32_t>(&bopts.numReads)->default_value(1000000),
+     "The number of synthetic reads / fragments.")
+    ("numBootstraps", po::value<uint32_t>(&bopts.numBootstraps)->default_value(8),
+     "The number of bootstraps to draw per thread.")
+    ("numBiasTranscripts", po::value<uint32_t>(&bopts.numBiasTxps)->default_value(500),
+     "The number of simulated transcripts (with sequences) for the bias-corrected "
+     "updateEffectiveLengths benchmarks; these draw numReads / 10 fragments.")
+    ("reads,r", po::value<string>(&bopts.readFile), "A FASTA/Q file (e.g. one of the "
+     "read files of sample_data.tgz) with which to benchmark the parser; if this "
+     "isn't given, synthetic reads are used.")
+    ("only", po::value<string>(&only)->default_value(""), "Only run the benchmarks "
+     "whose names contain this string.")
+    ("output,o", po::value<string>(&outFile), "Write the results to this file "
+     "(JSON lines) rather than to stdout.");
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(opts).run(), vm);
+    if (vm.count("help")) {
+      std::cout << opts << '\n'
+                << "processMiniBatch isn't benchmarked, as it needs a loaded index; the\n"
+                << "ClusterForest, FragmentLengthDistribution, EquivalenceClassBuilder and\n"
+                << "logAdd benchmarks cover the per-fragment work that it does.\n";
+      return 0;
+    }
+    po::notify(vm);
+  } catch (po::error& e) {
+    std::cerr << "Exception : [" << e.what() << "]. Exiting.\n";
+    std::exit(1);
+  }
+
+  std::ofstream outStream;
+  if (!outFile.empty()) { outStream.open(outFile); }
+  Reporter rep(outFile.empty() ? std::cout : outStream);
+
+  auto nullSink = std::make_shared<spdlog::sinks::null_sink_mt>();
+  auto benchLog = spdlog::create("benchLog", {nullSink});
+
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t t = 1; t < bopts.maxThreads; t *= 2) { threadCounts.push_back(t); }
+  threadCounts.push_back(bopts.maxThreads);
+
+  bool removeReads{false};
+  string readFile = bopts.readFile;
+  if (readFile.empty()) {
+    readFile = (bfs::temp_directory_path() / bfs::unique_path("salmon_bench_%%%%%%.fq")).string();
+    writeSyntheticReads(readFile, bopts);
+    removeReads = true;
+  }
+
+  SyntheticExperiment exp(bopts);
+  auto enabled = [&only](const string& name) -> bool {
+    return only.empty() or name.find(only) != string::npos;
+  };
+
+  for (auto nt : threadCounts) {
+    if (enabled("FragmentLengthDistribution")) { benchFragmentLengthDistribution(bopts, nt, rep); }
+    if (enabled("logAdd")) { benchLogAdd(bopts, nt, rep); }
+    if (enabled("EquivalenceClassBuilder")) { benchEquivalenceClassBuilder(bopts, exp, nt, rep); }
+    if (enabled("ClusterForest")) { benchClusterForest(bopts, exp, nt, rep); }
+    if (enabled("EffectiveLengths")) { benchEffectiveLengths(bopts, exp, nt, rep); }
+    if (enabled("updateEffectiveLengths(exact)")) { benchUpdateEffectiveLengths(bopts, false, nt, rep); }
+    if (enabled("updateEffectiveLengths(background)")) { benchUpdateEffectiveLengths(bopts, true, nt, rep); }
+    if (enabled("EMUpdate")) { benchBootstrap(bopts, exp, false, nt, rep); }
+    if (enabled("VBEMUpdate")) { benchBootstrap(bopts, exp, true, nt, rep); }
+    if (enabled("sampleRound")) { benchGibbsRound(bopts, exp, nt, rep); }
+    if (enabled("FastxParser")) { benchFastxParser(readFile, nt, rep); }
+  }
+
+  if (removeReads) { bfs::remove(readFile); }
+  return 0;
+}
@@ -102,12 +102,15 @@ extern "C" {
 #include "ReadLibrary.hpp"
 #include "SalmonConfig.hpp"
 #include "SalmonIndex.hpp"
+#include "NumaTopology.hpp"
 #include "SalmonMath.hpp"
 #include "SalmonUtils.hpp"
+#include "SampleSheet.hpp"
 #include "Transcript.hpp"
 
 #include "AlignmentGroup.hpp"
 #include "BWAUtils.hpp"
+#include "BiasBackground.hpp"
 #include "BiasParams.hpp"
 #include "CollapsedEMOptimizer.hpp"
 #include "CollapsedGibbsSampler.hpp"
@@ -123,6 +126,10 @@ extern "C" {
 #include "SACollector.hpp"
 #include "SASearcher.hpp"
 #include "SalmonOpts.hpp"
+#include "SalmonRandom.hpp"
+#include "EarlyStopMonitor.hpp"
+#include "StreamingMonitor.hpp"
+#include "TaskScheduler.hpp"
 #include "PairAlignmentFormatter.hpp"
 #include "SingleAlignmentFormatter.hpp"
 #include "RapMapUtils.hpp"
@@ -172,7 +179,7 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
                       FragmentLengthDistribution& fragLengthDist,
                       BiasParams& observedBiasParams,
                       std::atomic<uint64_t>& numAssignedFragments,
-                      std::default_random_engine& randEng, bool initialRound,
+                      salmon::rng::RNG& randEng, bool initialRound,
                       std::atomic<bool>& burnedIn, double& maxZeroFrac) {
 
   using salmon::math::LOG_0;
@@ -186,6 +193,11 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
   auto log = spdlog::get("jointLog");
   size_t numTranscripts{transcripts.size()};
   size_t localNumAssignedFragments{0};
+
+  // Time spent in this update (and, within it, on the equivalence classes)
+  PhaseTelemetry::ThreadCounters phaseTimes(salmonOpts.telemetry.get());
+  auto updateStart = PhaseTelemetry::Clock::now();
+  uint64_t eqClassNanos{0};
   size_t priorNumAssignedFragments{numAssignedFragments};
   std::uniform_real_distribution<> uni(
       0.0, 1.0 + std::numeric_limits<double>::min());
@@ -204,6 +216,20 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
 
   bool posBiasCorrect = salmonOpts.posBiasCorrect;
   bool gcBiasCorrect = salmonOpts.gcBiasCorrect;
+
+  // How each of the auxiliary models is updated in this mini-batch; the
+  // sampled models are all updated by the same (random) fragments.
+  auto& auxModels = *salmonOpts.auxModels;
+  auto fldUpdate = auxModels.mode(AuxModel::FRAG_LENGTH);
+  auto posBiasUpdate = auxModels.mode(AuxModel::POS_BIAS);
+  auto gcBiasUpdate = auxModels.mode(AuxModel::GC_BIAS);
+  bool anyAuxSampled = (fldUpdate == AuxModelUpdate::SAMPLED or
+                        posBiasUpdate == AuxModelUpdate::SAMPLED or
+                        gcBiasUpdate == AuxModelUpdate::SAMPLED);
+  double fldLogWeight = auxModels.logWeight(fldUpdate);
+  double posBiasLogWeight = auxModels.logWeight(posBiasUpdate);
+  double gcBiasLogWeight = auxModels.logWeight(gcBiasUpdate);
+
   bool updateCounts = initialRound;
   double incompatPrior = salmonOpts.incompatPrior;
   bool useReadCompat = incompatPrior != salmon::math::LOG_1;
@@ -247,6 +273,14 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
         continue;
       }
 
+      bool auxSampled =
+          anyAuxSampled and randEng.uniform01() < auxModels.sampleRate();
+      bool updatePosBias =
+          posBiasCorrect and AuxModelTracker::shouldUpdate(posBiasUpdate, auxSampled);
+      bool updateGCBias =
+          gcBiasCorrect and AuxModelTracker::shouldUpdate(gcBiasUpdate, auxSampled);
+      bool updateFragLengthDist = AuxModelTracker::shouldUpdate(fldUpdate, auxSampled);
+
       // We start out with probability 0
       double sumOfAlignProbs{LOG_0};
 
@@ -466,10 +500,9 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
 
       // EQCLASS
       double auxProbSum{0.0};
-      for (auto& p : auxProbs) {
-        p = std::exp(p - auxDenom);
-        auxProbSum += p;
-      }
+      for (auto& p : auxProbs) { p -= auxDenom; }
+      salmon::math::expInPlace(auxProbs.data(), auxProbs.size());
+      for (auto p : auxProbs) { auxProbSum += p; }
       
       auto eqSize = txpIDs.size();
       if (eqSize > 0) {
@@ -507,7 +540,9 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
         }
         
         TranscriptGroup tg(txpIDs);
+        auto eqStart = PhaseTelemetry::Clock::now();
         eqBuilder.addGroup(std::move(tg), auxProbs, posProbs);
+        eqClassNanos += PhaseTelemetry::nanosSince(eqStart);
       }
 
       // normalize the hits
@@ -546,7 +581,8 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
           }
         }
 
-        if (posBiasCorrect) {
+        if (updatePosBias) {
+          double posBiasMass = aln.logProb + posBiasLogWeight;
           auto lengthClassIndex = transcript.lengthClassIndex();
           switch (aln.mateStatus) {
           case rapmap::utils::MateStatus::PAIRED_END_PAIRED: {
@@ -561,9 +597,9 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
               posRC = posRC >= transcript.RefLength ? transcript.RefLength - 1
                                                     : posRC;
               observedPosBiasFwd[lengthClassIndex].addMass(
-                  posFW, transcript.RefLength, aln.logProb);
+                  posFW, transcript.RefLength, posBiasMass);
               observedPosBiasRC[lengthClassIndex].addMass(
-                  posRC, transcript.RefLength, aln.logProb);
+                  posRC, transcript.RefLength, posBiasMass);
             }
           } break;
           case rapmap::utils::MateStatus::PAIRED_END_LEFT:
@@ -574,10 +610,10 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
             pos = pos >= transcript.RefLength ? transcript.RefLength - 1 : pos;
             if (aln.fwd) {
               observedPosBiasFwd[lengthClassIndex].addMass(
-                  pos, transcript.RefLength, aln.logProb);
+                  pos, transcript.RefLength, posBiasMass);
             } else {
               observedPosBiasRC[lengthClassIndex].addMass(
-                  pos, transcript.RefLength, aln.logProb);
+                  pos, transcript.RefLength, posBiasMass);
             }
           } break;
           default:
@@ -585,14 +621,14 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
           }
         }
 
-        if (gcBiasCorrect and aln.libFormat().type == ReadType::PAIRED_END) {
+        if (updateGCBias and aln.libFormat().type == ReadType::PAIRED_END) {
           int32_t start = std::min(aln.pos, aln.matePos);
           int32_t stop = start + aln.fragLen - 1;
 
           // WITH CONTEXT
           if (start >= 0 and stop < transcript.RefLength) {
               auto desc = transcript.gcDesc(start, stop);
-              observedGCMass.inc(desc, aln.logProb);
+              observedGCMass.inc(desc, aln.logProb + gcBiasLogWeight);
             /*
             int32_t gcFrac = transcript.gcFrac(start, stop);
             // Add this fragment's contribution
@@ -606,8 +642,8 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
             
             //Old fragment length calc: double fragLength = aln.fragLength();
             auto fragLength = aln.fragLengthPedantic(transcript.RefLength);
-            if (fragLength > 0) {
-                fragLengthDist.addVal(fragLength, logForgettingMass);
+            if (updateFragLengthDist and fragLength > 0) {
+                fragLengthDist.addVal(fragLength, logForgettingMass + fldLogWeight);
             }
 
           if (useFSPD) {
@@ -642,18 +678,35 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
       maxZeroFrac = std::max(maxZeroFrac, static_cast<double>(100.0 * zeroProbFrags) / batchReads);
   }
 
+  phaseTimes.add(TelemetryPhase::EQCLASS_INSERTION, eqClassNanos);
+  phaseTimes.add(TelemetryPhase::ONLINE_UPDATE, PhaseTelemetry::nanosSince(updateStart));
+
   numAssignedFragments += localNumAssignedFragments;
+  salmon::utils::trackAuxModels(salmonOpts, observedBiasParams, fragLengthDist,
+                                localNumAssignedFragments, numAssignedFragments,
+                                burnedIn);
   if (numAssignedFragments >= numBurninFrags and !burnedIn) {
-    if (useFSPD) {
-      // update all of the fragment start position
-      // distributions
-      for (auto& fspd : fragStartDists) {
-        fspd.update();
-      }
-    }
-    // NOTE: only one thread should succeed here, and that
-    // thread will set burnedIn to true.
-    readExp.updateTranscriptLengthsAtomic(burnedIn);
+    // NOTE: only one thread should succeed here.  The effective
+    // lengths are computed in the background, on the shared pool, and
+    // burnedIn is set to true once they are ready.  Before that, the same
+    // job updates the fragment start position distributions, and after
+    // it, computes the bias background from the online estimates; the
+    // other threads (which keep arriving here until burnedIn is set) do
+    // neither.
+    readExp.updateTranscriptLengthsAtomic(
+        burnedIn, salmonOpts.scheduler,
+        [useFSPD, &fragStartDists]() -> void {
+          if (useFSPD) {
+            // update all of the fragment start position
+            // distributions
+            for (auto& fspd : fragStartDists) {
+              fspd.update();
+            }
+          }
+        },
+        [&salmonOpts, &readExp]() -> void {
+          salmon::utils::precomputeBiasBackground(salmonOpts, readExp);
+        });
   }
   if (initialRound) {
     readLib.updateLibTypeCounts(libTypeCounts);
@@ -663,6 +716,62 @@ void processMiniBatch(ReadExperiment& readExp, ForgettingMassCalculator& fmCalc,
 
 /// START QUASI
 
+/**
+ * Amends the hits of a read against the base index with those against the
+ * index of transcripts added after it was built (see `salmon index
+ * --addTranscripts`), and drops hits to transcripts that were removed from
+ * it.  If the index has neither, this is inactive and does nothing.
+ */
+template <typename RapMapIndexT> class IndexUpdateHits {
+public:
+  explicit IndexUpdateHits(SalmonIndex* sidx) : sidx_(sidx) {
+    auto* deltaIdx = sidx->deltaQuasiIndex<RapMapIndexT>();
+    if (deltaIdx != nullptr) {
+      deltaCollector_.reset(new SACollector<RapMapIndexT>(deltaIdx));
+      deltaSearcher_.reset(new SASearcher<RapMapIndexT>(deltaIdx));
+      deltaOffset_ = sidx->deltaTranscriptOffset();
+    }
+    active_ = (deltaIdx != nullptr) or sidx->hasMaskedTranscripts();
+  }
+
+  bool active() const { return active_; }
+
+  /**
+   * Update `hits` (the hits of `read` against the base index, in
+   * transcript order) and return true if any hits remain.
+   */
+  bool update(std::string& read, std::vector<QuasiAlignment>& hits,
+              MateStatus mateStatus, bool consistentHits) {
+    if (deltaCollector_) {
+      deltaHits_.clear();
+      (*deltaCollector_)(read, deltaHits_, *deltaSearcher_, mateStatus, true,
+                         consistentHits);
+      // The added transcripts all follow those of the base index, so
+      // the hits remain in transcript order.
+      for (auto& h : deltaHits_) {
+        h.tid += deltaOffset_;
+        hits.push_back(h);
+      }
+    }
+    if (sidx_->hasMaskedTranscripts()) {
+      hits.erase(std::remove_if(hits.begin(), hits.end(),
+                                [this](const QuasiAlignment& h) -> bool {
+                                  return sidx_->isMasked(h.tid);
+                                }),
+                 hits.end());
+    }
+    return !hits.empty();
+  }
+
+private:
+  SalmonIndex* sidx_;
+  bool active_{false};
+  uint32_t deltaOffset_{0};
+  std::unique_ptr<SACollector<RapMapIndexT>> deltaCollector_{nullptr};
+  std::unique_ptr<SASearcher<RapMapIndexT>> deltaSearcher_{nullptr};
+  std::vector<QuasiAlignment> deltaHits_;
+};
+
 // To use the parser in the following, we get "jobs" until none is
 // available. A job behaves like a pointer to the type
 // jellyfish::sequence_list (see whole_sequence_parser.hpp).
@@ -678,7 +787,7 @@ void processReadsQuasi(
     FragmentLengthDistribution& fragLengthDist, BiasParams& observedBiasParams,
     mem_opt_t* memOptions, SalmonOpts& salmonOpts, double coverageThresh,
     std::mutex& iomutex, bool initialRound, std::atomic<bool>& burnedIn,
-    volatile bool& writeToCache) {
+    volatile bool& writeToCache, uint32_t threadIdx) {
 
   // ERROR
   salmonOpts.jointLog->error("MEM-mapping cannot be used with the Quasi index "
@@ -698,7 +807,7 @@ void processReadsQuasi(
     FragmentLengthDistribution& fragLengthDist, BiasParams& observedBiasParams,
     mem_opt_t* memOptions, SalmonOpts& salmonOpts, double coverageThresh,
     std::mutex& iomutex, bool initialRound, std::atomic<bool>& burnedIn,
-    volatile bool& writeToCache) {
+    volatile bool& writeToCache, uint32_t threadIdx) {
   // ERROR
   salmonOpts.jointLog->error("MEM-mapping cannot be used with the Quasi index "
                              "--- please report this bug on GitHub");
@@ -717,13 +826,13 @@ void processReadsQuasi(
     FragmentLengthDistribution& fragLengthDist, BiasParams& observedBiasParams,
     mem_opt_t* memOptions, SalmonOpts& salmonOpts, double coverageThresh,
     std::mutex& iomutex, bool initialRound, std::atomic<bool>& burnedIn,
-    volatile bool& writeToCache) {
-  uint64_t count_fwd = 0, count_bwd = 0;
-  // Seed with a real random value, if available
-  std::random_device rd;
+    volatile bool& writeToCache, uint32_t threadIdx) {
+  // Run on (and so allocate from) this worker's NUMA node, if asked
+  if (salmonOpts.numa) { salmonOpts.numa->pinWorker(threadIdx, salmonOpts.numThreads); }
 
-  // Create a random uniform distribution
-  std::default_random_engine eng(rd());
+  uint64_t count_fwd = 0, count_bwd = 0;
+  // This thread's stream of random numbers
+  auto eng = salmon::rng::stream(salmonOpts.rngSeed, salmon::rng::Phase::ONLINE, threadIdx);
 
   uint64_t prevObservedFrags{1};
   uint64_t leftHitCount{0};
@@ -733,8 +842,8 @@ void processReadsQuasi(
 
   // Write unmapped reads
   fmt::MemoryWriter unmappedNames;
-  auto unmappedLogger = spdlog::get("unmappedLog");
-  bool writeUnmapped = (unmappedLogger.get() == nullptr) ? false : true;
+  auto* unmappedWriter = salmonOpts.unmappedWriter.get();
+  bool writeUnmapped = (unmappedWriter != nullptr);
 
   auto& readBiasFW =
       observedBiasParams
@@ -765,6 +874,7 @@ void processReadsQuasi(
   size_t readLenRight{0};
   SACollector<RapMapIndexT> hitCollector(qidx);
   SASearcher<RapMapIndexT> saSearcher(qidx);
+  IndexUpdateHits<RapMapIndexT> updateHits(readExp.getIndex());
   std::vector<QuasiAlignment> leftHits;
   std::vector<QuasiAlignment> rightHits;
   rapmap::utils::HitCounters hctr;
@@ -773,11 +883,20 @@ void processReadsQuasi(
   
   PairAlignmentFormatter<RapMapIndexT*> formatter(qidx);
   fmt::MemoryWriter sstream;
-  auto* qmLog = salmonOpts.qmLog.get();
-  bool writeQuasimappings = (qmLog != nullptr);
+  auto* qmWriter = salmonOpts.qmWriter.get();
+  bool writeQuasimappings = (qmWriter != nullptr);
+  // Output is accumulated in this thread's buffers, and handed off
+  // to the writer once it reaches this size.
+  constexpr size_t outputChunkSize{1 << 20};
+
+  // Time spent waiting on the parser, and mapping
+  PhaseTelemetry::ThreadCounters phaseTimes(salmonOpts.telemetry.get());
+  auto phaseStart = PhaseTelemetry::Clock::now();
 
   auto rg = parser->getReadGroup();
   while (parser->refill(rg)) {
+      phaseTimes.add(TelemetryPhase::PARSE_WAIT, PhaseTelemetry::nanosSince(phaseStart));
+      phaseStart = PhaseTelemetry::Clock::now();
       rangeSize = rg.size();
 
     if (rangeSize > structureVec.size()) {
@@ -813,6 +932,17 @@ void processReadsQuasi(
                                    MateStatus::PAIRED_END_RIGHT, true,
                                    consistentHits);
 
+      if (updateHits.active()) {
+        if (!tooShortLeft) {
+          lh = updateHits.update(rp.first.seq, leftHits,
+                                 MateStatus::PAIRED_END_LEFT, consistentHits);
+        }
+        if (!tooShortRight) {
+          rh = updateHits.update(rp.second.seq, rightHits,
+                                 MateStatus::PAIRED_END_RIGHT, consistentHits);
+        }
+      }
+
       // Consider a read as too short if both ends are too short
       if (tooShortLeft and tooShortRight) {
         ++shortFragStats.numTooShort;
@@ -893,7 +1023,9 @@ void processReadsQuasi(
           }
         }
 
-        bool needBiasSample = salmonOpts.biasCorrect;
+        bool needBiasSample =
+            salmonOpts.biasCorrect and
+            salmonOpts.auxModels->shouldUpdate(AuxModel::SEQ_BIAS, eng);
 
         std::uniform_int_distribution<> dis(0, jointHits.size());
         // Randomly select a hit from which to draw the bias sample.
@@ -1045,25 +1177,17 @@ void processReadsQuasi(
 
     } // end for i < j->nb_filled
 
-    if (writeUnmapped) {
-        std::string outStr(unmappedNames.str());
-        // Get rid of last newline
-        if (!outStr.empty()) {
-            outStr.pop_back();
-            unmappedLogger->info(std::move(outStr));
-        }
+    if (writeUnmapped and unmappedNames.size() >= outputChunkSize) {
+        unmappedWriter->write(unmappedNames.str());
         unmappedNames.clear();
     }
-	    
-    if (writeQuasimappings) {
-        std::string outStr(sstream.str());
-        // Get rid of last newline
-        if (!outStr.empty()) {
-            outStr.pop_back();
-            qmLog->info(std::move(outStr));
-        }
+
+    if (writeQuasimappings and sstream.size() >= outputChunkSize) {
+        qmWriter->write(sstream.str());
         sstream.clear();
-    } 
+    }
+
+    phaseTimes.add(TelemetryPhase::MAPPING, PhaseTelemetry::nanosSince(phaseStart));
 
     prevObservedFrags = numObservedFragments;
     AlnGroupVecRange<QuasiAlignment> hitLists = boost::make_iterator_range(
@@ -1072,7 +1196,21 @@ void processReadsQuasi(
         readExp, fmCalc, firstTimestepOfRound, rl, salmonOpts, hitLists,
         transcripts, clusterForest, fragLengthDist, observedBiasParams,
         numAssignedFragments, eng, initialRound, burnedIn, maxZeroFrac);
+    // Stop reading if the estimates have converged (we still process
+    // the reads that have already been parsed)
+    if (salmonOpts.earlyStop and
+        salmonOpts.earlyStop->check(numAssignedFragments, transcripts,
+                                    readExp.equivalenceClassBuilder(),
+                                    salmonOpts.jointLog.get())) {
+      parser->stop();
+    }
+    phaseStart = PhaseTelemetry::Clock::now();
   }
+  phaseTimes.add(TelemetryPhase::PARSE_WAIT, PhaseTelemetry::nanosSince(phaseStart));
+
+  // Hand off whatever output remains in this thread's buffers
+  if (writeUnmapped) { unmappedWriter->write(unmappedNames.str()); }
+  if (writeQuasimappings) { qmWriter->write(sstream.str()); }
 
   if (maxZeroFrac > 0.0) {
       salmonOpts.jointLog->info("Thread saw mini-batch with a maximum of {0:.2f}\% zero probability fragments", 
@@ -1099,13 +1237,13 @@ void processReadsQuasi(
     FragmentLengthDistribution& fragLengthDist, BiasParams& observedBiasParams,
     mem_opt_t* memOptions, SalmonOpts& salmonOpts, double coverageThresh,
     std::mutex& iomutex, bool initialRound, std::atomic<bool>& burnedIn,
-    volatile bool& writeToCache) {
-  uint64_t count_fwd = 0, count_bwd = 0;
-  // Seed with a real random value, if available
-  std::random_device rd;
+    volatile bool& writeToCache, uint32_t threadIdx) {
+  // Run on (and so allocate from) this worker's NUMA node, if asked
+  if (salmonOpts.numa) { salmonOpts.numa->pinWorker(threadIdx, salmonOpts.numThreads); }
 
-  // Create a random uniform distribution
-  std::default_random_engine eng(rd());
+  uint64_t count_fwd = 0, count_bwd = 0;
+  // This thread's stream of random numbers
+  auto eng = salmon::rng::stream(salmonOpts.rngSeed, salmon::rng::Phase::ONLINE, threadIdx);
 
   uint64_t prevObservedFrags{1};
   uint64_t leftHitCount{0};
@@ -1116,8 +1254,8 @@ void processReadsQuasi(
 
   // Write unmapped reads
   fmt::MemoryWriter unmappedNames;
-  auto unmappedLogger = spdlog::get("unmappedLog");
-  bool writeUnmapped = (unmappedLogger.get() == nullptr) ? false : true;
+  auto* unmappedWriter = salmonOpts.unmappedWriter.get();
+  bool writeUnmapped = (unmappedWriter != nullptr);
 
   auto& readBiasFW = observedBiasParams.seqBiasModelFW;
   auto& readBiasRC = observedBiasParams.seqBiasModelRC;
@@ -1142,15 +1280,25 @@ void processReadsQuasi(
 
   SACollector<RapMapIndexT> hitCollector(qidx);
   SASearcher<RapMapIndexT> saSearcher(qidx);
+  IndexUpdateHits<RapMapIndexT> updateHits(readExp.getIndex());
   rapmap::utils::HitCounters hctr;
   
   SingleAlignmentFormatter<RapMapIndexT*> formatter(qidx);
   fmt::MemoryWriter sstream;
-  auto* qmLog = salmonOpts.qmLog.get();
-  bool writeQuasimappings = (qmLog != nullptr);
+  auto* qmWriter = salmonOpts.qmWriter.get();
+  bool writeQuasimappings = (qmWriter != nullptr);
+  // Output is accumulated in this thread's buffers, and handed off
+  // to the writer once it reaches this size.
+  constexpr size_t outputChunkSize{1 << 20};
+
+  // Time spent waiting on the parser, and mapping
+  PhaseTelemetry::ThreadCounters phaseTimes(salmonOpts.telemetry.get());
+  auto phaseStart = PhaseTelemetry::Clock::now();
 
- auto rg = parser->getReadGroup();
+  auto rg = parser->getReadGroup();
   while (parser->refill(rg)) {
+      phaseTimes.add(TelemetryPhase::PARSE_WAIT, PhaseTelemetry::nanosSince(phaseStart));
+      phaseStart = PhaseTelemetry::Clock::now();
       rangeSize = rg.size();
     if (rangeSize > structureVec.size()) {
       salmonOpts.jointLog->error("rangeSize = {}, but structureVec.size() = {} "
@@ -1175,6 +1323,10 @@ void processReadsQuasi(
           : hitCollector(rp.seq,
                                   jointHits, saSearcher,
                                   MateStatus::SINGLE_END, true, consistentHits);
+      if (updateHits.active() and !tooShort) {
+        lh = updateHits.update(rp.seq, jointHits, MateStatus::SINGLE_END,
+                               consistentHits);
+      }
 
       // If the fragment was too short, record it
       if (tooShort) {
@@ -1191,7 +1343,9 @@ void processReadsQuasi(
         jointHitGroup.clearAlignments();
       }
 
-      bool needBiasSample = salmonOpts.biasCorrect;
+      bool needBiasSample =
+          salmonOpts.biasCorrect and
+          salmonOpts.auxModels->shouldUpdate(AuxModel::SEQ_BIAS, eng);
 
       for (auto& h : jointHits) {
 
@@ -1278,26 +1432,18 @@ void processReadsQuasi(
 
     } // end for i < j->nb_filled
 
-    if (writeUnmapped) {
-        std::string outStr(unmappedNames.str());
-        // Get rid of last newline
-        if (!outStr.empty()) {
-            outStr.pop_back();
-            unmappedLogger->info(std::move(outStr));
-        }
+    if (writeUnmapped and unmappedNames.size() >= outputChunkSize) {
+        unmappedWriter->write(unmappedNames.str());
         unmappedNames.clear();
     }
 
-    if (writeQuasimappings) {
-        std::string outStr(sstream.str());
-        // Get rid of last newline
-        if (!outStr.empty()) {
-            outStr.pop_back();
-            qmLog->info(std::move(outStr));
-        }
+    if (writeQuasimappings and sstream.size() >= outputChunkSize) {
+        qmWriter->write(sstream.str());
         sstream.clear();
-    } 
+    }
     
+    phaseTimes.add(TelemetryPhase::MAPPING, PhaseTelemetry::nanosSince(phaseStart));
+
     prevObservedFrags = numObservedFragments;
     AlnGroupVecRange<QuasiAlignment> hitLists = boost::make_iterator_range(
         structureVec.begin(), structureVec.begin() + rangeSize);
@@ -1305,7 +1451,22 @@ void processReadsQuasi(
         readExp, fmCalc, firstTimestepOfRound, rl, salmonOpts, hitLists,
         transcripts, clusterForest, fragLengthDist, observedBiasParams,
         numAssignedFragments, eng, initialRound, burnedIn, maxZeroFrac);
+    // Stop reading if the estimates have converged (we still process
+    // the reads that have already been parsed)
+    if (salmonOpts.earlyStop and
+        salmonOpts.earlyStop->check(numAssignedFragments, transcripts,
+                                    readExp.equivalenceClassBuilder(),
+                                    salmonOpts.jointLog.get())) {
+      parser->stop();
+    }
+    phaseStart = PhaseTelemetry::Clock::now();
   }
+  phaseTimes.add(TelemetryPhase::PARSE_WAIT, PhaseTelemetry::nanosSince(phaseStart));
+
+  // Hand off whatever output remains in this thread's buffers
+  if (writeUnmapped) { unmappedWriter->write(unmappedNames.str()); }
+  if (writeQuasimappings) { qmWriter->write(sstream.str()); }
+
   readExp.updateShortFrags(shortFragStats);
 
   if (maxZeroFrac > 0.0) {
@@ -1362,6 +1523,10 @@ void processReadLibrary(
     // HACK!
     if (rl.mates1().size() > 1 and numThreads > 8) { numParsingThreads = 2; }
     pairedParserPtr.reset(new paired_parser(rl.mates1(), rl.mates2(), numThreads, numParsingThreads, miniBatchSize));
+    // If an earlier library was enough, don't read this one at all
+    if (salmonOpts.earlyStop and salmonOpts.earlyStop->stopped()) {
+      pairedParserPtr->stop();
+    }
     pairedParserPtr->start();
     
     switch (indexType) {
@@ -1375,7 +1540,7 @@ void processReadLibrary(
               numObservedFragments, numAssignedFragments, numValidHits,
               upperBoundHits, sidx, transcripts, fmCalc, clusterForest,
               fragLengthDist, observedBiasParams[i], memOptions, salmonOpts,
-              coverageThresh, iomutex, initialRound, burnedIn, writeToCache);
+              coverageThresh, iomutex, initialRound, burnedIn, writeToCache, i);
         };
         threads.emplace_back(threadFun);
       }
@@ -1399,7 +1564,7 @@ void processReadLibrary(
                   upperBoundHits, sidx->quasiIndexPerfectHash64(), transcripts,
                   fmCalc, clusterForest, fragLengthDist, observedBiasParams[i],
                   memOptions, salmonOpts, coverageThresh, iomutex, initialRound,
-                  burnedIn, writeToCache);
+                  burnedIn, writeToCache, i);
             };
             threads.emplace_back(threadFun);
           } else { // Dense Hash
@@ -1413,7 +1578,7 @@ void processReadLibrary(
                   upperBoundHits, sidx->quasiIndex64(), transcripts, fmCalc,
                   clusterForest, fragLengthDist, observedBiasParams[i],
                   memOptions, salmonOpts, coverageThresh, iomutex, initialRound,
-                  burnedIn, writeToCache);
+                  burnedIn, writeToCache, i);
             };
             threads.emplace_back(threadFun);
           }
@@ -1429,7 +1594,7 @@ void processReadLibrary(
                   upperBoundHits, sidx->quasiIndexPerfectHash32(), transcripts,
                   fmCalc, clusterForest, fragLengthDist, observedBiasParams[i],
                   memOptions, salmonOpts, coverageThresh, iomutex, initialRound,
-                  burnedIn, writeToCache);
+                  burnedIn, writeToCache, i);
             };
             threads.emplace_back(threadFun);
           } else { // Dense Hash
@@ -1443,7 +1608,7 @@ void processReadLibrary(
                   upperBoundHits, sidx->quasiIndex32(), transcripts, fmCalc,
                   clusterForest, fragLengthDist, observedBiasParams[i],
                   memOptions, salmonOpts, coverageThresh, iomutex, initialRound,
-                  burnedIn, writeToCache);
+                  burnedIn, writeToCache, i);
             };
             threads.emplace_back(threadFun);
           }
@@ -1458,6 +1623,11 @@ void processReadLibrary(
     for (int i = 0; i < numThreads; ++i) {
       threads[i].join();
     }
+    if (salmonOpts.earlyStop) {
+      std::vector<std::string> files(rl.mates1());
+      files.insert(files.end(), rl.mates2().begin(), rl.mates2().end());
+      salmonOpts.earlyStop->addInput(files, pairedParserPtr->bytesConsumed());
+    }
 
     /** GC-fragment bias **/
     // Set the global distribution based on the sum of local
@@ -1529,6 +1699,9 @@ void processReadLibrary(
     // HACK!
     if (rl.unmated().size() > 1 and numThreads > 8) { numParsingThreads = 2; }
     singleParserPtr.reset(new single_parser(rl.unmated(), numThreads, numParsingThreads, miniBatchSize));
+    if (salmonOpts.earlyStop and salmonOpts.earlyStop->stopped()) {
+      singleParserPtr->stop();
+    }
     singleParserPtr->start();
     switch (indexType) {
     case SalmonIndexType::FMD: {
@@ -1541,7 +1714,7 @@ void processReadLibrary(
               numObservedFragments, numAssignedFragments, numValidHits,
               upperBoundHits, sidx, transcripts, fmCalc, clusterForest,
               fragLengthDist, observedBiasParams[i], memOptions, salmonOpts,
-              coverageThresh, iomutex, initialRound, burnedIn, writeToCache);
+              coverageThresh, iomutex, initialRound, burnedIn, writeToCache, i);
         };
         threads.emplace_back(threadFun);
       }
@@ -1567,7 +1740,7 @@ void processReadLibrary(
                   upperBoundHits, sidx->quasiIndexPerfectHash64(), transcripts,
                   fmCalc, clusterForest, fragLengthDist, observedBiasParams[i],
                   memOptions, salmonOpts, coverageThresh, iomutex, initialRound,
-                  burnedIn, writeToCache);
+                  burnedIn, writeToCache, i);
             };
             threads.emplace_back(threadFun);
           } else { // Dense Hash
@@ -1582,7 +1755,7 @@ void processReadLibrary(
                   upperBoundHits, sidx->quasiIndex64(), transcripts, fmCalc,
                   clusterForest, fragLengthDist, observedBiasParams[i],
                   memOptions, salmonOpts, coverageThresh, iomutex, initialRound,
-                  burnedIn, writeToCache);
+                  burnedIn, writeToCache, i);
             };
             threads.emplace_back(threadFun);
           }
@@ -1599,7 +1772,7 @@ void processReadLibrary(
                   upperBoundHits, sidx->quasiIndexPerfectHash32(), transcripts,
                   fmCalc, clusterForest, fragLengthDist, observedBiasParams[i],
                   memOptions, salmonOpts, coverageThresh, iomutex, initialRound,
-                  burnedIn, writeToCache);
+                  burnedIn, writeToCache, i);
             };
             threads.emplace_back(threadFun);
           } else { // Dense Hash
@@ -1614,7 +1787,7 @@ void processReadLibrary(
                   upperBoundHits, sidx->quasiIndex32(), transcripts, fmCalc,
                   clusterForest, fragLengthDist, observedBiasParams[i],
                   memOptions, salmonOpts, coverageThresh, iomutex, initialRound,
-                  burnedIn, writeToCache);
+                  burnedIn, writeToCache, i);
             };
             threads.emplace_back(threadFun);
           }
@@ -1628,6 +1801,9 @@ void processReadLibrary(
     for (int i = 0; i < numThreads; ++i) {
       threads[i].join();
     }
+    if (salmonOpts.earlyStop) {
+      salmonOpts.earlyStop->addInput(rl.unmated(), singleParserPtr->bytesConsumed());
+    }
 
     // Set the global distribution based on the sum of local
     // distributions.
@@ -1727,6 +1903,11 @@ void quantifyLibrary(ReadExperiment& experiment, bool greedyChain,
   // EQCLASS
   bool terminate{false};
 
+  if (salmonOpts.earlyStopTolerance > 0.0) {
+    salmonOpts.earlyStop = std::make_shared<EarlyStopMonitor>(
+        salmonOpts.earlyStopTolerance, salmonOpts.numBurninFrags);
+  }
+
   while (numObservedFragments < numRequiredFragments and !terminate) {
     prevNumObservedFragments = numObservedFragments;
     if (!initialRound) {
@@ -1790,11 +1971,18 @@ void quantifyLibrary(ReadExperiment& experiment, bool greedyChain,
     if (!salmonOpts.quiet) {
       fmt::print(stderr, "\n\n\n\n");
     }
+    StreamingMonitor streamingMonitor(refs, experiment.equivalenceClassBuilder(),
+                                      salmonOpts, totalAssignedFragments);
+    streamingMonitor.start();
     experiment.processReads(numQuantThreads, salmonOpts,
                             processReadLibraryCallback);
+    streamingMonitor.stop();
     experiment.setNumObservedFragments(numObservedFragments);
 
     // EQCLASS
+    if (salmonOpts.minEqClassCount > 1) {
+      experiment.equivalenceClassBuilder().pruneBelow(salmonOpts.minEqClassCount);
+    }
     bool done = experiment.equivalenceClassBuilder().finish();
     // skip the extra online rounds
     terminate = true;
@@ -1903,7 +2091,14 @@ void quantifyLibrary(ReadExperiment& experiment, bool greedyChain,
   jointLog->info("finished quantifyLibrary()");
 }
 
-int salmonQuantify(int argc, char* argv[]) {
+/**
+ * Quantify a single sample described by the command line `argv`.  If
+ * `sharedIndex` already holds a loaded index, it is used rather than
+ * re-loading the index; otherwise, upon return, it holds the index that
+ * was loaded for this sample.
+ */
+int quantifySample(int argc, char* argv[],
+                   std::shared_ptr<SalmonIndex>& sharedIndex) {
   using std::cerr;
   using std::vector;
   using std::string;
@@ -1920,6 +2115,7 @@ int salmonQuantify(int argc, char* argv[]) {
   sopt.numThreads = std::thread::hardware_concurrency();
 
   double coverageThresh;
+  string sampleSheet;
   vector<string> unmatedReadFiles;
   vector<string> mate1ReadFiles;
   vector<string> mate2ReadFiles;
@@ -1946,6 +2142,15 @@ int salmonQuantify(int argc, char* argv[]) {
 
       "output,o", po::value<std::string>()->required(),
       "Output quantification file.")
+    (
+      "sampleSheet", po::value<string>(&sampleSheet),
+      "Quantify every sample listed in this file, loading the index only "
+      "once.  Each (whitespace-separated) line has the form "
+      "<name> <libType> <reads> for single-end samples or "
+      "<name> <libType> <mates1> <mates2> for paired-end samples, where "
+      "multiple read files are separated by commas.  The results for each "
+      "sample are written to <output>/<name>.  When this option is given, "
+      "-l, -r, -1 and -2 must not be.")
     (
       "allowOrphans",
       po::bool_switch(&(sopt.allowOrphans))->default_value(false),
@@ -2053,6 +2258,13 @@ int salmonQuantify(int argc, char* argv[]) {
      "when evaluating sequence-specific & GC fragment bias.  Larger values speed up effective "
      "length correction, but may decrease the fidelity of bias modeling "
      "results.")
+    (
+     "exactBiasBackground",
+     po::bool_switch(&(sopt.exactBiasBackground))->default_value(false),
+     "Compute the expected bias background (for --seqBias, --gcBias and --posBias) "
+     "only from the offline abundance estimates.  By default, it is computed from "
+     "the online estimates while the reads are still being mapped, and then "
+     "updated for the transcripts whose abundance changed by more than 5%.")
     (
      "strictIntersect",
      po::bool_switch(&(sopt.strictIntersect))->default_value(false),
@@ -2097,6 +2309,11 @@ int salmonQuantify(int argc, char* argv[]) {
      po::value<uint32_t>(&(sopt.maxReadOccs))->default_value(100),
      "Reads \"mapping\" to more than this many places won't be "
      "considered.")
+    (
+     "fastMath", po::bool_switch(&(sopt.fastMath))->default_value(false),
+     "Use fast approximations of the log-space arithmetic (log, exp and "
+     "log-sum) performed while processing fragments, rather than the exact "
+     "versions.  The approximations have a relative error below 2e-4.")
     (
      "noEffectiveLengthCorrection",
      po::bool_switch(&(sopt.noEffectiveLengthCorrection))
@@ -2140,6 +2357,16 @@ int salmonQuantify(int argc, char* argv[]) {
      "bias, etc.).  After ther first <numAuxModelSamples> observations "
      "the auxiliary model parameters will be assumed to have converged "
      "and will be fixed.")
+    (
+     "auxModelTolerance",
+     po::value<double>(&(sopt.auxModelTolerance))->default_value(0.005),
+     "Each worker thread periodically checks how much each auxiliary "
+     "model (fragment length distribution, positional, GC and sequence "
+     "bias) has changed.  A model that repeatedly changes by less than this "
+     "(in total variation distance) is first updated from only a random "
+     "sample of the fragments, and later not at all.  The decisions are "
+     "recorded in aux/meta_info.json.  A value of 0 always updates every "
+     "model.")
     (
      "numPreAuxModelSamples",
      po::value<uint32_t>(&(sopt.numPreBurninFrags))
@@ -2166,6 +2393,65 @@ int salmonQuantify(int argc, char* argv[]) {
      po::value<uint32_t>(&(sopt.numBootstraps))->default_value(0),
      "Number of bootstrap samples to generate. Note: "
      "This is mutually exclusive with Gibbs sampling.")
+    (
+     "seed", po::value<uint64_t>(&(sopt.rngSeed)),
+     "The seed for all of the random choices made during quantification "
+     "(e.g. bootstrap and Gibbs samples).  For a given seed and number of "
+     "threads, the bootstrap and Gibbs samples are reproducible.  If this "
+     "isn't given, a random seed is chosen; either way, the seed is "
+     "recorded in aux/meta_info.json.")
+    (
+     "binaryOutput", po::bool_switch(&(sopt.binaryOutput))->default_value(false),
+     "In addition to the usual text output, write the abundances (quant.bin), "
+     "equivalence classes (if --dumpEq is given) and bootstrap / Gibbs samples "
+     "(if any) in salmon's binary columnar format.")
+    (
+     "telemetryInterval",
+     po::value<uint32_t>(&(sopt.telemetryInterval))->default_value(0),
+     "If this is > 0, then every this many seconds, append a snapshot of "
+     "the time spent in each phase of quantification (as a line of JSON) to "
+     "aux/telemetry.jsonl.  The totals are always recorded in "
+     "aux/meta_info.json.")
+    (
+     "streamSnapshotInterval",
+     po::value<uint32_t>(&(sopt.streamSnapshotInterval))->default_value(0),
+     "If this is > 0, then every this many seconds, write the current "
+     "(online) abundance estimates to interim/quant.sf in the output "
+     "directory.  This is useful when the reads are streamed in (e.g. "
+     "from a pipe) and the run may take a long time to finish.")
+    (
+     "earlyStopTolerance",
+     po::value<double>(&(sopt.earlyStopTolerance))->default_value(0.0),
+     "If this is > 0, then stop reading the input once the online "
+     "abundance estimates have converged: once, for 3 checks in a row "
+     "(made every million fragments after burn-in), the estimated "
+     "fraction of fragments from each transcript has changed by less "
+     "than this (in total variation distance) and fewer than this many "
+     "new equivalence classes have been found per fragment.  The "
+     "fraction of the input used and the estimated error are recorded "
+     "in aux/meta_info.json.")
+    (
+     "maxEqClasses",
+     po::value<uint64_t>(&(sopt.maxEqClasses))->default_value(0),
+     "If this is > 0, then keep at most (about) this many equivalence "
+     "classes in memory while processing the reads; when there are more, "
+     "the least-observed classes are merged into a class with one fewer "
+     "target (if one exists) or dropped, with their fragments. "
+     "0 means no limit.")
+    (
+     "maxEqClassMemory",
+     po::value<uint64_t>(&(sopt.maxEqClassMemory))->default_value(0),
+     "If this is > 0, then keep the (estimated) memory used by the "
+     "equivalence classes under this many MiB while processing the reads, "
+     "by merging or dropping the least-observed classes as with "
+     "--maxEqClasses.  0 means no limit.")
+    (
+     "minEqClassCount",
+     po::value<uint64_t>(&(sopt.minEqClassCount))->default_value(0),
+     "Before the offline phase, merge every equivalence class observed fewer "
+     "than this many times into a class with one fewer target (if one "
+     "exists), and drop it otherwise.  How much this changes is reported in "
+     "the log and in aux/meta_info.json.  0 (or 1) keeps every class.")
     (
      "quiet,q", po::bool_switch(&(sopt.quiet))->default_value(false),
      "Be quiet while doing quantification (don't write informative "
@@ -2183,7 +2469,15 @@ int salmonQuantify(int argc, char* argv[]) {
     (
      "writeUnmappedNames",
      po::bool_switch(&(sopt.writeUnmappedNames))->default_value(false),
-     "Write the names of un-mapped reads to the file unmapped_names.txt in the auxiliary directory.");
+     "Write the names of un-mapped reads to the file unmapped_names.txt in the auxiliary directory.")
+    (
+     "numa",
+     po::value<std::string>(&(sopt.numaPolicy))->default_value("none"),
+     "How to place the mapping threads and the index on a machine with several "
+     "NUMA nodes; one of \"none\", \"local\" (pin each worker thread to a node, so "
+     "that its buffers are allocated there) or \"interleave\" (do so, and also "
+     "spread the pages of the index evenly over all of the nodes).  This is "
+     "ignored on machines with a single node.");
 
 
   po::options_description fmd("\noptions that apply to the old FMD index");
@@ -2209,6 +2503,14 @@ int salmonQuantify(int argc, char* argv[]) {
      "typically slow down quantification by ~40%.  Consider enabling this "
      "option if you find the mapping rate to "
      "be significantly lower than expected.")
+    (
+     "smemInterleave",
+     po::value<uint32_t>(&(sopt.smemInterleave))->default_value(0),
+     "If > 0, find the SMEMs of each chunk of reads up-front, interleaving "
+     "the searches of this many reads and prefetching the parts of the "
+     "index that each will need next.  This hides much of the memory "
+     "latency of the search, and doesn't "
+     "change the results.  With 0, each read is searched on its own.")
     (
      "coverage,c", po::value<double>(&coverageThresh)->default_value(0.70),
      "required coverage of read by union of SMEMs to consider it a \"hit\".")
@@ -2328,6 +2630,12 @@ transcript abundance from RNA-seq reads
     if (!optionsOK) {
       std::exit(1);
     }
+    if (sopt.telemetryInterval > 0) {
+      bfs::path auxDir = sopt.outputDirectory / sopt.auxDir;
+      boost::filesystem::create_directories(auxDir);
+      sopt.telemetry->startProgressStream((auxDir / "telemetry.jsonl").string(),
+                                          sopt.telemetryInterval);
+    }
  
     auto fileLog = sopt.fileLog;
     auto jointLog = sopt.jointLog;
@@ -2342,6 +2650,13 @@ transcript abundance from RNA-seq reads
       sopt.numConditionalGCBins = 1;
     }
 
+    // Unless asked not to, start on the bias background while mapping
+    if ((sopt.biasCorrect or sopt.gcBiasCorrect or sopt.posBiasCorrect) and
+        !sopt.exactBiasBackground) {
+      sopt.biasBackground = std::make_shared<BiasBackground>(
+          sopt.numConditionalGCBins, sopt.numFragGCBins);
+    }
+
     jointLog->info("parsing read library format");
 
     vector<ReadLibrary> readLibraries =
@@ -2359,7 +2674,8 @@ transcript abundance from RNA-seq reads
     versionInfo.load(versionPath);
     auto idxType = versionInfo.indexType();
 
-    ReadExperiment experiment(readLibraries, indexDirectory, sopt);
+    ReadExperiment experiment(readLibraries, indexDirectory, sopt, sharedIndex);
+    sharedIndex = experiment.sharedIndex();
 
     // This will be the class in charge of maintaining our
     // rich equivalence classes
@@ -2383,6 +2699,13 @@ transcript abundance from RNA-seq reads
                                      coverageThresh, sopt.numThreads);
     } break;
     case SalmonIndexType::QUASI: {
+      // The SAM output is written against the base index alone
+      if (sopt.qmFileName != "" and experiment.getIndex()->hasDeltaIndex()) {
+        jointLog->error("--writeMappings is not supported with an index to "
+                        "which transcripts were added (with --addTranscripts); "
+                        "please re-build the index");
+        std::exit(1);
+      }
       // We can only do fragment GC bias correction, for the time being, with
       // paired-end reads
       if (sopt.gcBiasCorrect) {
@@ -2461,6 +2784,49 @@ transcript abundance from RNA-seq reads
     // Write meta-information about the run
     gzw.writeMeta(sopt, experiment, sopt.runStartTime);
 
+    // Now create a subdirectory for any parameters of interest
+    bfs::path paramsDir = outputDirectory / "libParams";
+    if (!boost::filesystem::exists(paramsDir)) {
+      if (!boost::filesystem::create_directories(paramsDir)) {
+        fmt::print(stderr, "{}ERROR{}: Could not create "
+                           "output directory for experimental parameter "
+                           "estimates [{}]. exiting.",
+                   ioutils::SET_RED, ioutils::RESET_COLOR, paramsDir);
+        std::exit(-1);
+      }
+    }
+
+    // None of the remaining outputs depend on the samples drawn below, so
+    // write them on the shared pool while the sampling runs
+    auto& scheduler = *sopt.scheduler;
+    scheduler.runInBackground([&]() -> void {
+      bfs::path libCountFilePath = outputDirectory / "lib_format_counts.json";
+      experiment.summarizeLibraryTypeCounts(libCountFilePath);
+
+      // Test writing out the fragment length distribution
+      if (!sopt.noFragLengthDist) {
+        bfs::path distFileName = paramsDir / "flenDist.txt";
+        {
+          std::unique_ptr<std::FILE, int (*)(std::FILE*)> distOut(
+              std::fopen(distFileName.c_str(), "w"), std::fclose);
+          fmt::print(distOut.get(), "{}\n",
+                     experiment.fragmentLengthDistribution()->toString());
+        }
+      }
+
+      /** If the user requested gene-level abundances, then compute those now **/
+      if (vm.count("geneMap")) {
+        try {
+          salmon::utils::generateGeneLevelEstimates(sopt.geneMapPath,
+                                                    outputDirectory);
+        } catch (std::invalid_argument& e) {
+          fmt::print(stderr, "Error: [{}] when trying to compute gene-level "
+                             "estimates. The gene-level file(s) may not exist",
+                     e.what());
+        }
+      }
+    });
+
     if (sopt.numGibbsSamples > 0) {
 
       jointLog->info("Starting Gibbs Sampler");
@@ -2474,6 +2840,7 @@ transcript abundance from RNA-seq reads
       bool sampleSuccess =
           sampler.sample(experiment, sopt, bsWriter, sopt.numGibbsSamples);
       if (!sampleSuccess) {
+        scheduler.waitForBackground();
         jointLog->error("Encountered error during Gibb sampling .\n"
                         "This should not happen.\n"
                         "Please file a bug report on GitHub.\n");
@@ -2492,6 +2859,7 @@ transcript abundance from RNA-seq reads
           optimizer.gatherBootstraps(experiment, sopt, bsWriter, 0.01, 10000);
       jointLog->info("Finished Bootstrapping");
       if (!bootstrapSuccess) {
+        scheduler.waitForBackground();
         jointLog->error("Encountered error during bootstrapping.\n"
                         "This should not happen.\n"
                         "Please file a bug report on GitHub.\n");
@@ -2499,57 +2867,33 @@ transcript abundance from RNA-seq reads
       }
     }
 
-    // Now create a subdirectory for any parameters of interest
-    bfs::path paramsDir = outputDirectory / "libParams";
-    if (!boost::filesystem::exists(paramsDir)) {
-      if (!boost::filesystem::create_directories(paramsDir)) {
-        fmt::print(stderr, "{}ERROR{}: Could not create "
-                           "output directory for experimental parameter "
-                           "estimates [{}]. exiting.",
-                   ioutils::SET_RED, ioutils::RESET_COLOR, paramsDir);
-        std::exit(-1);
-      }
-    }
-
-    bfs::path libCountFilePath = outputDirectory / "lib_format_counts.json";
-    experiment.summarizeLibraryTypeCounts(libCountFilePath);
-
-    // Test writing out the fragment length distribution
-    if (!sopt.noFragLengthDist) {
-      bfs::path distFileName = paramsDir / "flenDist.txt";
-      {
-        std::unique_ptr<std::FILE, int (*)(std::FILE*)> distOut(
-            std::fopen(distFileName.c_str(), "w"), std::fclose);
-        fmt::print(distOut.get(), "{}\n",
-                   experiment.fragmentLengthDistribution()->toString());
-      }
-    }
+    scheduler.waitForBackground();
 
-    /** If the user requested gene-level abundances, then compute those now **/
-    if (vm.count("geneMap")) {
-      try {
-        salmon::utils::generateGeneLevelEstimates(sopt.geneMapPath,
-                                                  outputDirectory);
-      } catch (std::invalid_argument& e) {
-        fmt::print(stderr, "Error: [{}] when trying to compute gene-level "
-                           "estimates. The gene-level file(s) may not exist",
-                   e.what());
-      }
-    }
+    // Now that sampling is done, the telemetry is complete
+    sopt.telemetry->stopProgressStream();
+    gzw.writeMetaInfo(sopt, experiment, sopt.runStartTime);
 
     if (sopt.writeUnmappedNames) {
-      auto l = spdlog::get("unmappedLog");
-      // If the logger was created, then flush it and
+      // If the writer was created, then drain it and
       // close the associated file.
-      if (l) {
-	l->flush();
-	if (sopt.unmappedFile) { sopt.unmappedFile->close(); }
+      if (sopt.unmappedWriter) {
+        sopt.unmappedWriter->close();
+        if (sopt.unmappedFile) { sopt.unmappedFile->close(); }
+        jointLog->info("Wrote {} bytes of unmapped names; mapping threads "
+                       "waited on the writer {} times",
+                       sopt.unmappedWriter->bytesWritten(),
+                       sopt.unmappedWriter->numStalls());
       }
     }
-    
+
     // if we wrote quasimappings, flush that buffer
     if (sopt.qmFileName != "" ){
         sopt.qmLog->flush();
+        sopt.qmWriter->close();
+        jointLog->info("Wrote {} bytes of mappings; mapping threads "
+                       "waited on the writer {} times",
+                       sopt.qmWriter->bytesWritten(),
+                       sopt.qmWriter->numStalls());
         // if we wrote to a buffer other than stdout, close
         // the file
         if (sopt.qmFileName != "-") { sopt.qmFile.close(); }
@@ -2570,3 +2914,121 @@ transcript abundance from RNA-seq reads
 
   return 0;
 }
+
+// The name of the option given by the command-line argument @arg,
+// without any attached value (e.g. --libType=ISR -> --libType, -lISR -> -l)
+std::string optionName(const std::string& arg) {
+  if (arg.size() > 2 and arg[0] == '-' and arg[1] == '-') {
+    return arg.substr(0, arg.find('='));
+  } else if (arg.size() > 2 and arg[0] == '-') {
+    return arg.substr(0, 2);
+  }
+  return arg;
+}
+
+/**
+ * Quantify all of the samples listed in a sample sheet back-to-back
+ * within this process.  The index is loaded once (by the first sample)
+ * and shared by all subsequent samples.
+ */
+int salmonQuantifyBatch(int argc, char* argv[]) {
+  using std::string;
+  using std::vector;
+  namespace bfs = boost::filesystem;
+  namespace po = boost::program_options;
+
+  string sampleSheet;
+  string output;
+  po::options_description batch("batch options");
+  batch.add_options()
+    ("sampleSheet", po::value<string>(&sampleSheet)->required(), "")
+    ("output,o", po::value<string>(&output)->required(), "");
+
+  po::variables_map vm;
+  vector<string> sharedArgs;
+  try {
+    auto parsed = po::command_line_parser(argc, argv)
+                      .options(batch)
+                      .allow_unregistered()
+                      .run();
+    po::store(parsed, vm);
+    po::notify(vm);
+    sharedArgs = po::collect_unrecognized(parsed.options, po::include_positional);
+  } catch (po::error& e) {
+    std::cerr << "Exception : [" << e.what() << "]. Exiting.\n";
+    std::exit(1);
+  }
+
+  for (auto& a : sharedArgs) {
+    auto opt = optionName(a);
+    if (opt == "-l" or opt == "--libType" or opt == "-r" or opt == "--unmatedReads" or
+        opt == "-1" or opt == "--mates1" or opt == "-2" or opt == "--mates2") {
+      fmt::print(stderr, "The option {} can not be used along with --sampleSheet; "
+                         "the library type and reads of each sample are given "
+                         "in the sample sheet.\n", opt);
+      std::exit(1);
+    }
+  }
+
+  vector<salmon::SampleSheetEntry> samples;
+  if (!salmon::parseSampleSheet(sampleSheet, samples)) {
+    std::exit(1);
+  }
+  if (samples.empty()) {
+    fmt::print(stderr, "The sample sheet [{}] did not list any samples\n", sampleSheet);
+    std::exit(1);
+  }
+
+  std::shared_ptr<SalmonIndex> sharedIndex{nullptr};
+  size_t sampleNum{0};
+  for (auto& sample : samples) {
+    ++sampleNum;
+    fmt::print(stderr, "\n[batch] quantifying sample {} ({} of {})\n",
+               sample.name, sampleNum, samples.size());
+
+    bfs::path sampleOutput = bfs::path(output) / sample.name;
+    vector<string> args{argv[0]};
+    args.insert(args.end(), sharedArgs.begin(), sharedArgs.end());
+    args.push_back("-l");
+    args.push_back(sample.libType);
+    if (!sample.unmated.empty()) {
+      args.push_back("-r");
+      args.insert(args.end(), sample.unmated.begin(), sample.unmated.end());
+    } else {
+      args.push_back("-1");
+      args.insert(args.end(), sample.mates1.begin(), sample.mates1.end());
+      args.push_back("-2");
+      args.insert(args.end(), sample.mates2.begin(), sample.mates2.end());
+    }
+    args.push_back("-o");
+    args.push_back(sampleOutput.string());
+
+    vector<char*> sampleArgv;
+    for (auto& a : args) {
+      sampleArgv.push_back(const_cast<char*>(a.c_str()));
+    }
+    sampleArgv.push_back(nullptr);
+
+    int ret = quantifySample(static_cast<int>(args.size()), sampleArgv.data(),
+                             sharedIndex);
+    // The loggers are registered by name, and are re-created (with a
+    // log directory under the new output directory) for every sample.
+    spdlog::drop_all();
+    if (ret != 0) {
+      fmt::print(stderr, "[batch] quantification of sample {} failed; exiting\n",
+                 sample.name);
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int salmonQuantify(int argc, char* argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (optionName(argv[i]) == "--sampleSheet") {
+      return salmonQuantifyBatch(argc, argv);
+    }
+  }
+  std::shared_ptr<SalmonIndex> sharedIndex{nullptr};
+  return quantifySample(argc, argv, sharedIndex);
+}
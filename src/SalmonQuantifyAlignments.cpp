@@ -44,6 +44,7 @@ extern "C" {
 #include "BAMQueue.hpp"
 #include "SalmonMath.hpp"
 #include "FASTAParser.hpp"
+#include "SalmonRandom.hpp"
 #include "LibraryFormat.hpp"
 #include "Transcript.hpp"
 #include "ReadPair.hpp"
@@ -55,6 +56,7 @@ extern "C" {
 #include "SalmonUtils.hpp"
 #include "SalmonConfig.hpp"
 #include "SalmonOpts.hpp"
+#include "TaskScheduler.hpp"
 #include "NullFragmentFilter.hpp"
 #include "Sampler.hpp"
 #include "spdlog/spdlog.h"
@@ -130,10 +132,9 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
 		      BiasParams& observedBiasParams,
                       std::atomic<bool>& burnedIn,
                       bool initialRound,
-                      std::atomic<size_t>& processedReads) {
+                      std::atomic<size_t>& processedReads,
+                      uint64_t streamIndex) {
 
-    // Seed with a real random value, if available
-    std::random_device rd;
     auto& log = salmonOpts.jointLog;
 
     // Whether or not we are using "banking"
@@ -141,8 +142,8 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
     double incompatPrior = salmonOpts.incompatPrior;
     bool useReadCompat = incompatPrior != salmon::math::LOG_1;
     
-    // Create a random uniform distribution
-    std::default_random_engine eng(rd());
+    // This thread's stream of random numbers
+    auto eng = salmon::rng::stream(salmonOpts.rngSeed, salmon::rng::Phase::ONLINE, streamIndex);
     std::uniform_real_distribution<> uni(0.0, 1.0 + std::numeric_limits<double>::min());
 
     // If we're auto detecting the library type
@@ -160,6 +161,7 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
     auto& obsRC = observedBiasParams.massRC;
 
     bool gcBiasCorrect = salmonOpts.gcBiasCorrect;
+    auto& auxModels = *salmonOpts.auxModels;
 
     using salmon::math::LOG_0;
     using salmon::math::logAdd;
@@ -198,8 +200,12 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
 
     double maxZeroFrac{0.0};
 
+    // Time spent waiting for work, and processing it
+    PhaseTelemetry::ThreadCounters phaseTimes(salmonOpts.telemetry.get());
+
     while (!doneParsing or !workQueue.empty()) {
         uint32_t zeroProbFrags{0};
+        auto phaseStart = PhaseTelemetry::Clock::now();
 
         // Try up to numTries times to get work from the queue before
         // giving up and waiting on the condition variable
@@ -215,9 +221,12 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
                  
 
         uint64_t batchReads{0};
+        phaseTimes.add(TelemetryPhase::PARSE_WAIT, PhaseTelemetry::nanosSince(phaseStart));
 
 	    // If we actually got some work
         if (miniBatch != nullptr) {
+            auto updateStart = PhaseTelemetry::Clock::now();
+            uint64_t eqClassNanos{0};
 
             useAuxParams = (processedReads > salmonOpts.numPreBurninFrags);
             ++activeBatches;
@@ -419,19 +428,33 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
 
                     // EQCLASS
                     double auxProbSum{0.0};
-                    for (auto& p : auxProbs) {
-                        p = std::exp(p - auxDenom);
-                        auxProbSum += p;
-                    }
+                    for (auto& p : auxProbs) { p -= auxDenom; }
+                    salmon::math::expInPlace(auxProbs.data(), auxProbs.size());
+                    for (auto p : auxProbs) { auxProbSum += p; }
 
                     if (txpIDs.size() > 0) {
                         TranscriptGroup tg(txpIDs);
+                        auto eqStart = PhaseTelemetry::Clock::now();
                         eqBuilder.addGroup(std::move(tg), auxProbs, posProbs);
+                        eqClassNanos += PhaseTelemetry::nanosSince(eqStart);
                     }
 
 
                     // Are we doing bias correction?
-                    bool needBiasSample = salmonOpts.biasCorrect;
+                    bool needBiasSample = salmonOpts.biasCorrect and
+                        auxModels.shouldUpdate(AuxModel::SEQ_BIAS, eng);
+
+                    // How the other auxiliary models are updated by this
+                    // fragment
+                    auto fldUpdate = auxModels.mode(AuxModel::FRAG_LENGTH);
+                    auto gcBiasUpdate = auxModels.mode(AuxModel::GC_BIAS);
+                    bool auxSampled = (fldUpdate == AuxModelUpdate::SAMPLED or
+                                       gcBiasUpdate == AuxModelUpdate::SAMPLED) and
+                                      eng.uniform01() < auxModels.sampleRate();
+                    bool updateGCBias = gcBiasCorrect and
+                        AuxModelTracker::shouldUpdate(gcBiasUpdate, auxSampled);
+                    bool updateFragLengthDist = !salmonOpts.noFragLengthDist and
+                        AuxModelTracker::shouldUpdate(fldUpdate, auxSampled);
 
                     // Normalize the scores
                     for (auto& aln : alnGroup->alignments()) {
@@ -571,7 +594,7 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
 			}
 
 			// Collect the GC-fragment bias samples
-			if (gcBiasCorrect and aln->isPaired()) {
+			if (updateGCBias and aln->isPaired()) {
 			  ReadPair* alnp = reinterpret_cast<ReadPair*>(aln);
 			  bam_seq_t* r1 = alnp->read1; 
 			  bam_seq_t* r2 = alnp->read2; 
@@ -583,7 +606,7 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
 
                   if (start >= 0 and stop < transcript.RefLength) {
 		      auto desc = transcript.gcDesc(start, stop);
-                      observedGCMass.inc(desc, aln->logProb);
+                      observedGCMass.inc(desc, aln->logProb + auxModels.logWeight(gcBiasUpdate));
                    }
 
           /*
@@ -636,10 +659,11 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
                                 alnMod.update(*aln, transcript, LOG_1, logForgettingMass);
                             }
                             // Update the fragment length distribution
-                            if (aln->isPaired() and !salmonOpts.noFragLengthDist) {
+                            if (aln->isPaired() and updateFragLengthDist) {
                                 double fragLength = aln->fragLengthPedantic(transcript.RefLength);
                                 if (fragLength > 0) {
-                                    fragLengthDist.addVal(fragLength, logForgettingMass);
+                                    fragLengthDist.addVal(fragLength,
+                                            logForgettingMass + auxModels.logWeight(fldUpdate));
                                 }
                             }
                             // Update the fragment start position distribution
@@ -728,6 +752,10 @@ void processMiniBatch(AlignmentLibrary<FragT>& alnLib,
             }
             --activeBatches;
             processedReads += batchReads;
+            salmon::utils::trackAuxModels(salmonOpts, observedBiasParams, fragLengthDist,
+                                          batchReads, processedReads, burnedIn);
+            phaseTimes.add(TelemetryPhase::EQCLASS_INSERTION, eqClassNanos);
+            phaseTimes.add(TelemetryPhase::ONLINE_UPDATE, PhaseTelemetry::nanosSince(updateStart));
             if (processedReads >= numBurninFrags and !burnedIn) {
                 if (useFSPD) {
                     // update all of the fragment start position
@@ -874,7 +902,9 @@ bool quantifyLibrary(
 		    std::ref(observedBiasParams[i]),
                     std::ref(burnedIn),
                     initialRound,
-                    std::ref(totalProcessedReads));
+                    std::ref(totalProcessedReads),
+                    // a distinct stream for each thread of each round
+                    (firstTimestepOfRound << 16) | i);
         }
 
         if (!haveCache) {
@@ -1021,7 +1051,9 @@ bool quantifyLibrary(
         }
         //EQCLASS
         bool done = alnLib.equivalenceClassBuilder().finish();
-        // skip the extra online rounds
+        // skip the extra online rounds; the equivalence classes are built
+        // in a single pass, so the alignment file is only ever decoded once
+        // here (and processedCache is never replayed).
         terminate = true;
         // END EQCLASS
     }
@@ -1140,6 +1172,10 @@ bool processSample(AlignmentLibrary<ReadT>& alnLib,
         }
     }
 
+    // Now that sampling is done, the telemetry is complete
+    sopt.telemetry->stopProgressStream();
+    gzw.writeMetaInfo(sopt, alnLib, runStartTime);
+
     //bfs::path libCountFilePath = outputDirectory / "lib_format_counts.json";
     //alnLib.summarizeLibraryTypeCounts(libCountFilePath);
 
@@ -1245,6 +1281,9 @@ int salmonAlignmentQuantify(int argc, char* argv[]) {
                                         "not be too large if you wish to keep a low memory usage, but setting it large enough to accommodate all of the mapped "
                                         "read can substantially speed up inference on \"small\" files that contain only a few million reads.")
     ("maxReadOcc,w", po::value<uint32_t>(&(sopt.maxReadOccs))->default_value(200), "Reads \"mapping\" to more than this many places won't be considered.")
+    ("fastMath", po::bool_switch(&(sopt.fastMath))->default_value(false), "Use fast approximations of the log-space arithmetic "
+                        "(log, exp and log-sum) performed while processing fragments, rather than the exact versions.  The approximations "
+                        "have a relative error below 2e-4.")
     ("noEffectiveLengthCorrection", po::bool_switch(&(sopt.noEffectiveLengthCorrection))->default_value(false), "Disables "
                         "effective length correction when computing the probability that a fragment was generated "
                         "from a transcript.  If this flag is passed in, the fragment length distribution is not taken "
@@ -1291,6 +1330,11 @@ int salmonAlignmentQuantify(int argc, char* argv[]) {
     ("numAuxModelSamples", po::value<uint32_t>(&(sopt.numBurninFrags))->default_value(5000000), "The first <numAuxModelSamples> are used to train the "
      			"auxiliary model parameters (e.g. fragment length distribution, bias, etc.).  After ther first <numAuxModelSamples> observations "
 			"the auxiliary model parameters will be assumed to have converged and will be fixed.")
+    ("auxModelTolerance", po::value<double>(&(sopt.auxModelTolerance))->default_value(0.005), "Each worker thread "
+                        "periodically checks how much each auxiliary model (fragment length distribution, GC and sequence bias) "
+                        "has changed.  A model that repeatedly changes by less than this (in total variation distance) is first "
+                        "updated from only a random sample of the fragments, and later not at all.  The decisions are recorded "
+                        "in aux/meta_info.json.  A value of 0 always updates every model.")
     ("sampleOut,s", po::bool_switch(&(sopt.sampleOutput))->default_value(false), "Write a \"postSample.bam\" file in the output directory "
                         "that will sample the input alignments according to the estimated transcript abundances. If you're "
                         "going to perform downstream analysis of the alignments with tools which don't, themselves, take "
@@ -1300,7 +1344,16 @@ int salmonAlignmentQuantify(int argc, char* argv[]) {
     ("numGibbsSamples", po::value<uint32_t>(&(sopt.numGibbsSamples))->default_value(0), "Number of Gibbs sampling rounds to "
      "perform.")
     ("numBootstraps", po::value<uint32_t>(&(sopt.numBootstraps))->default_value(0), "Number of bootstrap samples to generate. Note: "
-      "This is mutually exclusive with Gibbs sampling.");
+      "This is mutually exclusive with Gibbs sampling.")
+    ("seed", po::value<uint64_t>(&(sopt.rngSeed)), "The seed for all of the random choices made during quantification "
+     "(e.g. bootstrap and Gibbs samples).  For a given seed and number of threads, the bootstrap and Gibbs samples "
+     "are reproducible.  If this isn't given, a random seed is chosen; either way, the seed is recorded in "
+     "aux/meta_info.json.")
+    ("binaryOutput", po::bool_switch(&(sopt.binaryOutput))->default_value(false), "In addition to the usual text output, write the "
+     "abundances (quant.bin) and bootstrap / Gibbs samples (if any) in salmon's binary columnar format.")
+    ("telemetryInterval", po::value<uint32_t>(&(sopt.telemetryInterval))->default_value(0), "If this is > 0, then every this "
+     "many seconds, append a snapshot of the time spent in each phase of quantification (as a line of JSON) to "
+     "aux/telemetry.jsonl.  The totals are always recorded in aux/meta_info.json.");
 
     po::options_description testing("\n"
             "testing options");
@@ -1355,6 +1408,16 @@ int salmonAlignmentQuantify(int argc, char* argv[]) {
         }
         po::notify(vm);
 
+        if (!vm.count("seed")) {
+            sopt.rngSeed = salmon::rng::randomSeed();
+        }
+
+        if (sopt.auxModelTolerance < 0.0) {
+            fmt::print(stderr, "--auxModelTolerance must be >= 0; setting it to 0\n");
+            sopt.auxModelTolerance = 0.0;
+        }
+        sopt.auxModels->configure(sopt.auxModelTolerance);
+
         sopt.alnMode = true;
 
         if (numThreads < 2) {
@@ -1363,6 +1426,11 @@ int salmonAlignmentQuantify(int argc, char* argv[]) {
             numThreads = 2;
         }
         sopt.numThreads = numThreads;
+        // This must be set before any worker threads start
+        salmon::math::setAccuracy(sopt.fastMath ? salmon::math::Accuracy::FAST
+                                                : salmon::math::Accuracy::EXACT);
+        // The one pool that every parallel phase of this run will share
+        sopt.scheduler = std::make_shared<salmon::TaskScheduler>(sopt.numThreads);
 
         if (sopt.forgettingFactor <= 0.5 or
             sopt.forgettingFactor > 1.0) {
@@ -1488,6 +1556,13 @@ int salmonAlignmentQuantify(int argc, char* argv[]) {
 	  std::cerr << "Logs will be written to " << logDirectory.string() << "\n";
 	}
 
+        if (sopt.telemetryInterval > 0) {
+            bfs::path auxDir = outputDirectory / sopt.auxDir;
+            bfs::create_directories(auxDir);
+            sopt.telemetry->startProgressStream((auxDir / "telemetry.jsonl").string(),
+                                                sopt.telemetryInterval);
+        }
+
         bfs::path logPath = logDirectory / "salmon.log";
         size_t max_q_size = 2097152;
         spdlog::set_async_mode(max_q_size);
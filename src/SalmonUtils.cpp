@@ -15,15 +15,21 @@
 #include "tbb/parallel_for.h"
 
 #include "AlignmentLibrary.hpp"
+#include "BiasBackground.hpp"
+#include "BiasParams.hpp"
 #include "DistributionUtils.hpp"
 #include "GCFragModel.hpp"
 #include "KmerContext.hpp"
 #include "LibraryFormat.hpp"
+#include "NumaTopology.hpp"
 #include "ReadExperiment.hpp"
 #include "ReadPair.hpp"
 #include "SBModel.hpp"
 #include "SalmonMath.hpp"
+#include "SalmonRandom.hpp"
 #include "SalmonUtils.hpp"
+#include "SimulatedBiasExperiment.hpp"
+#include "TaskScheduler.hpp"
 #include "UnpairedRead.hpp"
 #include "TryableSpinLock.hpp"
 
@@ -1284,6 +1290,10 @@ bool processQuantOptions(SalmonOpts& sopt,
   sopt.runStartTime = std::string(std::asctime(std::localtime(&result)));
   sopt.runStartTime.pop_back(); // remove the newline
 
+  if (!vm.count("seed")) {
+    sopt.rngSeed = salmon::rng::randomSeed();
+  }
+
   // Verify the geneMap before we start doing any real work.
   bfs::path geneMapPath;
   if (vm.count("geneMap")) {
@@ -1329,15 +1339,11 @@ bool processQuantOptions(SalmonOpts& sopt,
   bool writeQuasimappings = (sopt.qmFileName != "");
 
   bfs::path logPath = logDirectory / "salmon_quant.log";
-  // must be a power-of-two
+  // must be a power-of-two.  Mappings and unmapped names don't go
+  // through the logger (see AsyncOutputWriter), so this needn't grow
+  // when they are being written.
   size_t max_q_size = 2097152;
-                      
-  // make it larger if we're writing mappings or 
-  // unmapped names.
   std::streambuf* qmBuf;
-  if (writeQuasimappings or sopt.writeUnmappedNames) {
-      max_q_size = 16777216;
-  }  
 
   spdlog::set_async_mode(max_q_size);
 
@@ -1369,18 +1375,8 @@ bool processQuantOptions(SalmonOpts& sopt,
     if (auxSuccess) {
       bfs::path unmappedNameFile = auxDir / "unmapped_names.txt";
       std::ofstream* outFile = new std::ofstream(unmappedNameFile.string());
-
-      // Must be a power of 2
-      //size_t queueSize{268435456};
-      //spdlog::set_async_mode(queueSize);
-      auto outputSink =
-          std::make_shared<spdlog::sinks::ostream_sink_mt>(*outFile);
-
-      std::shared_ptr<spdlog::logger> outLog =
-          std::make_shared<spdlog::logger>("unmappedLog", outputSink);
-      spdlog::register_logger(outLog);
-      outLog->set_pattern("%v");
       sopt.unmappedFile.reset(outFile);
+      sopt.unmappedWriter.reset(new AsyncOutputWriter(*outFile));
     } else {
       jointLog->error("Couldn't create auxiliary directory in which to place "
                       "\"unmapped_names.txt\"");
@@ -1416,11 +1412,19 @@ bool processQuantOptions(SalmonOpts& sopt,
       // either std::cout, or a file.
       sopt.qmStream.reset(new std::ostream(qmBuf));
       
+      // The SAM header is written (before any mapping begins) through a
+      // logger, while the records themselves are handed off to a
+      // dedicated writer thread.
       auto outputSink = std::make_shared<spdlog::sinks::ostream_sink_mt>(*(sopt.qmStream.get()));
       sopt.qmLog = std::make_shared<spdlog::logger>("qmStream", outputSink);
       sopt.qmLog->set_pattern("%v");
+      sopt.qmWriter.reset(new AsyncOutputWriter(*(sopt.qmStream.get())));
   } 
 
+  // This must be set before any worker threads start
+  salmon::math::setAccuracy(sopt.fastMath ? salmon::math::Accuracy::FAST
+                                          : salmon::math::Accuracy::EXACT);
+
   // Verify that no inconsistent options were provided
   if (sopt.numGibbsSamples > 0 and sopt.numBootstraps > 0) {
     jointLog->error("You cannot perform both Gibbs sampling and bootstrapping. "
@@ -1449,6 +1453,38 @@ bool processQuantOptions(SalmonOpts& sopt,
     return false;
   }
   
+  if (sopt.auxModelTolerance < 0.0) {
+    jointLog->warn("--auxModelTolerance must be >= 0; setting it to 0");
+    sopt.auxModelTolerance = 0.0;
+  }
+  sopt.auxModels->configure(sopt.auxModelTolerance);
+
+  if (sopt.numaPolicy != "none") {
+    if (sopt.numaPolicy != "local" and sopt.numaPolicy != "interleave") {
+      jointLog->error("--numa must be one of none, local or interleave "
+                      "(not {})", sopt.numaPolicy);
+      jointLog->flush();
+      return false;
+    }
+    auto topo = salmon::numa::Topology::detect();
+    if (topo.numNodes() < 2) {
+      jointLog->info("Only one NUMA node was found; ignoring --numa {}",
+                     sopt.numaPolicy);
+    } else {
+      fmt::MemoryWriter nodeDesc;
+      for (size_t n = 0; n < topo.numNodes(); ++n) {
+        nodeDesc << ((n > 0) ? ", " : "") << "node " << topo.nodeID(n) << " ("
+                 << topo.cpus(n).size() << " cpus)";
+      }
+      jointLog->info("Placing worker threads on {} NUMA nodes: {}",
+                     topo.numNodes(), nodeDesc.str());
+      sopt.numa = std::make_shared<salmon::numa::Topology>(std::move(topo));
+    }
+  }
+
+  // The one pool that every parallel phase of this run will share
+  sopt.scheduler = std::make_shared<salmon::TaskScheduler>(sopt.numThreads);
+
   // maybe arbitrary, but if it's smaller than this, consider it
   // equal to LOG_0.
   if (sopt.incompatPrior < 1e-320 or sopt.incompatPrior == 0.0) {
@@ -1463,272 +1499,269 @@ bool processQuantOptions(SalmonOpts& sopt,
   return true;
 }
 
-/**
- * Computes (and returns) new effective lengths for the transcripts
- * based on the current abundance estimates (alphas) and the current
- * effective lengths (effLensIn).  This approach to sequence-specifc bias is
- * based on the one taken in Roberts et al. (2011) [1].
- * Here, we also consider fragment-GC bias which uses a novel method extending
- * the idea of adjusting the effective lengths.
- *
- * [1] Roberts, Adam, et al. "Improving RNA-Seq expression estimates by
- * correcting for fragment bias."
- *     Genome Biol 12.3 (2011): R22.
- */
-template <typename AbundanceVecT, typename ReadExpT>
-Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
-                                       Eigen::VectorXd& effLensIn,
-                                       AbundanceVecT& alphas, bool writeBias) {
-
-  using std::vector;
-  using BlockedIndexRange = tbb::blocked_range<size_t>;
-
-  double minAlpha = 1e-8;
-  double minCDFMass = 1e-10;
-  uint32_t gcSamp{sopt.pdfSampFactor};
-  bool gcBiasCorrect{sopt.gcBiasCorrect};
-  bool seqBiasCorrect{sopt.biasCorrect};
-  bool posBiasCorrect{sopt.posBiasCorrect};
-
-  double probFwd = readExp.gcFracFwd();
-  double probRC = readExp.gcFracRC();
+void trackAuxModels(const SalmonOpts& sopt, BiasParams& biasParams,
+                    FragmentLengthDistribution& fragLengthDist,
+                    uint64_t numNewFragments, uint64_t numAssignedFragments,
+                    bool burnedIn) {
+  auto& tracker = *sopt.auxModels;
+  auto& ts = biasParams.auxModelState;
+  if (!tracker.windowDone(ts, numNewFragments)) {
+    return;
+  }
+
+  std::vector<double> masses;
+  auto observe = [&](AuxModel m) -> void {
+    if (tracker.observe(m, ts, masses, numAssignedFragments)) {
+      sopt.jointLog->info("The {} model settled after {} fragments; it will "
+                          "now receive {} updates",
+                          AuxModelTracker::modelName(m), numAssignedFragments,
+                          AuxModelTracker::updateName(tracker.mode(m)));
+    }
+    masses.clear();
+  };
 
-  if (gcBiasCorrect and probFwd < 0.0) {
-    sopt.jointLog->warn("Had no fragments from which to estimate "
-                        "fwd vs. rev-comp mapping rate.  Skipping "
-                        "sequence-specific / fragment-gc bias correction");
-    return effLensIn;
+  // The fragment length distribution is only learned during burn-in
+  if (!burnedIn and !sopt.noFragLengthDist) {
+    size_t minV{0}, maxV{0};
+    fragLengthDist.dumpPMF(masses, minV, maxV);
+    for (auto& x : masses) {
+      x = std::exp(x);
+    }
+    observe(AuxModel::FRAG_LENGTH);
   }
-
-  // calculate read bias normalization factor -- total count in read
-  // distribution.
-  auto& obs5 = readExp.readBiasModelObserved(salmon::utils::Direction::FORWARD);
-  auto& obs3 =
-      readExp.readBiasModelObserved(salmon::utils::Direction::REVERSE_COMPLEMENT);
-  obs5.normalize();
-  obs3.normalize();
-
-  auto& pos5Obs = readExp.posBias(salmon::utils::Direction::FORWARD);
-  auto& pos3Obs = readExp.posBias(salmon::utils::Direction::REVERSE_COMPLEMENT);
-
-  int32_t K =
-      seqBiasCorrect ? static_cast<int32_t>(obs5.getContextLength()) : 1;
-  int32_t contextUpstream = seqBiasCorrect ? obs5.contextBefore(false) : 0;
-
-  FragmentLengthDistribution& fld = *(readExp.fragmentLengthDistribution());
-
-  // The *expected* biases from GC effects
-  auto& transcriptGCDist = readExp.expectedGCBias();
-  auto& gcCounts = readExp.observedGC();
-  double readGCNormFactor = 0.0;
-  int32_t fldLow{0};
-  int32_t fldHigh{1};
-
-  double quantileCutoffLow = 0.005;
-  double quantileCutoffHigh = 1.0 - quantileCutoffLow;
-
-  // The CDF and PDF of the fragment length distribution
-  std::vector<double> cdf(fld.maxVal() + 1, 0.0);
-  std::vector<double> pdf(fld.maxVal() + 1, 0.0);
-  {
-    transcriptGCDist.reset(distribution_utils::DistributionSpace::LINEAR);
-
-    bool lb{false};
-    bool ub{false};
-    for (size_t i = 0; i <= fld.maxVal(); ++i) {
-      pdf[i] = std::exp(fld.pmf(i));
-      cdf[i] = (i > 0) ? cdf[i - 1] + pdf[i] : pdf[i];
-      auto density = cdf[i];
-
-      if (!lb and density >= quantileCutoffLow) {
-        lb = true;
-        fldLow = i;
-      }
-      if (!ub and density >= quantileCutoffHigh) {
-        ub = true;
-        fldHigh = i;
-      }
+  if (sopt.posBiasCorrect) {
+    for (auto& pb : biasParams.posBiasFW) {
+      pb.appendMasses(masses);
     }
-
-    /*
-    if (gcBiasCorrect) {
-      for (auto& c : gcCounts) {
-        readGCNormFactor += c;
-      }
+    for (auto& pb : biasParams.posBiasRC) {
+      pb.appendMasses(masses);
     }
-    */
+    observe(AuxModel::POS_BIAS);
   }
+  if (sopt.gcBiasCorrect) {
+    biasParams.observedGCMass.appendMasses(masses);
+    observe(AuxModel::GC_BIAS);
+  }
+  if (sopt.biasCorrect and sopt.numBiasSamples > 0) {
+    biasParams.seqBiasModelFW.appendMasses(masses);
+    biasParams.seqBiasModelRC.appendMasses(masses);
+    observe(AuxModel::SEQ_BIAS);
+  }
+}
 
-  // Make this const so there are no shenanigans
-  const auto& transcripts = readExp.transcripts();
-
-  // The effective lengths adjusted for bias
-  Eigen::VectorXd effLensOut(effLensIn.size());
-
-  // How much to cut off
-  int32_t trunc = K;
-
-  using GCBiasVecT = std::vector<double>;
-  using SeqBiasVecT = std::vector<double>;
-
-  /**
-   * These will store "thread local" parameters
-   * for the appropriate bias terms.
-   */
-  class CombineableBiasParams {
-  public:
-    CombineableBiasParams(uint32_t K, size_t numCondBins, size_t numGCBins) :
-      expectGC(numCondBins, numGCBins, distribution_utils::DistributionSpace::LINEAR) {
-      expectPos5 = std::vector<SimplePosBias>(5);
-      expectPos3 = std::vector<SimplePosBias>(5);
+namespace {
+
+// The context around each end of a fragment that is used to bin the GC
+// content of the fragment, and the scale from GC counts to percentages
+constexpr int gcOutsideContext{3};
+constexpr int gcInsideContext{2};
+constexpr int gcContextSize{gcOutsideContext + gcInsideContext};
+constexpr double gcContextScale{100.0 / (2 * gcContextSize)};
+
+// Write the reverse complement of the first @l nucleotides of @s to @o
+void reverseComplementInto(const char* s, int32_t l, std::string& o) {
+  if (l > o.size()) {
+    o.resize(l, 'A');
+  }
+  int32_t j = 0;
+  for (int32_t i = l - 1; i >= 0; --i, ++j) {
+    switch (s[i]) {
+    case 'A':
+    case 'a':
+      o[j] = 'T';
+      break;
+    case 'C':
+    case 'c':
+      o[j] = 'G';
+      break;
+    case 'T':
+    case 't':
+      o[j] = 'A';
+      break;
+    case 'G':
+    case 'g':
+      o[j] = 'C';
+      break;
+    default:
+      o[j] = 'N';
+      break;
     }
+  }
+}
 
-    std::vector<SimplePosBias> expectPos5;
-    std::vector<SimplePosBias> expectPos3;
-    SBModel expectSeqFW;
-    SBModel expectSeqRC;
-    GCFragModel expectGC;
-  };
-
-  auto revComplement = [](const char* s, int32_t l, std::string& o) -> void {
-    if (l > o.size()) {
-      o.resize(l, 'A');
-    }
-    int32_t j = 0;
-    for (int32_t i = l - 1; i >= 0; --i, ++j) {
-      switch (s[i]) {
-      case 'A':
-      case 'a':
-        o[j] = 'T';
-        break;
-      case 'C':
-      case 'c':
-        o[j] = 'G';
-        break;
-      case 'T':
-      case 't':
-        o[j] = 'A';
-        break;
+// The number of G / C nucleotides in the context window around each
+// position of @txp (as the 5' and as the 3' end of a fragment)
+void populateContextCounts(const Transcript& txp, const char* tseq,
+                           Eigen::VectorXd& contextCountsFP,
+                           Eigen::VectorXd& contextCountsTP) {
+  auto refLen = static_cast<int32_t>(txp.RefLength);
+  if (refLen > gcContextSize) {
+    int windowStart = -1;
+    int windowEnd = gcContextSize - 1;
+    int fp = gcOutsideContext;
+    int tp = gcInsideContext - 1;
+    double count = txp.gcAt(windowEnd);
+    contextCountsFP[fp] = count;
+    contextCountsTP[tp] = count;
+    ++windowStart;
+    ++windowEnd;
+    ++fp;
+    ++tp;
+    for (; tp < refLen; ++windowStart, ++windowEnd, ++fp, ++tp) {
+      switch (tseq[windowStart]) {
       case 'G':
       case 'g':
-        o[j] = 'C';
-        break;
-      default:
-        o[j] = 'N';
-        break;
+      case 'C':
+      case 'c':
+        count -= 1;
       }
-    }
-  };
-
-  int outsideContext{3};
-  int insideContext{2};
-
-  int contextSize = outsideContext + insideContext;
-  double cscale = 100.0 / (2 * contextSize);
-  auto populateContextCounts = [outsideContext, insideContext, contextSize](
-      const Transcript& txp, const char* tseq, Eigen::VectorXd& contextCountsFP,
-      Eigen::VectorXd& contextCountsTP) {
-    auto refLen = static_cast<int32_t>(txp.RefLength);
-    auto lastPos = refLen - 1;
-    if (refLen > contextSize) {
-      int windowStart = -1;
-      int windowEnd = contextSize - 1;
-      int fp = outsideContext;
-      int tp = insideContext - 1;
-      double count = txp.gcAt(windowEnd);
-      contextCountsFP[fp] = count;
-      contextCountsTP[tp] = count;
-      ++windowStart;
-      ++windowEnd;
-      ++fp;
-      ++tp;
-      for (; tp < refLen; ++windowStart, ++windowEnd, ++fp, ++tp) {
-        switch (tseq[windowStart]) {
+      if (windowEnd < refLen) {
+        switch (tseq[windowEnd]) {
         case 'G':
         case 'g':
         case 'C':
         case 'c':
-          count -= 1;
+          count += 1;
         }
-        if (windowEnd < refLen) {
-          switch (tseq[windowEnd]) {
-          case 'G':
-          case 'g':
-          case 'C':
-          case 'c':
-            count += 1;
-          }
-        }
-        if (fp < refLen) {
-          contextCountsFP[fp] = count;
-        }
-        contextCountsTP[tp] = count;
       }
+      if (fp < refLen) {
+        contextCountsFP[fp] = count;
+      }
+      contextCountsTP[tp] = count;
     }
-  };
+  }
+}
+
+// The (non-logged) pdf of the fragment length distribution
+std::vector<double> fragLengthPDF(FragmentLengthDistribution& fld) {
+  std::vector<double> pdf(fld.maxVal() + 1, 0.0);
+  for (size_t i = 0; i <= fld.maxVal(); ++i) {
+    pdf[i] = std::exp(fld.pmf(i));
+  }
+  return pdf;
+}
+
+// The cdf of @pdf, and the lengths at which it first reaches 0.5% and 99.5%
+void fragLengthCDF(const std::vector<double>& pdf, std::vector<double>& cdf,
+                   int32_t& fldLow, int32_t& fldHigh) {
+  double quantileCutoffLow = 0.005;
+  double quantileCutoffHigh = 1.0 - quantileCutoffLow;
+
+  cdf.assign(pdf.size(), 0.0);
+  fldLow = 0;
+  fldHigh = 1;
+  bool lb{false};
+  bool ub{false};
+  for (size_t i = 0; i < pdf.size(); ++i) {
+    cdf[i] = (i > 0) ? cdf[i - 1] + pdf[i] : pdf[i];
+    auto density = cdf[i];
+
+    if (!lb and density >= quantileCutoffLow) {
+      lb = true;
+      fldLow = i;
+    }
+    if (!ub and density >= quantileCutoffHigh) {
+      ub = true;
+      fldHigh = i;
+    }
+  }
+}
+
+/**
+ * The weight of each transcript in the bias background: its abundance
+ * (from @alphas) over its effective length (from @effLens), or 0 for the
+ * transcripts that are too lowly expressed or too short, or over whose
+ * length the fragment length distribution (with cdf @cdf) has too little
+ * mass.
+ */
+template <typename AbundanceVecT>
+std::vector<double> biasBackgroundWeights(const std::vector<Transcript>& transcripts,
+                                          const std::vector<double>& cdf,
+                                          AbundanceVecT& alphas,
+                                          const Eigen::VectorXd& effLens) {
+  double minAlpha = 1e-8;
+  double minCDFMass = 1e-10;
+  std::vector<double> weights(transcripts.size(), 0.0);
+  for (size_t it = 0; it < transcripts.size(); ++it) {
+    const auto& txp = transcripts[it];
+    int32_t refLen = static_cast<int32_t>(txp.RefLength);
+    int32_t elen = static_cast<int32_t>(txp.EffectiveLength);
+    int32_t unprocessedLen = std::max(0, refLen - elen);
+    int32_t cdfMaxArg = std::min(static_cast<int32_t>(cdf.size() - 1), refLen);
+    double alpha = alphas[it];
+    if (cdf[cdfMaxArg] < minCDFMass or alpha < minAlpha or unprocessedLen <= 0) {
+      continue;
+    }
+    weights[it] = alpha / effLens(it);
+  }
+  return weights;
+}
+
+/**
+ * Add the expected bias counts of each transcript with a non-zero weight
+ * in @weights, scaled by that (possibly negative) weight, to @counts.  The
+ * fragment length distribution is given by its cdf, @cdf, and K is the
+ * length of the sequence-specific bias contexts.
+ */
+void addToBiasBackground(const SalmonOpts& sopt,
+                         const std::vector<Transcript>& transcripts, int32_t K,
+                         const std::vector<double>& cdf, int32_t fldLow,
+                         int32_t fldHigh, const std::vector<double>& weights,
+                         BiasBackground::Counts& counts) {
+  using BlockedIndexRange = tbb::blocked_range<size_t>;
+
+  uint32_t gcSamp{sopt.pdfSampFactor};
+  bool gcBiasCorrect{sopt.gcBiasCorrect};
+  bool seqBiasCorrect{sopt.biasCorrect};
+  bool posBiasCorrect{sopt.posBiasCorrect};
 
   /**
    * The local bias terms from each thread can be combined
    * via simple summation.
    */
-  auto getBiasParams = [K, &sopt]() -> CombineableBiasParams {
-    return CombineableBiasParams(K, sopt.numConditionalGCBins, sopt.numFragGCBins);
+  auto getBiasParams = [&sopt]() -> BiasBackground::Counts {
+    return BiasBackground::Counts(sopt.numConditionalGCBins, sopt.numFragGCBins);
   };
-  tbb::combinable<CombineableBiasParams> expectedDist(getBiasParams);
-  std::atomic<size_t> numBackgroundTranscripts{0};
-  std::atomic<size_t> numExpressedTranscripts{0};
+  tbb::combinable<BiasBackground::Counts> expectedDist(getBiasParams);
 
   tbb::parallel_for(
       BlockedIndexRange(size_t(0), size_t(transcripts.size())),
       [&](const BlockedIndexRange& range) -> void {
 
-        auto& expectSeqFW = expectedDist.local().expectSeqFW;
-        auto& expectSeqRC = expectedDist.local().expectSeqRC;
-        auto& expectGC = expectedDist.local().expectGC;
-        auto& expectPos5 = expectedDist.local().expectPos5;
-        auto& expectPos3 = expectedDist.local().expectPos3;
+        auto& expectSeqFW = expectedDist.local().seqFW;
+        auto& expectSeqRC = expectedDist.local().seqRC;
+        auto& expectGC = expectedDist.local().gc;
+        auto& expectPos5 = expectedDist.local().pos5;
+        auto& expectPos3 = expectedDist.local().pos3;
+        SimplePosBias posBins;
 
         std::string rcSeq;
+        // The (packed) contexts of a transcript, and their weights; these
+        // are added to the expected sequence models in one batch.
+        std::vector<uint64_t> fwContexts;
+        std::vector<uint64_t> rcContexts;
+        std::vector<double> contextWeights;
         // For each transcript
         for (auto it : boost::irange(range.begin(), range.end())) {
 
+          // Skip the transcripts that don't contribute
+          double weight = weights[it];
+          if (weight == 0.0) {
+            continue;
+          }
+
           // Get the transcript
           const auto& txp = transcripts[it];
 
-          // Get the reference length and the
-          // "initial" effective length (not considering any biases)
           int32_t refLen = static_cast<int32_t>(txp.RefLength);
-          int32_t elen = static_cast<int32_t>(txp.EffectiveLength);
-
-          // The difference between the actual and effective length
-          int32_t unprocessedLen = std::max(0, refLen - elen);
-
           int32_t cdfMaxArg =
               std::min(static_cast<int32_t>(cdf.size() - 1), refLen);
           double cdfMaxVal = cdf[cdfMaxArg];
-          // need a reliable CDF
-          if (cdfMaxVal < minCDFMass) {
-            continue;
-          }
           auto conditionalCDF = [cdfMaxArg, cdfMaxVal,
                                  &cdf](double x) -> double {
             return (x > cdfMaxArg) ? 1.0 : (cdf[x] / cdfMaxVal);
           };
 
-          // Skip transcripts with trivial expression or that are too
-          // short
-          if (alphas[it] < minAlpha or
-              unprocessedLen <= 0) { // or txp.uniqueUpdateFraction() < 0.90) {
-            if (alphas[it] >= minAlpha) {
-              ++numExpressedTranscripts;
-            }
-            continue;
-          }
-          ++numBackgroundTranscripts;
-
-          // Otherwise, proceed giving this transcript the following weight
-          double weight = (alphas[it] / effLensIn(it));
-
           Eigen::VectorXd contextCountsFP(refLen);
           Eigen::VectorXd contextCountsTP(refLen);
           contextCountsFP.setOnes();
@@ -1736,7 +1769,7 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
 
           // This transcript's sequence
           const char* tseq = txp.Sequence();
-          revComplement(tseq, refLen, rcSeq);
+          reverseComplementInto(tseq, refLen, rcSeq);
           const char* rseq = rcSeq.c_str();
 
           Mer fwmer;
@@ -1754,6 +1787,10 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
           int32_t locFLDLow = (refLen < cdfMaxArg) ? 1 : fldLow;
           int32_t locFLDHigh = (refLen < cdfMaxArg) ? cdfMaxArg : fldHigh;
 
+          fwContexts.clear();
+          rcContexts.clear();
+          contextWeights.clear();
+
           // For each position along the transcript
           // Starting from the 5' end and moving toward the 3' end
           for (int32_t fragStartPos = 0; fragStartPos < refLen - K;
@@ -1768,8 +1805,9 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
                     refLen - (fragStartPos + expectSeqFW.contextBefore(false));
                 if (maxFragLen >= 0 and maxFragLen < refLen) {
                   auto cdensity = conditionalCDF(maxFragLen);
-                  expectSeqFW.addSequence(fwmer, weight * cdensity);
-                  expectSeqRC.addSequence(rcmer, weight * cdensity);
+                  fwContexts.push_back(SBModel::pack(fwmer));
+                  rcContexts.push_back(SBModel::pack(rcmer));
+                  contextWeights.push_back(weight * cdensity);
                 }
               }
 
@@ -1791,7 +1829,7 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
                   auto gcFrac = txp.gcFrac(fragStart, fragEnd);
                   int32_t contextFrac = std::lrint(
                       (contextCountsFP[fragStart] + contextCountsTP[fragEnd]) *
-                      cscale);
+                      gcContextScale);
                   GCDesc desc{gcFrac, contextFrac};
                   expectGC.inc(desc,
                                weight * (conditionalCDF(fl) - prevFLMass));
@@ -1806,23 +1844,165 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
             if (posBiasCorrect) {
               int32_t maxFragLenFW = refLen - fragStartPos + 1;
               int32_t maxFragLenRC = fragStartPos;
-              auto densityFW = conditionalCDF(maxFragLenFW);
-              auto densityRC = conditionalCDF(maxFragLenRC);
-              if (weight * densityFW > 1e-8) {
-                expectPos5[txp.lengthClassIndex()].addMass(
-                    fragStartPos, txp.RefLength, std::log(weight * densityFW));
+              double massFW = weight * conditionalCDF(maxFragLenFW);
+              double massRC = weight * conditionalCDF(maxFragLenRC);
+              int32_t bin = posBins.binOf(fragStartPos, txp.RefLength);
+              if (std::abs(massFW) > 1e-8) {
+                expectPos5[txp.lengthClassIndex()][bin] += massFW;
               }
-              if (weight * densityRC > 1e-8) {
-                expectPos3[txp.lengthClassIndex()].addMass(
-                    fragStartPos, txp.RefLength, std::log(weight * densityRC));
+              if (std::abs(massRC) > 1e-8) {
+                expectPos3[txp.lengthClassIndex()][bin] += massRC;
               }
             }
           } // end: for every fragment start position
+
+          if (seqBiasCorrect) {
+            expectSeqFW.addSequences(fwContexts.data(), contextWeights.data(),
+                                     contextWeights.size());
+            expectSeqRC.addSequences(rcContexts.data(), contextWeights.data(),
+                                     contextWeights.size());
+          }
         }   // end for each transcript
 
       } // end tbb for function
       );
 
+  /**
+   * The local bias terms from each thread can be combined
+   * via simple summation.
+   */
+  expectedDist.combine_each(
+      [&counts](const BiasBackground::Counts& p) -> void { counts.combine(p); });
+}
+
+}
+
+template <typename ReadExpT>
+void precomputeBiasBackground(const SalmonOpts& sopt, ReadExpT& readExp) {
+  auto bg = sopt.biasBackground;
+  if (!bg or bg->ready()) {
+    return;
+  }
+  bool seqBiasCorrect{sopt.biasCorrect};
+  if (!(seqBiasCorrect or sopt.gcBiasCorrect or sopt.posBiasCorrect)) {
+    return;
+  }
+  PhaseTelemetry::ScopedTimer timer(sopt.telemetry.get(),
+                                    TelemetryPhase::BIAS_BACKGROUND);
+
+  // The online estimates of the abundances, as (approximate) fragment
+  // counts, and the burn-in effective lengths
+  auto& transcripts = readExp.transcripts();
+  size_t numTranscripts = transcripts.size();
+  std::vector<double> alphas(numTranscripts, 0.0);
+  Eigen::VectorXd effLens(numTranscripts);
+  double logTotalMass{salmon::math::LOG_0};
+  for (size_t i = 0; i < numTranscripts; ++i) {
+    alphas[i] = transcripts[i].mass(false);
+    logTotalMass = salmon::math::logAdd(logTotalMass, alphas[i]);
+    effLens(i) = std::exp(transcripts[i].getCachedLogEffectiveLength());
+  }
+  if (logTotalMass == salmon::math::LOG_0) {
+    return;
+  }
+  double numFrags = static_cast<double>(readExp.numAssignedFragments());
+  for (auto& a : alphas) {
+    a = std::exp(a - logTotalMass) * numFrags;
+  }
+
+  auto& obs5 = readExp.readBiasModelObserved(salmon::utils::Direction::FORWARD);
+  int32_t K = seqBiasCorrect ? static_cast<int32_t>(obs5.getContextLength()) : 1;
+
+  bg->fldPDF = fragLengthPDF(*(readExp.fragmentLengthDistribution()));
+  std::vector<double> cdf;
+  int32_t fldLow{0};
+  int32_t fldHigh{1};
+  fragLengthCDF(bg->fldPDF, cdf, fldLow, fldHigh);
+
+  bg->weights = biasBackgroundWeights(transcripts, cdf, alphas, effLens);
+  addToBiasBackground(sopt, transcripts, K, cdf, fldLow, fldHigh, bg->weights,
+                      bg->counts);
+  bg->setReady();
+  sopt.jointLog->info("Computed the expected bias background from the online "
+                      "abundance estimates");
+}
+
+/**
+ * Computes (and returns) new effective lengths for the transcripts
+ * based on the current abundance estimates (alphas) and the current
+ * effective lengths (effLensIn).  This approach to sequence-specifc bias is
+ * based on the one taken in Roberts et al. (2011) [1].
+ * Here, we also consider fragment-GC bias which uses a novel method extending
+ * the idea of adjusting the effective lengths.
+ *
+ * [1] Roberts, Adam, et al. "Improving RNA-Seq expression estimates by
+ * correcting for fragment bias."
+ *     Genome Biol 12.3 (2011): R22.
+ */
+template <typename AbundanceVecT, typename ReadExpT>
+Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
+                                       Eigen::VectorXd& effLensIn,
+                                       AbundanceVecT& alphas, bool writeBias) {
+
+  using std::vector;
+  using BlockedIndexRange = tbb::blocked_range<size_t>;
+
+  double minAlpha = 1e-8;
+  double minCDFMass = 1e-10;
+  uint32_t gcSamp{sopt.pdfSampFactor};
+  bool gcBiasCorrect{sopt.gcBiasCorrect};
+  bool seqBiasCorrect{sopt.biasCorrect};
+  bool posBiasCorrect{sopt.posBiasCorrect};
+
+  double probFwd = readExp.gcFracFwd();
+  double probRC = readExp.gcFracRC();
+
+  if (gcBiasCorrect and probFwd < 0.0) {
+    sopt.jointLog->warn("Had no fragments from which to estimate "
+                        "fwd vs. rev-comp mapping rate.  Skipping "
+                        "sequence-specific / fragment-gc bias correction");
+    return effLensIn;
+  }
+
+  // calculate read bias normalization factor -- total count in read
+  // distribution.
+  auto& obs5 = readExp.readBiasModelObserved(salmon::utils::Direction::FORWARD);
+  auto& obs3 =
+      readExp.readBiasModelObserved(salmon::utils::Direction::REVERSE_COMPLEMENT);
+  obs5.normalize();
+  obs3.normalize();
+
+  auto& pos5Obs = readExp.posBias(salmon::utils::Direction::FORWARD);
+  auto& pos3Obs = readExp.posBias(salmon::utils::Direction::REVERSE_COMPLEMENT);
+
+  int32_t K =
+      seqBiasCorrect ? static_cast<int32_t>(obs5.getContextLength()) : 1;
+
+  FragmentLengthDistribution& fld = *(readExp.fragmentLengthDistribution());
+
+  // The *expected* biases from GC effects
+  auto& transcriptGCDist = readExp.expectedGCBias();
+  auto& gcCounts = readExp.observedGC();
+  int32_t fldLow{0};
+  int32_t fldHigh{1};
+
+  // The CDF and PDF of the fragment length distribution
+  std::vector<double> pdf = fragLengthPDF(fld);
+  std::vector<double> cdf;
+  fragLengthCDF(pdf, cdf, fldLow, fldHigh);
+
+  // Make this const so there are no shenanigans
+  const auto& transcripts = readExp.transcripts();
+
+  // The effective lengths adjusted for bias
+  Eigen::VectorXd effLensOut(effLensIn.size());
+
+  // The weight of each transcript in the background
+  std::vector<double> weights =
+      biasBackgroundWeights(transcripts, cdf, alphas, effLensIn);
+  size_t numBackgroundTranscripts = static_cast<size_t>(std::count_if(
+      weights.begin(), weights.end(), [](double w) -> bool { return w > 0.0; }));
+
   size_t bgCutoff =
       std::min(static_cast<size_t>(150),
                static_cast<size_t>(numBackgroundTranscripts * 0.1));
@@ -1832,40 +2012,59 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
                         "the bias background distribution.  This is likely too "
                         "small to safely do bias correction. "
                         "I'm skipping bias correction",
-                        numBackgroundTranscripts.load());
+                        numBackgroundTranscripts);
     sopt.biasCorrect = false;
     sopt.gcBiasCorrect = false;
     sopt.posBiasCorrect = false;
     return effLensIn;
   }
 
-  /**
-   * The local bias terms from each thread can be combined
-   * via simple summation.  Here, we combine the locally-computed
-   * bias terms.
-   */
-  SBModel exp5;
-  SBModel exp3;
-  std::vector<SimplePosBias> pos5Exp(5);
-  std::vector<SimplePosBias> pos3Exp(5);
-  auto combineBiasParams =
-      [seqBiasCorrect, gcBiasCorrect, posBiasCorrect, &pos5Exp, &pos3Exp, &exp5,
-       &exp3, &transcriptGCDist](const CombineableBiasParams& p) -> void {
-    if (seqBiasCorrect) {
-      exp5.combineCounts(p.expectSeqFW);
-      exp3.combineCounts(p.expectSeqRC);
-    }
-    if (gcBiasCorrect) {
-      transcriptGCDist.combineCounts(p.expectGC);
-    }
-    if (posBiasCorrect) {
-      for (size_t i = 0; i < p.expectPos5.size(); ++i) {
-        pos5Exp[i].combine(p.expectPos5[i]);
-        pos3Exp[i].combine(p.expectPos3[i]);
-      }
-    }
-  };
-  expectedDist.combine_each(combineBiasParams);
+  // The expected counts.  If these were computed (from the online
+  // estimates) while the reads were being mapped, and the fragment length
+  // distribution hasn't moved much since, just add in the change in weight
+  // of the transcripts whose abundance changed; otherwise compute them
+  // from scratch.
+  std::unique_ptr<BiasBackground::Counts> freshCounts{nullptr};
+  const BiasBackground::Counts* expected{nullptr};
+  auto precomputed = sopt.biasBackground;
+  double fldDistance = (precomputed and precomputed->ready())
+                           ? precomputed->fldDistance(pdf)
+                           : 1.0;
+  if (fldDistance < BiasBackground::fldTolerance) {
+    size_t numChanged{0};
+    auto delta = precomputed->reweigh(weights, numChanged);
+    std::vector<double> bgCDF;
+    int32_t bgFLDLow{0};
+    int32_t bgFLDHigh{1};
+    fragLengthCDF(precomputed->fldPDF, bgCDF, bgFLDLow, bgFLDHigh);
+    addToBiasBackground(sopt, transcripts, K, bgCDF, bgFLDLow, bgFLDHigh, delta,
+                        precomputed->counts);
+    precomputed->used = true;
+    precomputed->fldDeviation = fldDistance;
+    sopt.jointLog->info("Updated the bias background computed during mapping "
+                        "({} of {} transcripts re-weighted); the weights of "
+                        "the others differ from the final ones by at most "
+                        "{:.2f}%, and the fragment length distribution by a "
+                        "total variation distance of {:.4f}",
+                        numChanged, numBackgroundTranscripts,
+                        100.0 * precomputed->maxWeightDeviation, fldDistance);
+    expected = &(precomputed->counts);
+  } else {
+    freshCounts.reset(new BiasBackground::Counts(sopt.numConditionalGCBins,
+                                                 sopt.numFragGCBins));
+    addToBiasBackground(sopt, transcripts, K, cdf, fldLow, fldHigh, weights,
+                        *freshCounts);
+    expected = freshCounts.get();
+  }
+
+  SBModel exp5 = expected->seqFW;
+  SBModel exp3 = expected->seqRC;
+  std::vector<SimplePosBias> pos5Exp = BiasBackground::Counts::posBias(expected->pos5);
+  std::vector<SimplePosBias> pos3Exp = BiasBackground::Counts::posBias(expected->pos3);
+  transcriptGCDist.reset(distribution_utils::DistributionSpace::LINEAR);
+  if (gcBiasCorrect) {
+    transcriptGCDist.combineCounts(expected->gc);
+  }
 
   // finalize expected positional biases
   if (posBiasCorrect) {
@@ -1904,6 +2103,12 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
       [&](const BlockedIndexRange& range) -> void {
 
         std::string rcSeq;
+        // The (packed) contexts along a transcript, and their
+        // log-probabilities under the observed and expected models
+        std::vector<uint64_t> fwContexts;
+        std::vector<uint64_t> rcContexts;
+        std::vector<double> obsLogProbs;
+        std::vector<double> expLogProbs;
         // For each transcript
         for (auto it : boost::irange(range.begin(), range.end())) {
 
@@ -1950,7 +2155,7 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
 
             // This transcript's sequence
             const char* tseq = txp.Sequence();
-            revComplement(tseq, refLen, rcSeq);
+            reverseComplementInto(tseq, refLen, rcSeq);
             const char* rseq = rcSeq.c_str();
 
             int32_t fl = locFLDLow;
@@ -1996,23 +2201,43 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
               mer.from_chars(tseq);
               rcmer.from_chars(rseq);
               int32_t contextLength{exp5.getContextLength()};
+              int32_t contextBefore{obs5.contextBefore(false)};
 
+              // Gather the contexts to be scored; the conditions below
+              // only bound fragStart from above, so these are the contexts
+              // of a prefix of the positions.
+              fwContexts.clear();
+              rcContexts.clear();
               for (int32_t fragStart = 0; fragStart < refLen - K; ++fragStart) {
-                int32_t readStart = fragStart + obs5.contextBefore(false);
+                int32_t readStart = fragStart + contextBefore;
                 int32_t kmerEndPos =
                     fragStart + K - 1; // -1 because pos is *inclusive*
 
                 if (kmerEndPos >= 0 and kmerEndPos < refLen and
                     readStart < refLen) {
-                  seqFactorsFW[readStart] =
-                      std::exp(obs5.evaluateLog(mer) - exp5.evaluateLog(mer));
-                  seqFactorsRC[readStart] = std::exp(obs3.evaluateLog(rcmer) -
-                                                     exp3.evaluateLog(rcmer));
+                  fwContexts.push_back(SBModel::pack(mer));
+                  rcContexts.push_back(SBModel::pack(rcmer));
                 }
                 // shift the context one nucleotide to the right
                 mer.shift_left(tseq[fragStart + contextLength]);
                 rcmer.shift_left(rseq[fragStart + contextLength]);
               }
+
+              size_t numScored = fwContexts.size();
+              obsLogProbs.resize(numScored);
+              expLogProbs.resize(numScored);
+              obs5.evaluateLog(fwContexts.data(), numScored, obsLogProbs.data());
+              exp5.evaluateLog(fwContexts.data(), numScored, expLogProbs.data());
+              for (size_t i = 0; i < numScored; ++i) {
+                seqFactorsFW[i + contextBefore] =
+                    std::exp(obsLogProbs[i] - expLogProbs[i]);
+              }
+              obs3.evaluateLog(rcContexts.data(), numScored, obsLogProbs.data());
+              exp3.evaluateLog(rcContexts.data(), numScored, expLogProbs.data());
+              for (size_t i = 0; i < numScored; ++i) {
+                seqFactorsRC[i + contextBefore] =
+                    std::exp(obsLogProbs[i] - expLogProbs[i]);
+              }
               // We need these in 5' -> 3' order, so reverse them
               seqFactorsRC.reverseInPlace();
             } // end sequence-specific factor calculation
@@ -2063,7 +2288,7 @@ Eigen::VectorXd updateEffectiveLengths(SalmonOpts& sopt, ReadExpT& readExp,
                     int32_t contextFrac =
                         std::lrint((contextCountsFP[fragStart] +
                                     contextCountsTP[fragEnd]) *
-                                   cscale);
+                                   gcContextScale);
                     GCDesc desc{gcFrac, contextFrac};
                     fragFactor *= gcBias.get(desc);
                     /*
@@ -2360,6 +2585,21 @@ salmon::utils::updateEffectiveLengths<std::vector<double>,
     Eigen::VectorXd& effLensIn, std::vector<double>& alphas, bool finalRound);
 */
 
+template void
+salmon::utils::precomputeBiasBackground<ReadExperiment>(const SalmonOpts& sopt,
+                                                        ReadExperiment& readExp);
+
+// (for the unit tests and salmon_bench)
+template void
+salmon::utils::precomputeBiasBackground<salmon::detail::SimulatedBiasExperiment>(
+    const SalmonOpts& sopt, salmon::detail::SimulatedBiasExperiment& readExp);
+
+template Eigen::VectorXd
+salmon::utils::updateEffectiveLengths<std::vector<double>,
+                                      salmon::detail::SimulatedBiasExperiment>(
+    SalmonOpts& sopt, salmon::detail::SimulatedBiasExperiment& readExp,
+    Eigen::VectorXd& effLensIn, std::vector<double>& alphas, bool finalRound);
+
 // explicit instantiations for effective length updates ---
 template Eigen::VectorXd
 salmon::utils::updateEffectiveLengths<std::vector<tbb::atomic<double>>,
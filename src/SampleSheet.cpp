@@ -0,0 +1,88 @@
+#include "SampleSheet.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+#include "spdlog/fmt/fmt.h"
+
+namespace salmon {
+
+std::vector<std::string> splitFileList(const std::string& files) {
+  std::vector<std::string> result;
+  std::istringstream iss(files);
+  std::string f;
+  while (std::getline(iss, f, ',')) {
+    if (!f.empty()) {
+      result.push_back(f);
+    }
+  }
+  return result;
+}
+
+// Is @name usable as the name of a directory within the output directory?
+static bool isPathComponent(const std::string& name) {
+  return !name.empty() and name != "." and name != ".." and
+         name.find_first_of("/\\") == std::string::npos;
+}
+
+bool parseSampleSheet(const std::string& fname,
+                      std::vector<SampleSheetEntry>& samples) {
+  std::ifstream ifile(fname);
+  if (!ifile.good()) {
+    fmt::print(stderr, "Could not open the sample sheet [{}]\n", fname);
+    return false;
+  }
+
+  std::unordered_set<std::string> names;
+  std::string line;
+  size_t lineNum{0};
+  while (std::getline(ifile, line)) {
+    ++lineNum;
+    std::istringstream iss(line);
+    std::vector<std::string> fields;
+    std::string field;
+    while (iss >> field) {
+      fields.push_back(field);
+    }
+    // skip blank lines and comments
+    if (fields.empty() or fields.front().front() == '#') {
+      continue;
+    }
+    if (fields.size() != 3 and fields.size() != 4) {
+      fmt::print(stderr, "Line {} of the sample sheet [{}] has {} fields; "
+                         "expected 3 (single-end) or 4 (paired-end)\n",
+                 lineNum, fname, fields.size());
+      return false;
+    }
+    // the name determines the output directory of the sample, so it
+    // must not lead outside of the output directory ...
+    if (!isPathComponent(fields[0])) {
+      fmt::print(stderr, "Line {} of the sample sheet [{}] has the sample "
+                         "name {}; a sample name can not be . or .., and "
+                         "can not contain / or \\\n",
+                 lineNum, fname, fields[0]);
+      return false;
+    }
+    // ... and two samples with the same name would overwrite each other
+    if (!names.insert(fields[0]).second) {
+      fmt::print(stderr, "Line {} of the sample sheet [{}] repeats the sample "
+                         "name {}; every sample must have a distinct name\n",
+                 lineNum, fname, fields[0]);
+      return false;
+    }
+    SampleSheetEntry e;
+    e.name = fields[0];
+    e.libType = fields[1];
+    if (fields.size() == 3) {
+      e.unmated = splitFileList(fields[2]);
+    } else {
+      e.mates1 = splitFileList(fields[2]);
+      e.mates2 = splitFileList(fields[3]);
+    }
+    samples.push_back(e);
+  }
+  return true;
+}
+
+}
@@ -17,14 +17,19 @@ void SimplePosBias::addMass(int32_t bin, double mass) {
 // Compute the bin for @pos on a transcript of length @length,
 // and add @mass to the appropriate bin
 void SimplePosBias::addMass(int32_t pos, int32_t length, double mass) {
-  double step = static_cast<double>(length) / numBins_;
-  int bin = std::floor(pos / step);
+  int bin = binOf(pos, length);
   if (bin >= masses_.size()) {
     std::cerr << "bin = " << bin << '\n';
   }
   addMass(bin, mass);
 }
 
+// The bin for @pos on a transcript of length @length
+int32_t SimplePosBias::binOf(int32_t pos, int32_t length) const {
+  double step = static_cast<double>(length) / numBins_;
+  return std::floor(pos / step);
+}
+
 // Project, the weights contained in "bins"
 // into the vector @out (using spline interpolation)
 void SimplePosBias::projectWeights(std::vector<double>& out) {
@@ -45,6 +50,13 @@ void SimplePosBias::combine(const SimplePosBias& other) {
   }
 }
 
+// Append the (non-logged) mass of each bin to @out
+void SimplePosBias::appendMasses(std::vector<double>& out) const {
+  for (auto m : masses_) {
+    out.push_back(isLogged_ ? std::exp(m) : m);
+  }
+}
+
 // We're finished updating this distribution, so
 // compute the cdf etc.
 void SimplePosBias::finalize() {
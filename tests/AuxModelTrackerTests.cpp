@@ -0,0 +1,42 @@
+#include <vector>
+
+TEST_CASE("Auxiliary models are sampled, then frozen, once they settle") {
+    AuxModelTracker tracker;
+    AuxModelTracker::ThreadState ts;
+    REQUIRE(!tracker.enabled());
+    REQUIRE(!tracker.windowDone(ts, 1000000));
+
+    tracker.configure(0.01, 10, 0.1);
+    REQUIRE(!tracker.windowDone(ts, 5));
+    REQUIRE(tracker.windowDone(ts, 5));
+
+    auto observe = [&](std::vector<double> masses) -> bool {
+        return tracker.observe(AuxModel::GC_BIAS, ts, masses, 100);
+    };
+
+    // A model that keeps changing stays fully updated
+    REQUIRE(!observe({1.0, 1.0, 1.0, 1.0}));
+    REQUIRE(!observe({2.0, 1.0, 1.0, 1.0}));
+    REQUIRE(!observe({1.0, 1.0, 1.0, 1.0}));
+    REQUIRE(tracker.mode(AuxModel::GC_BIAS) == AuxModelUpdate::FULL);
+
+    // Two stable windows in a row move it to sampled updates
+    REQUIRE(!observe({2.0, 2.0, 2.0, 2.0}));
+    REQUIRE(observe({3.0, 3.0, 3.0, 3.0}));
+    REQUIRE(tracker.mode(AuxModel::GC_BIAS) == AuxModelUpdate::SAMPLED);
+    REQUIRE(tracker.logWeight(AuxModelUpdate::SAMPLED) == Approx(std::log(10.0)));
+    REQUIRE(tracker.logWeight(AuxModelUpdate::FULL) == 0.0);
+
+    // The windows before the switch don't count towards the next one
+    REQUIRE(!observe({3.0, 3.0, 3.0, 3.0}));
+    REQUIRE(!observe({3.0, 3.0, 3.0, 3.0}));
+    REQUIRE(observe({3.0, 3.0, 3.0, 3.0}));
+    REQUIRE(tracker.mode(AuxModel::GC_BIAS) == AuxModelUpdate::FROZEN);
+
+    // The other models are unaffected
+    REQUIRE(tracker.mode(AuxModel::SEQ_BIAS) == AuxModelUpdate::FULL);
+    REQUIRE(AuxModelTracker::shouldUpdate(AuxModelUpdate::FULL, false));
+    REQUIRE(AuxModelTracker::shouldUpdate(AuxModelUpdate::SAMPLED, true));
+    REQUIRE(!AuxModelTracker::shouldUpdate(AuxModelUpdate::SAMPLED, false));
+    REQUIRE(!AuxModelTracker::shouldUpdate(AuxModelUpdate::FROZEN, true));
+}
@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <unistd.h>
+
+extern "C" {
+int bwa_index(int argc, char* argv[]);
+}
+
+namespace {
+// The SMEMs (of length >= minSeedLen) found by repeated calls to bwt_smem1a,
+// exactly as in the first pass of bwa's mem_collect_intv.
+std::vector<bwtintv_t> smemsOneAtATime(const bwt_t* bwt, const std::string& read,
+                                       int minIntv, int minSeedLen) {
+  std::vector<uint8_t> q(read.size());
+  for (size_t i = 0; i < read.size(); ++i) {
+    q[i] = nst_nt4_table[static_cast<uint8_t>(read[i])];
+  }
+  int len = static_cast<int>(q.size());
+
+  std::vector<bwtintv_t> res;
+  bwtintv_v mem, tmp0, tmp1;
+  kv_init(mem); kv_init(tmp0); kv_init(tmp1);
+  bwtintv_v* tmpvec[2] = {&tmp0, &tmp1};
+  int x = 0;
+  while (x < len) {
+    if (q[x] < 4) {
+      x = bwt_smem1a(bwt, len, q.data(), x, minIntv, 0, &mem, tmpvec);
+      for (size_t i = 0; i < mem.n; ++i) {
+        bwtintv_t* p = &mem.a[i];
+        int slen = static_cast<uint32_t>(p->info) - (p->info >> 32);
+        if (slen >= minSeedLen) { res.push_back(*p); }
+      }
+    } else {
+      ++x;
+    }
+  }
+  kv_destroy(mem); kv_destroy(tmp0); kv_destroy(tmp1);
+  return res;
+}
+}
+
+SCENARIO("Batched SMEM search matches bwt_smem1a") {
+
+    GIVEN("A small FMD index and reads with mismatches and Ns") {
+      std::mt19937 gen(42);
+      const char* bases = "ACGT";
+      std::vector<std::string> txps;
+      for (size_t t = 0; t < 3; ++t) {
+        std::string s;
+        for (size_t i = 0; i < 2000; ++i) { s += bases[gen() % 4]; }
+        txps.push_back(s);
+      }
+      // A repeat shared by two of the transcripts, so that some SMEMs
+      // have an interval of size > 1.
+      txps[2].replace(100, 300, txps[0].substr(500, 300));
+
+      std::string fname = "smemTest.fa";
+      std::string prefix = "smemTest";
+      {
+        std::ofstream fa(fname);
+        for (size_t t = 0; t < txps.size(); ++t) {
+          fa << ">txp" << t << '\n' << txps[t] << '\n';
+        }
+      }
+      {
+        std::vector<std::string> args{"index", "-a", "is", "-p", prefix, fname};
+        std::vector<char*> argv;
+        for (auto& a : args) { argv.push_back(const_cast<char*>(a.c_str())); }
+        optind = 1;
+        REQUIRE(bwa_index(static_cast<int>(argv.size()), argv.data()) == 0);
+      }
+      bwt_t* bwt = bwt_restore_bwt((prefix + ".bwt").c_str());
+
+      std::vector<std::string> reads;
+      for (size_t r = 0; r < 200; ++r) {
+        auto& txp = txps[gen() % txps.size()];
+        size_t len = 30 + gen() % 121;
+        std::string read = txp.substr(gen() % (txp.size() - len), len);
+        for (auto& c : read) {
+          auto roll = gen() % 100;
+          if (roll == 0) { c = 'N'; }
+          else if (roll < 4) { c = bases[gen() % 4]; }
+        }
+        // Some reads are random, so that they have no long SMEMs at all.
+        if (r % 10 == 0) {
+          for (auto& c : read) { c = bases[gen() % 4]; }
+        }
+        reads.push_back(read);
+      }
+
+      WHEN("the reads are searched in batches of different widths") {
+        THEN("every read has exactly the SMEMs found one-at-a-time") {
+          for (int minSeedLen : {1, 19}) {
+            for (uint32_t width : {1u, 3u, 16u}) {
+              bwautils::SMEMBatch batch(bwt, width);
+              for (auto& read : reads) { batch.add(read); }
+              batch.search(1, minSeedLen);
+              REQUIRE(batch.size() == reads.size());
+
+              for (size_t r = 0; r < reads.size(); ++r) {
+                auto expected = smemsOneAtATime(bwt, reads[r], 1, minSeedLen);
+                const bwtintv_v& got = batch.mems(r);
+                REQUIRE(got.n == expected.size());
+                for (size_t i = 0; i < got.n; ++i) {
+                  REQUIRE(got.a[i].info == expected[i].info);
+                  REQUIRE(got.a[i].x[0] == expected[i].x[0]);
+                  REQUIRE(got.a[i].x[1] == expected[i].x[1]);
+                  REQUIRE(got.a[i].x[2] == expected[i].x[2]);
+                }
+              }
+            }
+          }
+        }
+      }
+
+      bwt_destroy(bwt);
+      std::remove(fname.c_str());
+      for (auto ext : {".amb", ".ann", ".bwt", ".pac", ".sa"}) {
+        std::remove((prefix + ext).c_str());
+      }
+    }
+}
@@ -0,0 +1,94 @@
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+SCENARIO("The bias background computed during mapping gives nearly the exact effective lengths") {
+    using salmon::detail::SimulatedBiasExperiment;
+
+    GIVEN("A simulated experiment with sequence-specific, fragment-GC and positional biases") {
+        SalmonOpts sopt;
+        sopt.jointLog = spdlog::get("biasBackgroundTests");
+        if (!sopt.jointLog) {
+            sopt.jointLog = spdlog::create("biasBackgroundTests",
+                                           {std::make_shared<spdlog::sinks::stderr_sink_mt>()});
+        }
+        sopt.biasCorrect = true;
+        sopt.gcBiasCorrect = true;
+        sopt.posBiasCorrect = true;
+        sopt.gcSampFactor = 1;
+        sopt.pdfSampFactor = 1;
+        sopt.noBiasLengthThreshold = false;
+        sopt.fragLenDistMax = 1000;
+        sopt.fragLenDistPriorMean = 250;
+        sopt.fragLenDistPriorSD = 25;
+
+        size_t numTranscripts{300};
+        size_t numFragments{50000};
+        SimulatedBiasExperiment experiment(sopt, numTranscripts, numFragments, 1234);
+        auto& transcripts = experiment.transcripts();
+
+        // The final abundances (as numbers of fragments), and the online
+        // estimates: most within a few percent of the final ones, the rest
+        // far off
+        std::mt19937 gen(5678);
+        std::uniform_real_distribution<> close(0.97, 1.03);
+        std::uniform_real_distribution<> far(0.3, 3.0);
+        std::uniform_real_distribution<> uni(0.0, 1.0);
+        std::vector<double> alphas(numTranscripts);
+        std::vector<double> online(numTranscripts);
+        double total{0.0};
+        for (size_t i = 0; i < numTranscripts; ++i) {
+            alphas[i] = std::exp(transcripts[i].mass(false));
+            online[i] = alphas[i] * ((uni(gen) < 0.8) ? close(gen) : far(gen));
+            total += alphas[i];
+        }
+        for (auto& a : alphas) { a *= numFragments / total; }
+
+        Eigen::VectorXd effLens(numTranscripts);
+        for (size_t i = 0; i < numTranscripts; ++i) {
+            effLens(i) = transcripts[i].EffectiveLength;
+        }
+
+        WHEN("the background is computed from the online estimates, and brought up to date") {
+            experiment.setAbundances(online);
+            auto bg = std::make_shared<BiasBackground>(sopt.numConditionalGCBins,
+                                                       sopt.numFragGCBins);
+            sopt.biasBackground = bg;
+            salmon::utils::precomputeBiasBackground(sopt, experiment);
+            REQUIRE(bg->ready());
+
+            // A few more fragments move the fragment length distribution
+            auto* fld = experiment.fragmentLengthDistribution();
+            for (size_t i = 0; i < 50; ++i) { fld->addVal(300, salmon::math::LOG_1); }
+
+            Eigen::VectorXd approx =
+                salmon::utils::updateEffectiveLengths(sopt, experiment, effLens, alphas);
+            sopt.biasBackground = nullptr;
+            Eigen::VectorXd exact =
+                salmon::utils::updateEffectiveLengths(sopt, experiment, effLens, alphas);
+
+            THEN("it was used, and the effective lengths are within 2% of the exact ones") {
+                // (copied, as Catch takes its operands by reference)
+                double fldTolerance{BiasBackground::fldTolerance};
+                double weightTolerance{BiasBackground::weightTolerance};
+                REQUIRE(bg->used);
+                REQUIRE(bg->fldDeviation > 0.0);
+                REQUIRE(bg->fldDeviation < fldTolerance);
+                REQUIRE(bg->maxWeightDeviation > 0.0);
+                REQUIRE(bg->maxWeightDeviation <= weightTolerance);
+                // The bias correction itself changes the effective lengths
+                // by far more than this
+                double maxRelDiff{0.0};
+                double maxCorrection{0.0};
+                for (size_t i = 0; i < numTranscripts; ++i) {
+                    REQUIRE(exact(i) > 0.0);
+                    maxRelDiff = std::max(maxRelDiff, std::abs(approx(i) - exact(i)) / exact(i));
+                    maxCorrection = std::max(maxCorrection, std::abs(exact(i) - effLens(i)) / effLens(i));
+                }
+                REQUIRE(maxRelDiff < 0.02);
+                REQUIRE(maxCorrection > 0.2);
+            }
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+// All that ClusterForest::mergeClusters() needs of a hit
+struct ClusterTestHit {
+    uint32_t tid;
+    uint32_t transcriptID() const { return tid; }
+};
+
+uint32_t sequentialFind(std::vector<uint32_t>& parent, uint32_t x) {
+    while (parent[x] != x) { x = parent[x] = parent[parent[x]]; }
+    return x;
+}
+}
+
+TEST_CASE("Concurrent merges into a ClusterForest give the same clusters as a sequential union-find") {
+    size_t numTranscripts{5000};
+    std::vector<Transcript> refs(numTranscripts);
+
+    for (uint32_t seed : {1u, 2u, 3u}) {
+        ClusterForest forest(numTranscripts, refs);
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<uint32_t> txpDist(0, numTranscripts - 1);
+        std::uniform_int_distribution<size_t> sizeDist(2, 4);
+        // Fewer merges than transcripts, so that there are many clusters of
+        // various sizes
+        std::vector<std::vector<ClusterTestHit>> fragments(3000);
+        for (auto& hits : fragments) {
+            size_t k = sizeDist(gen);
+            for (size_t j = 0; j < k; ++j) { hits.push_back({txpDist(gen)}); }
+        }
+
+        // (on threads of our own, so that they really are concurrent)
+        size_t numThreads{8};
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&, t]() -> void {
+                for (size_t i = t; i < fragments.size(); i += numThreads) {
+                    auto& hits = fragments[i];
+                    forest.mergeClusters<ClusterTestHit>(hits.begin(), hits.end());
+                }
+            });
+        }
+        for (auto& t : threads) { t.join(); }
+
+        std::vector<uint32_t> parent(numTranscripts);
+        for (uint32_t i = 0; i < numTranscripts; ++i) { parent[i] = i; }
+        for (auto& hits : fragments) {
+            for (auto& h : hits) {
+                parent[sequentialFind(parent, h.tid)] = sequentialFind(parent, hits.front().tid);
+            }
+        }
+        std::set<uint32_t> roots;
+        for (uint32_t i = 0; i < numTranscripts; ++i) { roots.insert(sequentialFind(parent, i)); }
+
+        auto clusters = forest.getClusters();
+        REQUIRE(clusters.size() == roots.size());
+        std::set<TranscriptCluster*> distinct(clusters.begin(), clusters.end());
+        REQUIRE(distinct.size() == clusters.size());
+
+        // Every transcript is in exactly one cluster, along with just those
+        // transcripts that the sequential union-find placed with it
+        std::vector<size_t> timesSeen(numTranscripts, 0);
+        std::set<uint32_t> clusterRoots;
+        size_t numMisplaced{0};
+        for (auto* c : clusters) {
+            auto& members = c->members();
+            REQUIRE_FALSE(members.empty());
+            uint32_t root = sequentialFind(parent, members.front());
+            REQUIRE(clusterRoots.insert(root).second);
+            for (auto m : members) {
+                ++timesSeen[m];
+                if (sequentialFind(parent, m) != root) { ++numMisplaced; }
+            }
+        }
+        REQUIRE(numMisplaced == 0);
+        REQUIRE(std::count(timesSeen.begin(), timesSeen.end(), 1) == numTranscripts);
+    }
+}
+
+TEST_CASE("The hit counts and masses of a ClusterForest are folded in across threads and calls to getClusters()") {
+    size_t numTranscripts{1000};
+    std::vector<Transcript> refs(numTranscripts);
+    ClusterForest forest(numTranscripts, refs);
+
+    // Pair up the transcripts, so that each cluster totals the updates of
+    // two of them
+    for (uint32_t i = 0; i + 1 < numTranscripts; i += 2) {
+        std::vector<ClusterTestHit> hits{{i}, {i + 1}};
+        forest.mergeClusters<ClusterTestHit>(hits.begin(), hits.end());
+    }
+
+    std::vector<double> expectedCounts(numTranscripts, 0.0);
+    std::vector<double> expectedMasses(numTranscripts, 0.0);
+    for (size_t i = 0; i < numTranscripts; ++i) {
+        expectedMasses[i] = std::exp(refs[i].mass());
+    }
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint32_t> txpDist(0, numTranscripts - 1);
+    size_t numThreads{8};
+    for (size_t round = 0; round < 2; ++round) {
+        // Every update adds a mass of 1/2; only some of them count a hit
+        std::vector<std::pair<uint32_t, bool>> updates(20000);
+        for (auto& u : updates) {
+            u = {txpDist(gen), gen() % 4 != 0};
+            if (u.second) { expectedCounts[u.first] += 1.0; }
+            expectedMasses[u.first] += 0.5;
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&, t]() -> void {
+                for (size_t i = t; i < updates.size(); i += numThreads) {
+                    forest.updateCluster(updates[i].first, 1, std::log(0.5), updates[i].second);
+                }
+            });
+        }
+        for (auto& t : threads) { t.join(); }
+
+        // The totals so far, each counted exactly once
+        auto clusters = forest.getClusters();
+        REQUIRE(clusters.size() == numTranscripts / 2);
+        size_t numWrong{0};
+        for (auto* c : clusters) {
+            double count{0.0};
+            double mass{0.0};
+            for (auto m : c->members()) {
+                count += expectedCounts[m];
+                mass += expectedMasses[m];
+            }
+            if (c->numHits() != count or
+                std::abs(std::exp(c->logMass()) - mass) > 1e-9 * mass) {
+                ++numWrong;
+            }
+        }
+        REQUIRE(numWrong == 0);
+    }
+}
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+SCENARIO("Columnar files round-trip") {
+
+    GIVEN("A columnar file with numeric and string columns") {
+      std::string fname = "columnarTest.bin";
+      std::vector<std::string> names{"txp0", "", "a_much_longer_transcript_name", "txp3"};
+      std::vector<uint32_t> lengths{100, 2000, 31, 4};
+      std::vector<double> tpms{0.5, 0.0, 1e6, 3.25};
+      // highly compressible
+      std::vector<uint64_t> counts(10000, 7);
+      {
+        salmon::columnar::ColumnarWriter out(fname);
+        out.addColumn("Name", names);
+        out.addColumn("Length", lengths);
+        out.addColumn("TPM", tpms);
+        out.addColumn("counts", counts);
+        out.close();
+      }
+
+      WHEN("it is read back") {
+        salmon::columnar::ColumnarReader in(fname);
+
+        THEN("all columns and values are recovered") {
+          REQUIRE(in.columns().size() == 4);
+          REQUIRE(in.hasColumn("TPM"));
+          REQUIRE_FALSE(in.hasColumn("NumReads"));
+          REQUIRE(in.columnInfo("counts").compressed);
+          REQUIRE(in.stringColumn("Name") == names);
+          REQUIRE(in.column<uint32_t>("Length") == lengths);
+          REQUIRE(in.column<double>("TPM") == tpms);
+          REQUIRE(in.column<uint64_t>("counts") == counts);
+          REQUIRE(in.stringValue("Name", 2) == names[2]);
+          REQUIRE(in.value<double>("TPM", 3) == tpms[3]);
+          REQUIRE(in.value<uint64_t>("counts", 9999) == 7);
+        }
+
+        THEN("invalid requests are rejected") {
+          REQUIRE_THROWS(in.column<double>("Length"));
+          REQUIRE_THROWS(in.value<double>("TPM", 4));
+          REQUIRE_THROWS(in.column<double>("NumReads"));
+        }
+      }
+      std::remove(fname.c_str());
+    }
+
+    GIVEN("An uncompressed columnar file with a single column") {
+      std::string fname = "columnarByteOrderTest.bin";
+      {
+        salmon::columnar::ColumnarWriter out(fname, 0);
+        out.addColumn("x", std::vector<uint32_t>{0x01020304});
+        out.close();
+      }
+
+      THEN("its numbers are stored little-endian") {
+        std::ifstream in(fname, std::ios::binary);
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)),
+                                         std::istreambuf_iterator<char>());
+        // The column follows the magic string; the trailer is the offset of
+        // the footer, which follows the column, and the magic string again
+        REQUIRE(bytes.size() > 24);
+        REQUIRE(std::vector<unsigned char>(bytes.begin() + 8, bytes.begin() + 12) ==
+                (std::vector<unsigned char>{0x04, 0x03, 0x02, 0x01}));
+        REQUIRE(std::vector<unsigned char>(bytes.end() - 16, bytes.end() - 8) ==
+                (std::vector<unsigned char>{12, 0, 0, 0, 0, 0, 0, 0}));
+        REQUIRE(salmon::columnar::ColumnarReader(fname).value<uint32_t>("x", 0) == 0x01020304);
+      }
+      std::remove(fname.c_str());
+    }
+}
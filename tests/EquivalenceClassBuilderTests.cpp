@@ -0,0 +1,89 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+std::shared_ptr<spdlog::logger> eqTestLogger() {
+    auto log = spdlog::get("eqClassTests");
+    if (!log) {
+        log = spdlog::create("eqClassTests", {std::make_shared<spdlog::sinks::stderr_sink_mt>()});
+    }
+    return log;
+}
+
+const TGValue* findClass(EquivalenceClassBuilder& builder, std::vector<uint32_t> txps) {
+    for (auto& kv : builder.eqVec()) {
+        if (kv.first.txps == txps) { return &kv.second; }
+    }
+    return nullptr;
+}
+}
+
+TEST_CASE("Rare equivalence classes are merged into a class with one fewer target") {
+    EquivalenceClassBuilder builder(eqTestLogger());
+    builder.start();
+    std::vector<double> w2{0.5, 0.5};
+    std::vector<double> pos2{1.0, 1.0};
+    for (size_t i = 0; i < 10; ++i) {
+        builder.addGroup(TranscriptGroup({1, 2}), w2, pos2);
+    }
+    // Target 1 has the least weight, but there is no class {2, 3}, so
+    // target 3 (with the next least) is the one left out.
+    std::vector<double> w3{0.2, 0.5, 0.3};
+    std::vector<double> pos3{0.4, 0.6, 0.8};
+    builder.addGroup(TranscriptGroup({1, 2, 3}), w3, pos3);
+    // A single target, and a class with no near-identical neighbor
+    std::vector<double> w1{1.0};
+    std::vector<double> pos1{0.5};
+    builder.addGroup(TranscriptGroup({4}), w1, pos1);
+    builder.addGroup(TranscriptGroup({7, 8, 9}), w3, pos3);
+
+    REQUIRE(builder.pruneBelow(2) == 3);
+    REQUIRE(builder.numEqClasses() == 1);
+    REQUIRE(builder.numMergedClasses() == 1);
+    REQUIRE(builder.numMergedFragments() == 1);
+    REQUIRE(builder.numDroppedClasses() == 2);
+    REQUIRE(builder.numDroppedFragments() == 2);
+    // The merged fragment had probability 0.3 of coming from target 3
+    REQUIRE(builder.reassignedMass() == Approx(0.3));
+
+    builder.finish();
+    auto* merged = findClass(builder, {1, 2});
+    REQUIRE(merged != nullptr);
+    REQUIRE(merged->count == 11);
+    // The merged fragment's weights are renormalized over {1, 2}
+    double w1Total = 5.0 + 0.2 / 0.7;
+    double w2Total = 5.0 + 0.5 / 0.7;
+    REQUIRE(merged->weights[0] == Approx(w1Total / (w1Total + w2Total)));
+    REQUIRE(merged->weights[1] == Approx(w2Total / (w1Total + w2Total)));
+    // and its positional weights are averaged in as they are
+    REQUIRE(merged->posWeights[0] == Approx(10.4 / 11.0));
+    REQUIRE(merged->posWeights[1] == Approx(10.6 / 11.0));
+}
+
+TEST_CASE("Compaction removes the least-observed equivalence classes") {
+    EquivalenceClassBuilder builder(eqTestLogger());
+    builder.start();
+    std::vector<double> w{0.5, 0.5};
+    std::vector<double> pos;
+    for (size_t i = 0; i < 10; ++i) {
+        builder.addGroup(TranscriptGroup({1, 2}), w, pos);
+    }
+    for (uint32_t i = 0; i < 100; ++i) {
+        builder.addGroup(TranscriptGroup({100 + i, 200 + i}), w, pos);
+    }
+
+    // Under the limit, nothing happens
+    REQUIRE(builder.compact(200, 150) == 0);
+    REQUIRE(builder.compact(50, 30) == 71);
+    REQUIRE(builder.numEqClasses() == 30);
+    REQUIRE(builder.numDroppedClasses() == 71);
+    REQUIRE(builder.numDroppedFragments() == 71);
+    REQUIRE(builder.numMergedClasses() == 0);
+
+    builder.finish();
+    // The most-observed class is always kept
+    auto* kept = findClass(builder, {1, 2});
+    REQUIRE(kept != nullptr);
+    REQUIRE(kept->count == 10);
+}
@@ -0,0 +1,79 @@
+#include <vector>
+#include <string>
+
+SCENARIO("Transcripts are added to and removed from an index in place") {
+    using salmon::index_update::IndexTranscripts;
+    using salmon::index_update::planUpdate;
+    using salmon::index_update::maskedTranscripts;
+    using Names = std::vector<std::string>;
+
+    GIVEN("An index with three transcripts, none of them removed or added") {
+      IndexTranscripts idx;
+      idx.base = {"A", "B", "C"};
+
+      THEN("names already in the index can't be added") {
+        auto plan = planUpdate(idx, {}, {"D", "B"});
+        REQUIRE_FALSE(plan.error.empty());
+        REQUIRE(planUpdate(idx, {}, {"D", "D"}).error.size() > 0);
+        REQUIRE(planUpdate(idx, {}, {"D"}).error.empty());
+      }
+
+      WHEN("a transcript is removed and then added again") {
+        auto removal = planUpdate(idx, {"B"}, {});
+        REQUIRE(removal.error.empty());
+        REQUIRE(removal.maskBase == Names{"B"});
+        idx.maskedBase = removal.maskBase;
+
+        auto readd = planUpdate(idx, {}, {"B"});
+        REQUIRE(readd.error.empty());
+        REQUIRE(readd.maskBase.empty());
+        idx.added = {"B"};
+
+        THEN("the base copy is masked, and the added copy is not") {
+          Names unknown;
+          auto masked = maskedTranscripts(idx.base, idx.added.size(), idx.maskedBase, unknown);
+          REQUIRE(unknown.empty());
+          REQUIRE(masked == (std::vector<bool>{false, true, false, false}));
+        }
+
+        THEN("adding it yet again is rejected") {
+          REQUIRE_FALSE(planUpdate(idx, {}, {"B"}).error.empty());
+        }
+
+        THEN("removing it drops the added copy, and leaves the base masked") {
+          auto plan = planUpdate(idx, {"B"}, {});
+          REQUIRE(plan.error.empty());
+          REQUIRE(plan.dropAdded == Names{"B"});
+          REQUIRE(plan.maskBase.empty());
+          REQUIRE(plan.notFound.empty());
+        }
+
+        THEN("it can be replaced in a single update") {
+          auto plan = planUpdate(idx, {"B"}, {"B"});
+          REQUIRE(plan.error.empty());
+          REQUIRE(plan.dropAdded == Names{"B"});
+        }
+      }
+
+      WHEN("a transcript is removed and added in a single update") {
+        auto plan = planUpdate(idx, {"C"}, {"C"});
+        THEN("the base copy is masked") {
+          REQUIRE(plan.error.empty());
+          REQUIRE(plan.maskBase == Names{"C"});
+          REQUIRE(plan.dropAdded.empty());
+        }
+      }
+
+      THEN("unknown and already removed names are reported") {
+        idx.maskedBase = {"A"};
+        auto plan = planUpdate(idx, {"A", "Z"}, {});
+        REQUIRE(plan.maskBase.empty());
+        REQUIRE(plan.notFound == (Names{"A", "Z"}));
+
+        Names unknown;
+        auto masked = maskedTranscripts(idx.base, 0, {"A", "Z"}, unknown);
+        REQUIRE(masked == (std::vector<bool>{true, false, false}));
+        REQUIRE(unknown == Names{"Z"});
+      }
+    }
+}
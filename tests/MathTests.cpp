@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Run a simple EM over randomly generated equivalence classes, with all
+// of the per-class normalization done in log space (as is done in the online
+// phase), and return the resulting TPMs.
+std::vector<double> logSpaceEMTPMs(const std::vector<std::vector<uint32_t>>& classes,
+                                   const std::vector<double>& classCounts,
+                                   const std::vector<double>& logLens,
+                                   size_t numIter) {
+    using salmon::math::logAdd;
+    using salmon::math::LOG_0;
+    size_t numTxps = logLens.size();
+    std::vector<double> logAlphas(numTxps, std::log(1.0 / numTxps));
+    std::vector<double> logNewAlphas(numTxps);
+    for (size_t it = 0; it < numIter; ++it) {
+        std::fill(logNewAlphas.begin(), logNewAlphas.end(), LOG_0);
+        for (size_t c = 0; c < classes.size(); ++c) {
+            double denom = LOG_0;
+            for (auto t : classes[c]) { denom = logAdd(denom, logAlphas[t] - logLens[t]); }
+            double logCount = std::log(classCounts[c]);
+            for (auto t : classes[c]) {
+                logNewAlphas[t] = logAdd(logNewAlphas[t], logCount + logAlphas[t] - logLens[t] - denom);
+            }
+        }
+        logAlphas.swap(logNewAlphas);
+    }
+    // TPM
+    double denom = LOG_0;
+    for (size_t t = 0; t < numTxps; ++t) { denom = logAdd(denom, logAlphas[t] - logLens[t]); }
+    std::vector<double> tpms(numTxps, 0.0);
+    for (size_t t = 0; t < numTxps; ++t) {
+        tpms[t] = (logAlphas[t] == LOG_0) ? 0.0 : 1e6 * std::exp(logAlphas[t] - logLens[t] - denom);
+    }
+    return tpms;
+}
+
+SCENARIO("Fast log-space arithmetic is accurate") {
+
+    using namespace salmon::math;
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<> dis(-60.0, 10.0);
+
+    GIVEN("Random pairs of log-space values") {
+      double maxAddErr{0.0};
+      double maxSubErr{0.0};
+      for (size_t i = 0; i < 100000; ++i) {
+        double x = dis(gen);
+        double y = dis(gen);
+        maxAddErr = std::max(maxAddErr, std::abs(exact::logAdd(x, y) - fast::logAdd(x, y)));
+        double hi = std::max(x, y);
+        double lo = std::min(x, y);
+        if (hi - lo > 1e-3) {
+          maxSubErr = std::max(maxSubErr, std::abs(exact::logSub(hi, lo) - fast::logSub(hi, lo)));
+        }
+      }
+      THEN("fast logAdd and logSub are close to the exact values") {
+        REQUIRE(maxAddErr < 5e-6);
+        REQUIRE(maxSubErr < 2e-4);
+        REQUIRE(fast::logAdd(LOG_0, 3.0) == 3.0);
+        REQUIRE(fast::logAdd(3.0, LOG_0) == 3.0);
+      }
+    }
+
+    GIVEN("An array of log-space values") {
+      std::vector<double> v(1001);
+      for (auto& x : v) { x = dis(gen); }
+      double expected = LOG_0;
+      for (auto x : v) { expected = exact::logAdd(expected, x); }
+
+      THEN("the batched kernels agree with the scalar ones") {
+        setAccuracy(Accuracy::EXACT);
+        REQUIRE(logSumExp(v.data(), v.size()) == Approx(expected).epsilon(1e-12));
+        setAccuracy(Accuracy::FAST);
+        REQUIRE(std::abs(logSumExp(v.data(), v.size()) - expected) < 2e-4);
+        std::vector<double> w(v);
+        expInPlace(w.data(), w.size());
+        for (size_t i = 0; i < v.size(); ++i) {
+          REQUIRE(std::abs(w[i] - std::exp(v[i])) <= 2e-4 * std::exp(v[i]));
+        }
+        setAccuracy(Accuracy::EXACT);
+      }
+    }
+
+    GIVEN("Randomly generated equivalence classes") {
+      size_t numTxps{500};
+      std::uniform_int_distribution<uint32_t> txpDis(0, numTxps - 1);
+      std::uniform_int_distribution<uint32_t> sizeDis(1, 6);
+      std::uniform_real_distribution<> countDis(1.0, 1000.0);
+      std::uniform_real_distribution<> lenDis(200.0, 5000.0);
+
+      std::vector<double> logLens(numTxps);
+      for (auto& l : logLens) { l = std::log(lenDis(gen)); }
+      std::vector<std::vector<uint32_t>> classes(2000);
+      std::vector<double> classCounts(classes.size());
+      for (size_t c = 0; c < classes.size(); ++c) {
+        size_t k = sizeDis(gen);
+        for (size_t j = 0; j < k; ++j) { classes[c].push_back(txpDis(gen)); }
+        std::sort(classes[c].begin(), classes[c].end());
+        classes[c].erase(std::unique(classes[c].begin(), classes[c].end()), classes[c].end());
+        classCounts[c] = countDis(gen);
+      }
+
+      WHEN("the abundances are estimated using exact and fast arithmetic") {
+        setAccuracy(Accuracy::EXACT);
+        auto exactTPMs = logSpaceEMTPMs(classes, classCounts, logLens, 100);
+        setAccuracy(Accuracy::FAST);
+        auto fastTPMs = logSpaceEMTPMs(classes, classCounts, logLens, 100);
+        setAccuracy(Accuracy::EXACT);
+
+        THEN("the resulting TPMs differ by less than 0.1%") {
+          double maxRelDiff{0.0};
+          for (size_t t = 0; t < numTxps; ++t) {
+            if (exactTPMs[t] > 1.0) {
+              maxRelDiff = std::max(maxRelDiff, std::abs(fastTPMs[t] - exactTPMs[t]) / exactTPMs[t]);
+            }
+          }
+          INFO("maximum relative TPM difference = " << maxRelDiff);
+          REQUIRE(maxRelDiff < 1e-3);
+        }
+      }
+    }
+}
@@ -0,0 +1,19 @@
+#include <vector>
+
+TEST_CASE("NUMA cpu lists are parsed, and workers spread over the nodes") {
+    using salmon::numa::parseIDList;
+    REQUIRE(parseIDList("0-3,8,10-11\n") == (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    REQUIRE(parseIDList("5") == (std::vector<int>{5}));
+    REQUIRE(parseIDList("").empty());
+    REQUIRE(parseIDList("3-1").empty());
+    REQUIRE(parseIDList("a-b").empty());
+
+    salmon::numa::Topology topo({0, 1}, {{0, 1, 2, 3}, {4, 5, 6, 7}});
+    REQUIRE(topo.numNodes() == 2);
+    // Workers are divided into contiguous blocks, one per node
+    std::vector<size_t> nodes;
+    for (size_t i = 0; i < 6; ++i) { nodes.push_back(topo.nodeForWorker(i, 6)); }
+    REQUIRE(nodes == (std::vector<size_t>{0, 0, 0, 1, 1, 1}));
+    REQUIRE(topo.nodeForWorker(0, 1) == 0);
+    REQUIRE(topo.nodeForWorker(2, 3) == 1);
+}
@@ -0,0 +1,55 @@
+#include <array>
+#include <cstdint>
+#include <vector>
+
+TEST_CASE("Philox4x32-10 matches the known-answer vectors") {
+    using salmon::rng::Philox4x32;
+    // From the Random123 distribution (kat_vectors)
+    auto zero = Philox4x32::block({{0, 0, 0, 0}}, {{0, 0}});
+    REQUIRE(zero == (std::array<uint32_t, 4>{{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}}));
+
+    auto ones = Philox4x32::block({{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}},
+                                  {{0xffffffff, 0xffffffff}});
+    REQUIRE(ones == (std::array<uint32_t, 4>{{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}}));
+
+    auto pi = Philox4x32::block({{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}},
+                                {{0xa4093822, 0x299f31d0}});
+    REQUIRE(pi == (std::array<uint32_t, 4>{{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}}));
+}
+
+TEST_CASE("Random number streams are reproducible and distinct") {
+    using salmon::rng::Phase;
+    auto a = salmon::rng::stream(42, Phase::BOOTSTRAP, 7);
+    auto b = salmon::rng::stream(42, Phase::BOOTSTRAP, 7);
+    auto otherIndex = salmon::rng::stream(42, Phase::BOOTSTRAP, 8);
+    auto otherPhase = salmon::rng::stream(42, Phase::GIBBS, 7);
+    auto otherSeed = salmon::rng::stream(43, Phase::BOOTSTRAP, 7);
+
+    size_t numSame{0};
+    for (size_t i = 0; i < 1000; ++i) {
+        auto x = a();
+        REQUIRE(x == b());
+        if (x == otherIndex() or x == otherPhase() or x == otherSeed()) { ++numSame; }
+    }
+    REQUIRE(numSame == 0);
+
+    SECTION("discard skips ahead") {
+        auto c = salmon::rng::stream(42, Phase::ONLINE, 0);
+        auto d = salmon::rng::stream(42, Phase::ONLINE, 0);
+        for (size_t i = 0; i < 13; ++i) { c(); }
+        d.discard(13);
+        REQUIRE(c() == d());
+    }
+
+    SECTION("uniform01 is in [0, 1)") {
+        auto c = salmon::rng::stream(1, Phase::ONLINE, 0);
+        double sum{0.0};
+        for (size_t i = 0; i < 100000; ++i) {
+            double u = c.uniform01();
+            REQUIRE(u >= 0.0);
+            REQUIRE(u < 1.0);
+            sum += u;
+        }
+        REQUIRE(sum / 100000 == Approx(0.5).epsilon(0.01));
+    }
+}
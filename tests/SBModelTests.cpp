@@ -0,0 +1,40 @@
+#include <random>
+#include <string>
+#include <vector>
+
+SCENARIO("Batch sequence-bias scoring matches per-context scoring") {
+
+    GIVEN("The contexts along a random sequence") {
+      std::mt19937 gen(4321);
+      std::uniform_real_distribution<> dis(0.0, 10.0);
+      std::string seq;
+      for (size_t i = 0; i < 5000; ++i) { seq.push_back("ACGT"[gen() % 4]); }
+
+      SBModel single;
+      SBModel batch;
+      int32_t contextLength = single.getContextLength();
+      std::vector<uint64_t> contexts;
+      std::vector<double> weights;
+      Mer mer;
+      mer.from_chars(seq.c_str());
+      for (size_t i = 0; i + contextLength < seq.size(); ++i) {
+        double w = dis(gen);
+        single.addSequence(mer, w);
+        contexts.push_back(SBModel::pack(mer));
+        weights.push_back(w);
+        mer.shift_left(seq[i + contextLength]);
+      }
+      batch.addSequences(contexts.data(), weights.data(), contexts.size());
+      single.normalize();
+      batch.normalize();
+
+      THEN("the models and their scores are the same") {
+        REQUIRE(single.checkTransitionProbabilities());
+        std::vector<double> scores(contexts.size());
+        batch.evaluateLog(contexts.data(), contexts.size(), scores.data());
+        for (size_t i = 0; i < contexts.size(); ++i) {
+          REQUIRE(scores[i] == Approx(single.evaluateLog(contexts[i])));
+        }
+      }
+    }
+}
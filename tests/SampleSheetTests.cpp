@@ -0,0 +1,55 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+SCENARIO("Sample sheets are parsed") {
+    auto parse = [](const std::string& contents,
+                    std::vector<salmon::SampleSheetEntry>& samples) -> bool {
+        std::string fname = "sampleSheetTest.tsv";
+        {
+            std::ofstream out(fname);
+            out << contents;
+        }
+        bool ok = salmon::parseSampleSheet(fname, samples);
+        std::remove(fname.c_str());
+        return ok;
+    };
+
+    GIVEN("A well-formed sample sheet") {
+        std::vector<salmon::SampleSheetEntry> samples;
+        bool ok = parse("# name libType reads\n"
+                        "\n"
+                        "s1 U r1.fq,r2.fq\n"
+                        "s2 IU a_1.fq b_1.fq,c_1.fq\n", samples);
+        THEN("single- and paired-end samples are read") {
+            REQUIRE(ok);
+            REQUIRE(samples.size() == 2);
+            REQUIRE(samples[0].name == "s1");
+            REQUIRE(samples[0].libType == "U");
+            REQUIRE(samples[0].unmated == (std::vector<std::string>{"r1.fq", "r2.fq"}));
+            REQUIRE(samples[0].mates1.empty());
+            REQUIRE(samples[1].name == "s2");
+            REQUIRE(samples[1].mates1 == std::vector<std::string>{"a_1.fq"});
+            REQUIRE(samples[1].mates2 == (std::vector<std::string>{"b_1.fq", "c_1.fq"}));
+        }
+    }
+
+    GIVEN("Sample sheets with malformed lines") {
+        std::vector<salmon::SampleSheetEntry> samples;
+        THEN("the wrong number of fields is rejected") {
+            REQUIRE_FALSE(parse("s1 U\n", samples));
+            REQUIRE_FALSE(parse("s1 U a b c\n", samples));
+        }
+        THEN("repeated names are rejected") {
+            REQUIRE_FALSE(parse("s1 U r1.fq\ns1 U r2.fq\n", samples));
+        }
+        THEN("names that aren't a single path component are rejected") {
+            for (std::string name : {".", "..", "/tmp/s1", "../s1", "a/b", "a\\b", "s1/"}) {
+                std::vector<salmon::SampleSheetEntry> entries;
+                REQUIRE_FALSE(parse("ok U r.fq\n" + name + " U r1.fq\n", entries));
+            }
+            REQUIRE(parse(".s1 U r1.fq\ns1.. U r2.fq\n", samples));
+        }
+    }
+}
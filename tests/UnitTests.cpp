@@ -5,9 +5,33 @@
 #include "LibraryFormat.hpp"
 #include "SalmonUtils.hpp"
 #include "Transcript.hpp"
+#include "ColumnarFile.hpp"
+#include "SBModel.hpp"
+#include "SalmonRandom.hpp"
+#include "AuxModelTracker.hpp"
+#include "NumaTopology.hpp"
+#include "EquivalenceClassBuilder.hpp"
+#include "BWAUtils.hpp"
+#include "IndexUpdate.hpp"
+#include "SampleSheet.hpp"
+#include "BiasBackground.hpp"
+#include "SimulatedBiasExperiment.hpp"
+#include "ClusterForest.hpp"
 
 bool verbose=false; // Apparently, we *need* this (OSX)
 
 #include "GCSampleTests.cpp"
 #include "LibraryTypeTests.cpp"
+#include "ColumnarFileTests.cpp"
+#include "MathTests.cpp"
+#include "SBModelTests.cpp"
+#include "RandomTests.cpp"
+#include "AuxModelTrackerTests.cpp"
+#include "NumaTopologyTests.cpp"
+#include "EquivalenceClassBuilderTests.cpp"
+#include "BWAUtilsTests.cpp"
+#include "IndexUpdateTests.cpp"
+#include "SampleSheetTests.cpp"
+#include "BiasBackgroundTests.cpp"
+#include "ClusterForestTests.cpp"
 //#include "KmerHistTests.cpp"